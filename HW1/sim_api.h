@@ -22,6 +22,12 @@ extern "C" {
 
 #define SIM_PIPELINE_DEPTH 5  /* Number of pipeline stages */
 #define SIM_REGFILE_SIZE 32   /* Number of (general purpose) registers in the register file (all integer) */
+#define SIM_MEM_CACHE_SIZE 8  /* Number of lines in the data memory cache */
+#define SIM_SNAPSHOT_INTERVAL 1024 /* Default number of cycles between two core snapshots (reverse execution) */
+#define SIM_MUL_LATENCY 4     /* Default latency (cycles) of the multiplier unit, pipelined by default */
+#define SIM_DIV_LATENCY 12    /* Default latency (cycles) of the divider unit, unpipelined by default */
+#define SIM_MT_MAX_THREADS 8  /* Maximal number of hardware contexts of the multithreaded core */
+#define SIM_SIMPOINT_DIMENSIONS 15 /* Number of random projection dimensions of the basic-block vectors (SimPoint) */
 
 /*! Commands opcodes */
 typedef enum
@@ -34,7 +40,9 @@ typedef enum
     CMD_BR,     // Unconditional relative branch to PC+dst register value
     CMD_BREQ,   // Branch to PC+dst if (src1 == src2)
     CMD_BRNEQ,  // Branch to PC+dst if (src1 != src2)
-    CMD_MAX = CMD_BRNEQ
+    CMD_MUL,    // dst <- src1 * src2  (multi-cycle, executed on the multiplier unit)
+    CMD_DIV,    // dst <- src1 / src2  (multi-cycle, executed on the divider unit. Division by zero yields 0)
+    CMD_MAX = CMD_DIV
 } SIM_cmd_opcode;
 
 typedef struct
@@ -60,8 +68,72 @@ typedef struct
     } pipeStageState[SIM_PIPELINE_DEPTH];
 } SIM_coreState;
 
+/*! A structure that holds the timing state of the memory simulator (clock, pending read and cache).
+    Used by the core to snapshot and restore the memory simulator for reverse execution.
+    The data memory contents are not part of this structure, see SIM_MemDataPeek and SIM_MemDataPoke */
+typedef struct
+{
+    uint32_t ticks;    /// The current memory clock tick
+    uint32_t readTick; /// The clock tick of the first attempt of the pending read (0 if none)
+    struct
+    {
+        uint32_t addr;
+        int32_t val;
+        bool valid;
+        uint32_t ticks;
+    } cache[SIM_MEM_CACHE_SIZE];
+} SIM_memState;
+
+/*! A structure to return the timing statistics of a simulation */
+typedef struct
+{
+    uint32_t cycles;        /// Number of simulated clock cycles
+    uint32_t committedCmds; /// Number of commands that completed WB (NOP commands and bubbles are not counted)
+    uint32_t hazardStalls;  /// Number of bubbles inserted by the hazard detection unit
+    uint32_t memoryStalls;  /// Number of cycles the pipe was frozen by a memory wait-state
+    uint32_t branchFlushes; /// Number of taken branches (each flushes IF, ID and EXE)
+} SIM_timingStats;
+
+/*! Thread selection policies of the multithreaded core */
+typedef enum
+{
+    SIM_MT_SWITCH_ON_STALL = 0, // Fetch the same thread until it is suspended on a memory wait-state
+    SIM_MT_ROUND_ROBIN          // Fetch the next ready thread every cycle
+} SIM_mtPolicy;
+
+/*! A structure to return the statistics of the multithreaded core */
+typedef struct
+{
+    uint32_t cycles;        /// Number of simulated clock cycles
+    uint32_t threads;       /// Number of hardware contexts
+    uint32_t committedCmds; /// Number of commands committed by all the threads (NOP commands and bubbles are not counted)
+    uint32_t hazardStalls;  /// Number of bubbles inserted by the hazard detection unit
+    uint32_t branchFlushes; /// Number of taken branches
+    uint32_t idleCycles;    /// Number of cycles nothing was fetched since all the threads were suspended
+    uint32_t threadSwitches; /// Number of fetches from a different thread than the previous fetch
+    uint32_t threadCommittedCmds[SIM_MT_MAX_THREADS];   /// Number of commands committed by each thread
+    uint32_t threadSuspendedCycles[SIM_MT_MAX_THREADS]; /// Number of cycles each thread waited for a memory read
+} SIM_mtStats;
+
+/*! A structure to return a profiled interval of committed commands (see SIM_CoreSetBbvInterval) */
+typedef struct
+{
+    uint32_t startCycle; /// The first cycle of the interval (a checkpoint to move to with SIM_GotoCycle)
+    uint32_t cycles;     /// Number of cycles until the last command of the interval committed
+    uint32_t commands;   /// Number of committed commands in the interval
+    uint32_t blockCount; /// Number of basic blocks executed in the interval (the basic-block vector length)
+} SIM_bbvInterval;
+
+/*! A structure to return a representative interval chosen by SIM_SimPointSelect */
+typedef struct
+{
+    uint32_t interval;   /// Index of the representative interval
+    uint32_t startCycle; /// The first cycle of the interval
+    double weight;       /// Fraction of all the intervals represented by this interval (the weights sum to 1)
+} SIM_simPoint;
+
 /*! Lookup table from command enumeration to command name */
-static const char *cmdStr[] = { "NOP", "ADD", "SUB", "LOAD", "STORE", "BR", "BREQ", "BRNEQ" };
+static const char *cmdStr[] = { "NOP", "ADD", "SUB", "LOAD", "STORE", "BR", "BREQ", "BRNEQ", "MUL", "DIV" };
 
 /*! Lookup table from pipe stage to its name - useful for debugging */
 static const char *pipeStageStr[] = { "IF", "ID", "EXE", "MEM", "WB" };
@@ -77,7 +149,7 @@ static const char *pipeStageStr[] = { "IF", "ID", "EXE", "MEM", "WB" };
   The memory image filename is composed from segments of 2 types, defined by an "@" location/type line:
   1. "I@<address>" : The following lines are instructions at given memory offset.
      Each subsequent line up to the next "@" line is an instruction of format: <command> <dst>,<src1>,<src2>
-     Commands is one of: NOP, ADD, SUB, LOAD, STORE, BR, BREQ, BRNEQ
+     Commands is one of: NOP, ADD, SUB, LOAD, STORE, BR, BREQ, BRNEQ, MUL, DIV
      operands are $<num> for any general purpose register, or just a number for immediate (for src2 only)
   2. "D@<address>" : The following lines are data values at given memory offset.
      Each subsequent line up the the next "@"is data value of a 32 bit (hex.) data word, e.g., 0x12A556FF
@@ -115,6 +187,28 @@ void SIM_MemDataWrite(uint32_t addr, int32_t val);
 */
 void SIM_MemInstRead(uint32_t addr, SIM_cmd *dst);
 
+/*! SIM_MemDataPeek: Read a data word without affecting the memory timing (no cache update, no wait-states)
+  \param[in] addr The main memory address to read. Must be 4-byte-aligned
+  \returns The value stored at the given address
+*/
+int32_t SIM_MemDataPeek(uint32_t addr);
+
+/*! SIM_MemDataPoke: Write a data word without affecting the memory timing (the cache is not updated)
+  \param[in] addr The main memory address to write. Must be 4-byte-aligned
+  \param[in] val  The value to write
+*/
+void SIM_MemDataPoke(uint32_t addr, int32_t val);
+
+/*! SIM_MemGetState: Save the timing state of the memory simulator
+  \param[out] state The returned memory timing state
+*/
+void SIM_MemGetState(SIM_memState *state);
+
+/*! SIM_MemSetState: Restore a timing state previously saved with SIM_MemGetState
+  \param[in] state The memory timing state to restore
+*/
+void SIM_MemSetState(const SIM_memState *state);
+
 /*************************************************************************/
 /* The following functions should be implemented in your sim.c (or .cpp) */
 /*************************************************************************/
@@ -139,6 +233,151 @@ void SIM_CoreClkTick(void);
 */
 void SIM_CoreGetState(SIM_coreState *curState);
 
+/*! SIM_CoreSetFuncUnit: Configure the multi-cycle functional unit that executes a command
+  The result of a multi-cycle command is written to the register file (and forwarded to EXE) 'latency' cycles after it enters EXE.
+  Dependent commands, and commands that need a busy unpipelined unit, are stalled in ID by the hazard detection unit.
+  \param[in] opcode CMD_MUL for the multiplier unit or CMD_DIV for the divider unit
+  \param[in] latency Number of cycles to produce a result, must be positive
+  \param[in] isPipelined true if the unit accepts a new command every cycle, false if it is busy until its result is ready
+  \returns 0 on success. <0 for an invalid opcode or latency.
+*/
+int SIM_CoreSetFuncUnit(SIM_cmd_opcode opcode, uint32_t latency, bool isPipelined);
+
+/*! SIM_CoreGetFuncUnit: Return the configuration of the multi-cycle functional unit that executes a command
+  \param[in] opcode CMD_MUL or CMD_DIV
+  \param[out] latency Number of cycles to produce a result
+  \param[out] isPipelined Whether the unit accepts a new command every cycle
+  \returns 0 on success. <0 for an invalid opcode.
+*/
+int SIM_CoreGetFuncUnit(SIM_cmd_opcode opcode, uint32_t *latency, bool *isPipelined);
+
+/*! SIM_CoreGetTimingStats: Return the timing statistics of the core since the last SIM_CoreReset
+  \param[out] stats The returned timing statistics
+*/
+void SIM_CoreGetTimingStats(SIM_timingStats *stats);
+
+/*! SIM_CoreSetBbvInterval: Profile basic-block vectors of intervals of committed commands
+  Each interval holds a fixed number of committed commands (NOP commands are not counted), and records how
+  many commands were committed in each basic block. A basic block is identified by the pc of its first command.
+  Clears the current profile, the profile is also cleared by SIM_CoreReset and follows SIM_GotoCycle.
+  \param[in] interval Number of committed commands in an interval, 0 disables profiling (the default)
+  \returns 0 on success.
+*/
+int SIM_CoreSetBbvInterval(uint32_t interval);
+
+/*! SIM_CoreGetBbvIntervalCount: Return the number of completed profiled intervals */
+uint32_t SIM_CoreGetBbvIntervalCount(void);
+
+/*! SIM_CoreGetBbv: Return a completed profiled interval and its basic-block vector
+  Call with NULL arrays to get the vector length (info->blockCount) first.
+  \param[in] interval The interval index, smaller than SIM_CoreGetBbvIntervalCount()
+  \param[out] info The interval cycles and vector length (may be NULL)
+  \param[out] blockPcs The pc of the first command of each basic block, in increasing order (may be NULL)
+  \param[out] blockCounts The number of commands committed in each basic block (may be NULL)
+  \returns 0 on success. <0 for an interval that is not completed.
+*/
+int SIM_CoreGetBbv(uint32_t interval, SIM_bbvInterval *info, uint32_t *blockPcs, uint32_t *blockCounts);
+
+/*************************************************************************/
+/* Decoupled simulation - implemented in sim_decoupled.cpp               */
+/*************************************************************************/
+
+/*! SIM_DecoupledRun: Simulate the loaded program on two host threads
+  A functional front-end executes the program and streams the executed commands (with resolved
+  addresses, stored values and branch outcomes) through a lock-free queue to a timing back-end,
+  which only models the pipe occupancy, hazards, multi-cycle units and memory stalls.
+  The timing statistics are the same as the ones of SIM_CoreClkTick for the same number of cycles.
+  Only the functional unit configuration of the core (SIM_CoreSetFuncUnit) is used, the core state is not changed.
+  The memory simulator must be freshly reset (SIM_MemReset) and its clock is driven by the back-end.
+  \param[in] cycles Number of cycles to simulate
+  \param[out] stats The returned timing statistics
+  \returns 0 on success. <0 in case of failure.
+*/
+int SIM_DecoupledRun(uint32_t cycles, SIM_timingStats *stats);
+
+/*************************************************************************/
+/* Multithreaded core - implemented in sim_mt.cpp                        */
+/*************************************************************************/
+/* Up to SIM_MT_MAX_THREADS contexts, each with its own pc and register file, share one pipeline and
+   all run the loaded program from pc 0. Hazards and branch flushes apply per thread. A LOAD that gets
+   a memory wait-state suspends its thread (its younger commands are fetched again later) instead of
+   freezing the pipe, so the other threads hide the memory latency.
+   Commands are executed when first fetched, so the threads share the data memory in fetch order.
+   The multithreaded core is independent of the core state, only the functional unit configuration of the
+   core (SIM_CoreSetFuncUnit) is used. Like the core, it is driven with SIM_MtClkTick + SIM_MemClkTick. */
+
+/*! SIM_MtReset: Reset the multithreaded core to start a new simulation (after SIM_MemReset)
+  \param[in] threads Number of hardware contexts, 1 to SIM_MT_MAX_THREADS
+  \param[in] policy The thread selection policy
+  \returns 0 on success. <0 for an invalid number of threads or policy.
+*/
+int SIM_MtReset(uint32_t threads, SIM_mtPolicy policy);
+
+/*! SIM_MtClkTick: Update the multithreaded core given one clock cycle */
+void SIM_MtClkTick(void);
+
+/*! SIM_MtGetThreadState: Return the architectural state of a context
+  The state includes every command the thread has fetched (commands are executed when first fetched)
+  \param[in] thread The context index
+  \param[out] pc The pc of the next command to execute (may be NULL)
+  \param[out] regFile The SIM_REGFILE_SIZE registers (may be NULL)
+  \returns 0 on success. <0 for an invalid context.
+*/
+int SIM_MtGetThreadState(uint32_t thread, int32_t *pc, int32_t *regFile);
+
+/*! SIM_MtGetStats: Return the per-thread and aggregate statistics since the last SIM_MtReset
+  \param[out] stats The returned statistics
+*/
+void SIM_MtGetStats(SIM_mtStats *stats);
+
+/*************************************************************************/
+/* SimPoint interval selection - implemented in sim_simpoint.cpp         */
+/*************************************************************************/
+
+/*! SIM_SimPointSelect: Choose representative intervals of the basic-block vector profile
+  The normalized basic-block vectors are reduced to SIM_SIMPOINT_DIMENSIONS dimensions by a random projection
+  and clustered with k-means for every k up to maxClusters. The smallest k whose BIC score reaches 90% of the
+  best score range is chosen, and the interval closest to each cluster center represents the cluster.
+  The CPI of the whole profile is estimated by the weighted CPI of the representative intervals.
+  \param[in] maxClusters Maximal number of clusters (representative intervals), must be positive
+  \param[in] seed Seed of the random projection and of the k-means initializations
+  \param[out] points The representative intervals, must hold maxClusters entries
+  \param[out] count Number of representative intervals returned
+  \returns 0 on success. <0 if there are no completed intervals or for invalid arguments.
+*/
+int SIM_SimPointSelect(uint32_t maxClusters, uint32_t seed, SIM_simPoint *points, uint32_t *count);
+
+/*************************************************************************/
+/* Reverse execution (time travel) - implemented in sim_core.cpp         */
+/*************************************************************************/
+/* The core takes a snapshot of its pipeline and of the memory timing state every
+   snapshot interval cycles, and keeps an undo log of every register and data memory write.
+   Moving back restores the closest snapshot, undoes the logged writes and re-simulates
+   the remaining cycles, so its cost is bounded by the snapshot interval.
+   The navigation functions drive both the core and the memory clocks (SIM_CoreClkTick + SIM_MemClkTick). */
+
+/*! SIM_CoreSetSnapshotInterval: Set the number of cycles between two snapshots (default SIM_SNAPSHOT_INTERVAL)
+  \param[in] interval Number of cycles between snapshots, must be positive
+  \returns 0 on success. <0 for an invalid interval.
+*/
+int SIM_CoreSetSnapshotInterval(uint32_t interval);
+
+/*! SIM_CoreGetCycle: Return the number of clock cycles simulated since the last SIM_CoreReset
+*/
+uint32_t SIM_CoreGetCycle(void);
+
+/*! SIM_StepBack: Move the simulation n cycles backwards
+  \param[in] n Number of cycles to step back
+  \returns 0 on success. <0 if n is larger than the current cycle.
+*/
+int SIM_StepBack(uint32_t n);
+
+/*! SIM_GotoCycle: Move the simulation to the given cycle (backwards or forwards)
+  \param[in] cycle The cycle to move to, counted from the last SIM_CoreReset
+  \returns 0 on success. <0 in case of failure.
+*/
+int SIM_GotoCycle(uint32_t cycle);
+
 
 
 #ifdef __cplusplus
@@ -3,6 +3,8 @@
 
 #include "sim_api.h"
 #include <vector>
+#include <map>
+#include <algorithm>
 #ifdef _WIN32
 #else
 #include <tr1/memory>
@@ -11,7 +13,7 @@
 #define FLUSH_ALL -1
 
 /*! SimCore
-The main class representing a MIPS CPU that supports LOAD, STORE, ADD, SUB, BR, BREQ and BRNEQ commands
+The main class representing a MIPS CPU that supports LOAD, STORE, ADD, SUB, BR, BREQ, BRNEQ, MUL and DIV commands
 SimCore class has declaration and definition of sub-systems inside the MIPS CPU: 
 	1. PipeStage - an abstract class that represents a single stage inside the pipe. The stages are:
 		1. InstructionFetch
@@ -25,6 +27,10 @@ SimCore class has declaration and definition of sub-systems inside the MIPS CPU:
 	3. HDU - a class that implements the hazard detection unit.
 			  Implemented via operator() overloading
 
+	4. FunctionalUnit - a class that implements a multi-cycle (pipelined or unpipelined) execution unit for MUL and DIV
+
+	5. BbvProfiler - a class that records basic-block vectors of fixed-length intervals of committed commands
+
 	All of the above sub-classes do not exist on their own hence declared and defined in 'containment' notation
 	and have access (via 'friend' declaration) to the SimCore owner control values and data structures 
 */
@@ -33,6 +39,18 @@ class SimCore
 	friend class PipeStage;
 	friend class Forward;
 	friend class HDU;
+	friend class FunctionalUnit;
+	friend class BbvProfiler;
+
+	/*! StageState
+	The private latch values of a single pipe stage, used to snapshot the pipe for reverse execution.
+	Each stage stores only the fields it uses (see PipeStage::SaveState)
+	*/
+	struct StageState {
+		int32_t cmd_pc;
+		int32_t data[2];
+		bool flag;
+	};
 
 	/*! PipeStage
 	An abstract class for representing a single pipe stage in the pipeline.
@@ -82,6 +100,23 @@ class SimCore
 			return m_curr_cmd_pc;
 		}
 
+		/*! PipeStage::SaveState (virtual)
+		Saves the private latch values of this stage into a snapshot.
+		Derived classes with their own latches override it and call the base method
+		\param[out] state The snapshot of this stage
+		*/
+		virtual void SaveState(StageState& state) const {
+			state.cmd_pc = m_curr_cmd_pc;
+		}
+
+		/*! PipeStage::RestoreState (virtual)
+		Restores the private latch values of this stage from a snapshot taken by SaveState
+		\param[in] state The snapshot of this stage
+		*/
+		virtual void RestoreState(const StageState& state) {
+			m_curr_cmd_pc = state.cmd_pc;
+		}
+
 	protected:
 		/*! PipeStage::m_pipe_stage
 		The index inside this->core_owner stages container
@@ -137,15 +172,18 @@ class SimCore
 			//Get a reference to the current command at the pipe stage
 			SIM_cmd& this_stage_cmd = this_owner.m_machine_state.pipeStageState[m_pipe_stage].cmd;
 			
-			//Get a reference to the register file of the core
-			int32_t (&register_file)[SIM_REGFILE_SIZE] = this_owner.m_machine_state.regFile;
+			//every command but NOP (or a bubble) completes in WB
+			if (CMD_NOP != this_stage_cmd.opcode) {
+				this_owner.m_timing_stats.committedCmds++;
+				this_owner.m_bbv_profiler.Commit(m_curr_cmd_pc, this_stage_cmd.opcode);
+			}
 
 			//if the command is 'add', 'load' or 'sub', write back 
 			if (CMD_ADD == this_stage_cmd.opcode || 
 				CMD_LOAD == this_stage_cmd.opcode ||
 				CMD_SUB == this_stage_cmd.opcode){
-				//write the data back to the register file
-				register_file[this_stage_cmd.dst] = m_written_data;
+				//write the data back to the register file (logged for reverse execution)
+				this_owner.WriteRegister(this_stage_cmd.dst, m_written_data);
 			}
 			return;
 		}
@@ -158,7 +196,7 @@ class SimCore
 				1. If the opcode is CMD_LOAD, pull the data loaded from the data memory save by MEM stage
 				2. Else if the opcode is CMD_ADD or CMD_SUB, pull the data calculated from EXE stage and propagated to MEM stage
 
-			(no need for calling PipeStage::Propagate, the current command pc is not being used here)
+			3. Pull the current command pc (via PipeStage::Propagate), used for basic-block profiling
 		*/
 		virtual void Propagate() {
 			//If we can update the pipe, do the following:
@@ -179,6 +217,8 @@ class SimCore
 					m_written_data = dynamic_cast<Memory*>(core.m_stages[SIM_PIPELINE_DEPTH - 2])->m_EXE_calculations.EXE_calculation;
 
 				//else do nothing
+
+				PipeStage::Propagate();
 			}
 			
 		}
@@ -191,6 +231,16 @@ class SimCore
 		*/
 		const int32_t WrittenData() const { return m_written_data; }
 
+		virtual void SaveState(StageState& state) const {
+			PipeStage::SaveState(state);
+			state.data[0] = m_written_data;
+		}
+
+		virtual void RestoreState(const StageState& state) {
+			PipeStage::RestoreState(state);
+			m_written_data = state.data[0];
+		}
+
 	protected:
 		/*! WriteBack::m_written_data
 		The value of the protected field of WriteBack class,
@@ -269,7 +319,7 @@ class SimCore
 				int32_t addr = m_EXE_calculations.EXE_calculation;
 				//write the data to memory
 				int32_t src1Val = core.m_machine_state.pipeStageState[m_pipe_stage].src1Val;
-				SIM_MemDataWrite(addr, src1Val);
+				core.WriteMemory(addr, src1Val);
 			}
 
 			//if the command is not one of the three kinds of branch, put the the flag
@@ -296,6 +346,20 @@ class SimCore
 			
 		}
 
+		virtual void SaveState(StageState& state) const {
+			PipeStage::SaveState(state);
+			state.data[0] = m_loaded_data;
+			state.data[1] = m_EXE_calculations.EXE_calculation;
+			state.flag = m_EXE_calculations.EXE_is_branch;
+		}
+
+		virtual void RestoreState(const StageState& state) {
+			PipeStage::RestoreState(state);
+			m_loaded_data = state.data[0];
+			m_EXE_calculations.EXE_calculation = state.data[1];
+			m_EXE_calculations.EXE_is_branch = state.flag;
+		}
+
 	private:
 		/*! Memory::m_loaded_data
 		The loaded value from the data memory
@@ -377,6 +441,18 @@ class SimCore
 			case CMD_STORE:	{
 							m_calculated_data = m_current_dst_data + (EXE_cmd.isSrc2Imm ? EXE_cmd.src2 : EXE_srcVal2); }
 							break;
+
+			//multi-cycle commands: the result is written back by the functional unit when its latency is over
+			case CMD_MUL:	{
+							m_calculated_data = (int32_t)((int64_t)EXE_srcVal1 * (EXE_cmd.isSrc2Imm ? EXE_cmd.src2 : EXE_srcVal2));
+							core.UnitOf(CMD_MUL).Issue(EXE_cmd.dst, m_calculated_data); }
+							break;
+
+			case CMD_DIV:	{
+							int64_t divisor = (EXE_cmd.isSrc2Imm ? EXE_cmd.src2 : EXE_srcVal2);
+							m_calculated_data = (0 == divisor) ? 0 : (int32_t)((int64_t)EXE_srcVal1 / divisor);
+							core.UnitOf(CMD_DIV).Issue(EXE_cmd.dst, m_calculated_data); }
+							break;
 			default:
 				break;
 			}
@@ -402,6 +478,20 @@ class SimCore
 			
 		}
 
+		virtual void SaveState(StageState& state) const {
+			PipeStage::SaveState(state);
+			state.data[0] = m_calculated_data;
+			state.data[1] = m_current_dst_data;
+			state.flag = mf_is_branch;
+		}
+
+		virtual void RestoreState(const StageState& state) {
+			PipeStage::RestoreState(state);
+			m_calculated_data = state.data[0];
+			m_current_dst_data = state.data[1];
+			mf_is_branch = state.flag;
+		}
+
 	private:
 		/*! Execute::mf_is_branch
 		A flag control of branch condition
@@ -464,6 +554,17 @@ class SimCore
 		}
 
 		//notice that InstructionDecode doesn't override PipeStage::Propagate
+
+		virtual void SaveState(StageState& state) const {
+			PipeStage::SaveState(state);
+			state.data[0] = m_dst_value;
+		}
+
+		virtual void RestoreState(const StageState& state) {
+			PipeStage::RestoreState(state);
+			m_dst_value = state.data[0];
+		}
+
 	private:
 		/*! InstructionDecode::m_dst_value (virtual)
 		Implements PipeStage::Perform abstract method:
@@ -558,6 +659,8 @@ class SimCore
 				Else if EXE command opcode is BR or BREQ or BRNEQ or STORE and WB command opcode is SUB or ADD or LOAD and EXEdst register equals WBdst register
 				assign written value of WB to EXEdstVal
 			
+			Finally, a result written by a multi-cycle unit on this cycle is forwarded to EXE src1, src2 and dst (it is the youngest value)
+
 			(NOTE: if MEM command opcode is LOAD and we have to forward values we have a hazard, this is detected by HDU and not dealt with here)
 		*/
 		void operator ()() {
@@ -614,6 +717,18 @@ class SimCore
 				dynamic_cast<Execute*>(core.m_stages[SIM_PIPELINE_DEPTH - 3])->m_current_dst_data =
 					dynamic_cast<WriteBack*>(core.m_stages[SIM_PIPELINE_DEPTH - 1])->WrittenData();
 			}
+
+			//results of multi-cycle commands completed on this cycle are younger than anything in MEM and WB, so they come last
+			int32_t completed_value;
+			if (core.CompletedResult(EXEsrc1Index, completed_value))
+				EXEsrc1Val = completed_value;
+
+			if (!EXE_cmd.isSrc2Imm && core.CompletedResult(EXEsrc2Index, completed_value))
+				EXEsrc2Val = completed_value;
+
+			if ((EXE_cmd.opcode == CMD_BR || EXE_cmd.opcode == CMD_BREQ || EXE_cmd.opcode == CMD_BRNEQ || EXE_cmd.opcode == CMD_STORE) &&
+				core.CompletedResult(EXEdstIndex, completed_value))
+				dynamic_cast<Execute*>(core.m_stages[SIM_PIPELINE_DEPTH - 3])->m_current_dst_data = completed_value;
 				
 		}
 
@@ -652,6 +767,12 @@ class SimCore
 					Else return false
 
 				Else return false (EXE command is not LOAD)
+
+			3.	Multi-cycle commands (MUL, DIV): the ID command enters EXE on the next cycle at the earliest, 
+				so there is a hazard if:
+					RAW - one of the ID registers is written by a multi-cycle command (in EXE or in flight) later than the next cycle
+					WAW - the ID destination register is written by a multi-cycle command later than the next cycle
+					Structural - ID command is MUL or DIV and its unpipelined unit will still be busy on the next cycle
 		\return true if there's a hazard the pipe, false otherwise
 		*/
 		bool operator()() {
@@ -659,6 +780,9 @@ class SimCore
 			//if there's a load command in EXE and a dependent command on ID, raise a flag, next clock cycle will insert NOP in EXE
 			SIM_cmd const& EXE_cmd = core.m_machine_state.pipeStageState[SIM_PIPELINE_DEPTH - 3].cmd;
 			SIM_cmd	const& ID_cmd = core.m_machine_state.pipeStageState[SIM_PIPELINE_DEPTH - 4].cmd;
+
+			if (MultiCycleHazard(EXE_cmd, ID_cmd))
+				return true;
 			
 			//the only way that there's a hazard is when EXE stage opcode is CMD_LOAD
 			if (EXE_cmd.opcode == CMD_LOAD) {
@@ -683,17 +807,367 @@ class SimCore
 		}
 
 	private:
+		/*! HDU::MultiCycleHazard
+		Detects RAW, WAW and structural hazards of the ID command against multi-cycle commands
+		(see HDU::operator() section 3)
+		\param[in] EXE_cmd The command in EXE stage, issued to its functional unit on this cycle
+		\param[in] ID_cmd The command in ID stage
+		\return true if the ID command has to be stalled
+		*/
+		bool MultiCycleHazard(SIM_cmd const& EXE_cmd, SIM_cmd const& ID_cmd) const {
+			SimCore& core = m_core_owner;
+			const uint32_t next_cycle = core.m_cycle + 1;
+
+			//registers read by the ID command
+			int read_regs[3];
+			int read_count = 0;
+			switch (ID_cmd.opcode)
+			{
+			case CMD_NOP:
+				break;
+			case CMD_BR:
+				read_regs[read_count++] = ID_cmd.dst;
+				break;
+			case CMD_STORE:
+			case CMD_BREQ:
+			case CMD_BRNEQ:
+				read_regs[read_count++] = ID_cmd.dst;
+				// fall through - src1 and src2 are read as well
+			default:
+				read_regs[read_count++] = ID_cmd.src1;
+				if (!ID_cmd.isSrc2Imm) read_regs[read_count++] = ID_cmd.src2;
+				break;
+			}
+
+			for (int i = 0; i < read_count; i++) {
+				if (core.PendingWrite(EXE_cmd, read_regs[i]) > next_cycle)
+					return true;
+			}
+
+			//WAW against a multi-cycle command, the later write must not be overwritten
+			if ((CMD_ADD == ID_cmd.opcode || CMD_SUB == ID_cmd.opcode || CMD_LOAD == ID_cmd.opcode ||
+				 CMD_MUL == ID_cmd.opcode || CMD_DIV == ID_cmd.opcode) &&
+				core.PendingWrite(EXE_cmd, ID_cmd.dst) > next_cycle)
+				return true;
+
+			//structural: the unit of the ID command is unpipelined and still busy
+			if (CMD_MUL == ID_cmd.opcode || CMD_DIV == ID_cmd.opcode) {
+				const FunctionalUnit& unit = core.UnitOf(ID_cmd.opcode);
+				uint32_t busy_until = unit.BusyUntil();
+				if (ID_cmd.opcode == EXE_cmd.opcode && !unit.IsPipelined())
+					busy_until = std::max(busy_until, core.m_cycle + unit.Latency());
+				if (busy_until > next_cycle)
+					return true;
+			}
+
+			return false;
+		}
+
 		/*! Forward::m_core_owner
 		A reference to a SimCore class, the owner that holds this hazard detection unit
 		*/
 		SimCore& m_core_owner;
 	};
 
+	/*! FunctionalUnit
+	A class that represents a multi-cycle execution unit (multiplier or divider).
+	A command is issued to the unit when it is performed in EXE, its result is computed right away
+	but written to the register file only 'latency' cycles later (by SimCore::Operate).
+	A pipelined unit accepts a new command every cycle, an unpipelined unit is busy until its last result is written.
+	*/
+	class FunctionalUnit
+	{
+	public:
+		/*! FunctionalUnit::InFlight
+		A command issued to the unit whose result is not written yet
+		*/
+		struct InFlight {
+			int dst;
+			int32_t result;
+			uint32_t issue_cycle;
+			uint32_t ready_cycle;
+		};
+
+		/*! FunctionalUnit::FunctionalUnit
+		\param[in] owner This unit owner
+		\param[in] latency Number of cycles to produce a result
+		\param[in] is_pipelined Whether the unit accepts a new command every cycle
+		*/
+		FunctionalUnit(SimCore& owner, uint32_t latency, bool is_pipelined) : 
+			m_core_owner(owner), m_latency(latency), mf_is_pipelined(is_pipelined) {}
+
+		/*! FunctionalUnit::~FunctionalUnit
+		Destructor
+		*/
+		~FunctionalUnit() {}
+
+		/*! FunctionalUnit::Configure
+		\param[in] latency Number of cycles to produce a result
+		\param[in] is_pipelined Whether the unit accepts a new command every cycle
+		*/
+		void Configure(uint32_t latency, bool is_pipelined) {
+			m_latency = latency;
+			mf_is_pipelined = is_pipelined;
+		}
+
+		uint32_t Latency() const { return m_latency; }
+
+		bool IsPipelined() const { return mf_is_pipelined; }
+
+		/*! FunctionalUnit::Issue
+		Starts a command on the current cycle
+		\param[in] dst The destination register of the command
+		\param[in] result The computed result, written back when the latency is over
+		*/
+		void Issue(int dst, int32_t result) {
+			const uint32_t cycle = m_core_owner.m_cycle;
+			InFlight command = { dst, result, cycle, cycle + m_latency };
+			m_in_flight.push_back(command);
+		}
+
+		/*! FunctionalUnit::Complete
+		Writes back the results whose latency is over on the current cycle, and keeps them for forwarding to EXE
+		\return true if a register was written
+		*/
+		bool Complete() {
+			const uint32_t cycle = m_core_owner.m_cycle;
+			bool is_written = false;
+			m_completed.clear();
+			//results are kept in issue order, so an older result never overwrites a younger one
+			for (size_t i = 0; i < m_in_flight.size(); ) {
+				if (m_in_flight[i].ready_cycle <= cycle) {
+					m_core_owner.WriteRegister(m_in_flight[i].dst, m_in_flight[i].result);
+					m_completed.push_back(m_in_flight[i]);
+					m_in_flight.erase(m_in_flight.begin() + i);
+					is_written = true;
+				}
+				else i++;
+			}
+			return is_written;
+		}
+
+		/*! FunctionalUnit::Squash
+		Drops the commands issued on or after a cycle (wrong path commands flushed by a branch)
+		\param[in] cycle The first squashed issue cycle
+		*/
+		void Squash(uint32_t cycle) {
+			for (size_t i = 0; i < m_in_flight.size(); ) {
+				if (m_in_flight[i].issue_cycle >= cycle)
+					m_in_flight.erase(m_in_flight.begin() + i);
+				else i++;
+			}
+		}
+
+		/*! FunctionalUnit::PendingWrite
+		\param[in] reg A register index
+		\return the latest cycle on which an in flight command writes the register, 0 if there's none
+		*/
+		uint32_t PendingWrite(int reg) const {
+			uint32_t ready_cycle = 0;
+			for (size_t i = 0; i < m_in_flight.size(); i++) {
+				if (m_in_flight[i].dst == reg)
+					ready_cycle = std::max(ready_cycle, m_in_flight[i].ready_cycle);
+			}
+			return ready_cycle;
+		}
+
+		/*! FunctionalUnit::CompletedResult
+		\param[in] reg A register index
+		\param[out] value The result written to the register on the current cycle
+		\return true if a result was written to the register on the current cycle
+		*/
+		bool CompletedResult(int reg, int32_t& value) const {
+			bool is_found = false;
+			for (size_t i = 0; i < m_completed.size(); i++) {
+				if (m_completed[i].dst == reg && m_completed[i].ready_cycle == m_core_owner.m_cycle) {
+					value = m_completed[i].result;
+					is_found = true;
+				}
+			}
+			return is_found;
+		}
+
+		/*! FunctionalUnit::BusyUntil
+		\return the first cycle on which an unpipelined unit can accept a new command (0 for a pipelined unit)
+		*/
+		uint32_t BusyUntil() const {
+			if (mf_is_pipelined) return 0;
+
+			uint32_t ready_cycle = 0;
+			for (size_t i = 0; i < m_in_flight.size(); i++)
+				ready_cycle = std::max(ready_cycle, m_in_flight[i].ready_cycle);
+			return ready_cycle;
+		}
+
+		/*! FunctionalUnit::InFlightCommands
+		\return the commands in flight, for snapshots
+		*/
+		const std::vector<InFlight>& InFlightCommands() const { return m_in_flight; }
+
+		/*! FunctionalUnit::SetInFlightCommands
+		\param[in] in_flight The commands in flight, restored from a snapshot
+		*/
+		void SetInFlightCommands(const std::vector<InFlight>& in_flight) {
+			m_in_flight = in_flight;
+			m_completed.clear();
+		}
+
+	private:
+		/*! FunctionalUnit::m_core_owner
+		A reference to a SimCore class, the owner that holds this functional unit
+		*/
+		SimCore& m_core_owner;
+
+		uint32_t m_latency;
+		bool mf_is_pipelined;
+
+		/*! FunctionalUnit::m_in_flight
+		Issued commands whose result is not written yet, in issue order
+		*/
+		std::vector<InFlight> m_in_flight;
+
+		/*! FunctionalUnit::m_completed
+		Commands whose result was written on the current cycle, forwarded to EXE
+		*/
+		std::vector<InFlight> m_completed;
+	};
+
+	/*! BbvProfiler
+	A class that divides the committed command stream into intervals of a fixed number of commands,
+	and records for each interval how many commands were committed in each basic block (its basic-block vector).
+	A basic block is identified by the pc of its first command: the first committed command,
+	and every command committed after a branch (taken or not).
+	Profiling is disabled while the interval length is 0.
+	*/
+	class BbvProfiler
+	{
+	public:
+		/*! BbvProfiler::Interval
+		A completed interval: its cycles and its basic-block vector, ordered by block pc
+		*/
+		struct Interval {
+			uint32_t start_cycle;
+			uint32_t cycles;
+			std::vector<std::pair<uint32_t, uint32_t> > blocks;
+		};
+
+		/*! BbvProfiler::State
+		The profiling state of the interval in progress, saved in snapshots.
+		Completed intervals are only appended, so a snapshot holds their number
+		*/
+		struct State {
+			std::map<uint32_t, uint32_t> blocks;
+			uint32_t start_cycle;
+			uint32_t committed;
+			int32_t block_pc;
+			bool is_block_start;
+			size_t completed_intervals;
+		};
+
+		/*! BbvProfiler::BbvProfiler
+		\param[in] owner This profiler owner
+		*/
+		BbvProfiler(SimCore& owner) : m_core_owner(owner), m_interval_length(0) {
+			Reset();
+		}
+
+		/*! BbvProfiler::SetIntervalLength
+		Sets the number of committed commands in an interval and clears the profile
+		\param[in] length Number of committed commands in an interval, 0 disables profiling
+		*/
+		void SetIntervalLength(uint32_t length) {
+			m_interval_length = length;
+			Reset();
+		}
+
+		/*! BbvProfiler::Reset
+		Clears the profile, the next committed command starts the first interval and a basic block
+		*/
+		void Reset() {
+			m_intervals.clear();
+			m_state.blocks.clear();
+			m_state.start_cycle = 0;
+			m_state.committed = 0;
+			m_state.block_pc = 0;
+			m_state.is_block_start = true;
+			m_state.completed_intervals = 0;
+		}
+
+		/*! BbvProfiler::Commit
+		Records a command committed in WB on the current cycle, and closes the interval when it is full
+		\param[in] pc The command pc
+		\param[in] opcode The command opcode
+		*/
+		void Commit(int32_t pc, SIM_cmd_opcode opcode) {
+			if (0 == m_interval_length) return;
+
+			if (m_state.is_block_start) {
+				m_state.block_pc = pc;
+				m_state.is_block_start = false;
+			}
+			m_state.blocks[m_state.block_pc]++;
+
+			//the command following a branch starts a new basic block
+			if (CMD_BR == opcode || CMD_BREQ == opcode || CMD_BRNEQ == opcode)
+				m_state.is_block_start = true;
+
+			if (++m_state.committed < m_interval_length) return;
+
+			const uint32_t cycle = m_core_owner.m_cycle;
+			Interval interval = { m_state.start_cycle, cycle - m_state.start_cycle + 1,
+				std::vector<std::pair<uint32_t, uint32_t> >(m_state.blocks.begin(), m_state.blocks.end()) };
+			m_intervals.push_back(interval);
+
+			m_state.blocks.clear();
+			m_state.start_cycle = cycle + 1;
+			m_state.committed = 0;
+			m_state.completed_intervals = m_intervals.size();
+		}
+
+		uint32_t IntervalLength() const { return m_interval_length; }
+
+		/*! BbvProfiler::Intervals
+		\return the completed intervals, oldest first
+		*/
+		const std::vector<Interval>& Intervals() const { return m_intervals; }
+
+		/*! BbvProfiler::GetState
+		\return the profiling state, for snapshots
+		*/
+		const State& GetState() const { return m_state; }
+
+		/*! BbvProfiler::SetState
+		Restores a state taken by GetState, the intervals completed after it are dropped
+		\param[in] state The profiling state, restored from a snapshot
+		*/
+		void SetState(const State& state) {
+			m_state = state;
+			if (m_intervals.size() > state.completed_intervals)
+				m_intervals.resize(state.completed_intervals);
+		}
+
+	private:
+		/*! BbvProfiler::m_core_owner
+		A reference to a SimCore class, the owner that holds this profiler
+		*/
+		SimCore& m_core_owner;
+
+		/*! BbvProfiler::m_interval_length
+		Number of committed commands in an interval, 0 if profiling is disabled
+		*/
+		uint32_t m_interval_length;
+
+		State m_state;
+		std::vector<Interval> m_intervals;
+	};
+
 public:
 	/*! SimCore::Simcore
 	Allocates enough space for the container to hold 5 pipe stages, and reset all flags
 	*/
-	SimCore() : m_update_flag(true), m_forwarding_unit(*this), m_hazard_detection_unit(*this), mf_is_hazard(false){
+	SimCore() : m_update_flag(true), m_forwarding_unit(*this), m_hazard_detection_unit(*this), mf_is_hazard(false),
+				m_cycle(0), m_snapshot_interval(SIM_SNAPSHOT_INTERVAL),
+				m_multiplier(*this, SIM_MUL_LATENCY, true), m_divider(*this, SIM_DIV_LATENCY, false), m_bbv_profiler(*this) {
 		m_stages.resize(SIM_PIPELINE_DEPTH);
 		m_stages[0] = new InstructionFetch(*this);
 		m_stages[1] = new InstructionDecode(*this);
@@ -719,6 +1193,207 @@ public:
 		return this->m_machine_state;
 	}
 
+	/*! SimCore::ClockTick
+	Advances the core by one clock cycle: takes a snapshot if the cycle is on the snapshot interval,
+	updates the machine state and operates all the pipe stages
+	*/
+	void ClockTick() {
+		if (0 == m_cycle % m_snapshot_interval)
+			TakeSnapshot();
+
+		UpdateMachineState();
+		Operate();
+		m_cycle++;
+	}
+
+	/*! SimCore::ResetHistory
+	Clears the cycle counter, the timing statistics, the basic-block profile, the snapshots and the undo log (a new simulation starts).
+	The control flags, the stages internal values and the multi-cycle units are cleared as well,
+	so the core can be reset more than once in a process
+	*/
+	void ResetHistory() {
+		const StageState cleared_stage = { 0, { 0, 0 }, false };
+		for (int i = 0; i < SIM_PIPELINE_DEPTH; i++)
+			m_stages[i]->RestoreState(cleared_stage);
+		m_multiplier.SetInFlightCommands(std::vector<FunctionalUnit::InFlight>());
+		m_divider.SetInFlightCommands(std::vector<FunctionalUnit::InFlight>());
+		m_update_flag = true;
+		mf_is_hazard = false;
+
+		m_cycle = 0;
+		memset(&m_timing_stats, 0x0, sizeof(m_timing_stats));
+		m_bbv_profiler.Reset();
+		m_snapshots.clear();
+		m_undo_log.clear();
+	}
+
+	/*! SimCore::SetSnapshotInterval
+	\param[in] interval Number of cycles between two snapshots. Affects only the snapshots taken from now on
+	\return true on success, false if the interval is 0
+	*/
+	bool SetSnapshotInterval(uint32_t interval) {
+		if (0 == interval) return false;
+		m_snapshot_interval = interval;
+		return true;
+	}
+
+	/*! SimCore::Cycle
+	\return the number of cycles simulated since the last reset
+	*/
+	uint32_t Cycle() const {
+		return m_cycle;
+	}
+
+	/*! SimCore::TimingStats
+	\return the timing statistics since the last reset
+	*/
+	SIM_timingStats TimingStats() const {
+		SIM_timingStats stats = m_timing_stats;
+		stats.cycles = m_cycle;
+		return stats;
+	}
+
+	/*! SimCore::SetBbvInterval
+	\param[in] length Number of committed commands in a profiled interval, 0 disables profiling
+	*/
+	void SetBbvInterval(uint32_t length) {
+		m_bbv_profiler.SetIntervalLength(length);
+	}
+
+	/*! SimCore::BbvIntervalCount
+	\return the number of completed profiled intervals
+	*/
+	uint32_t BbvIntervalCount() const {
+		return (uint32_t)m_bbv_profiler.Intervals().size();
+	}
+
+	/*! SimCore::GetBbv
+	\param[in] interval A completed interval index
+	\param[out] info The interval cycles and size (ignored if NULL)
+	\param[out] block_pcs The basic blocks first command pc, ordered (ignored if NULL)
+	\param[out] block_counts The number of commands committed in each basic block (ignored if NULL)
+	\return false if the interval is not completed
+	*/
+	bool GetBbv(uint32_t interval, SIM_bbvInterval* info, uint32_t* block_pcs, uint32_t* block_counts) const {
+		const std::vector<BbvProfiler::Interval>& intervals = m_bbv_profiler.Intervals();
+		if (interval >= intervals.size()) return false;
+
+		const BbvProfiler::Interval& profiled = intervals[interval];
+		if (NULL != info) {
+			info->startCycle = profiled.start_cycle;
+			info->cycles = profiled.cycles;
+			info->commands = m_bbv_profiler.IntervalLength();
+			info->blockCount = (uint32_t)profiled.blocks.size();
+		}
+		for (size_t i = 0; i < profiled.blocks.size(); i++) {
+			if (NULL != block_pcs) block_pcs[i] = profiled.blocks[i].first;
+			if (NULL != block_counts) block_counts[i] = profiled.blocks[i].second;
+		}
+		return true;
+	}
+
+	/*! SimCore::GotoCycle
+	Moves the machine (core and memory) to a given cycle.
+	Moving forward simply simulates the missing cycles.
+	Moving backwards:
+		1. Find the latest snapshot taken at or before the target cycle
+		2. Undo all the register and memory writes logged after that snapshot (newest first)
+		3. Restore the pipe latches, the control flags and the memory timing state from the snapshot
+		4. Simulate forward from the snapshot cycle up to the target cycle
+	Hence the simulation cost of moving backwards is bounded by the snapshot interval.
+	\param[in] cycle The target cycle
+	*/
+	void GotoCycle(uint32_t cycle) {
+		if (cycle < m_cycle) {
+			std::vector<Snapshot>::iterator snapshot_it =
+				std::upper_bound(m_snapshots.begin(), m_snapshots.end(), cycle, Snapshot::CycleLess);
+			
+			//the first snapshot is taken at cycle 0, so there is always one at or before the target
+			--snapshot_it;
+
+			while (m_undo_log.size() > snapshot_it->undo_log_size) {
+				const UndoRecord& record = m_undo_log.back();
+				if (record.is_memory)
+					SIM_MemDataPoke(record.location, record.old_value);
+				else
+					m_machine_state.regFile[record.location] = record.old_value;
+				m_undo_log.pop_back();
+			}
+
+			RestoreSnapshot(*snapshot_it);
+			m_snapshots.erase(snapshot_it + 1, m_snapshots.end());
+		}
+
+		while (m_cycle < cycle) {
+			ClockTick();
+			SIM_MemClkTick();
+		}
+	}
+
+	/*! SimCore::WriteRegister
+	Writes a value to the register file, logging the overwritten value for reverse execution
+	\param[in] index The register index
+	\param[in] value The value to write
+	*/
+	void WriteRegister(int index, int32_t value) {
+		UndoRecord record = { false, (uint32_t)index, m_machine_state.regFile[index] };
+		m_undo_log.push_back(record);
+		m_machine_state.regFile[index] = value;
+	}
+
+	/*! SimCore::WriteMemory
+	Writes a value to the data memory, logging the overwritten value for reverse execution
+	\param[in] addr The data memory address
+	\param[in] value The value to write
+	*/
+	void WriteMemory(uint32_t addr, int32_t value) {
+		UndoRecord record = { true, addr, SIM_MemDataPeek(addr) };
+		m_undo_log.push_back(record);
+		SIM_MemDataWrite(addr, value);
+	}
+
+	/*! SimCore::SetFunctionalUnit
+	Configures the multi-cycle unit of MUL or DIV
+	\param[in] opcode CMD_MUL or CMD_DIV
+	\param[in] latency Number of cycles to produce a result
+	\param[in] is_pipelined Whether the unit accepts a new command every cycle
+	\return true on success, false for an invalid opcode or latency
+	*/
+	bool SetFunctionalUnit(SIM_cmd_opcode opcode, uint32_t latency, bool is_pipelined) {
+		if ((CMD_MUL != opcode && CMD_DIV != opcode) || 0 == latency) return false;
+		UnitOf(opcode).Configure(latency, is_pipelined);
+		return true;
+	}
+
+	/*! SimCore::UnitOf
+	\param[in] opcode CMD_MUL or CMD_DIV
+	\return the functional unit executing the command
+	*/
+	FunctionalUnit& UnitOf(SIM_cmd_opcode opcode) {
+		return (CMD_DIV == opcode) ? m_divider : m_multiplier;
+	}
+
+	/*! SimCore::PendingWrite
+	\param[in] EXE_cmd The command in EXE stage (issued on this cycle)
+	\param[in] reg A register index
+	\return the latest cycle on which a multi-cycle command writes the register, 0 if there's none
+	*/
+	uint32_t PendingWrite(SIM_cmd const& EXE_cmd, int reg) {
+		uint32_t ready_cycle = std::max(m_multiplier.PendingWrite(reg), m_divider.PendingWrite(reg));
+		if ((CMD_MUL == EXE_cmd.opcode || CMD_DIV == EXE_cmd.opcode) && EXE_cmd.dst == reg)
+			ready_cycle = std::max(ready_cycle, m_cycle + UnitOf(EXE_cmd.opcode).Latency());
+		return ready_cycle;
+	}
+
+	/*! SimCore::CompletedResult
+	\param[in] reg A register index
+	\param[out] value The result a multi-cycle unit wrote to the register on this cycle
+	\return true if a multi-cycle unit wrote the register on this cycle
+	*/
+	bool CompletedResult(int reg, int32_t& value) const {
+		return m_multiplier.CompletedResult(reg, value) || m_divider.CompletedResult(reg, value);
+	}
+
 	/*! SimCore::Operate
 	Implements the pipe operation as follows:
 		1.	Perform WB stage
@@ -729,10 +1404,15 @@ public:
 				flush WB stage and operate on MEM stage again
 
 		NOTE: Two phase register read-write is implemented by first operate on WB stage and only then on ID stage
+		Multi-cycle units write their completed results right after WB.
 	*/
 	void Operate() {
 		//all stages operate in parallel, although WB stage has to write first to the register file before decode stage gets the values
 		m_stages[SIM_PIPELINE_DEPTH - 1]->Perform();
+		//multi-cycle units write back together with WB (after it, their commands are younger)
+		bool is_unit_written = m_multiplier.Complete();
+		is_unit_written = m_divider.Complete() || is_unit_written;
+
 		//if the memory read hasn't stalled, execute all pipeline stages
 		if (m_update_flag){
 			for (size_t i = SIM_PIPELINE_DEPTH - 1; i > 0; i--)
@@ -742,6 +1422,9 @@ public:
 		else {
 			Flush(SIM_PIPELINE_DEPTH - 1);
 			m_stages[SIM_PIPELINE_DEPTH - 2]->Perform();
+			//a stalled ID command has to see the results written by the multi-cycle units
+			if (is_unit_written)
+				m_stages[SIM_PIPELINE_DEPTH - 4]->Perform();
 		}
 	}
 
@@ -777,7 +1460,8 @@ public:
 		If we have a hazard in the pipe and we don't branch:
 			1. Propagate EXE and MEM struct values to MEM and WB accordingly
 			2. Invoke WB, MEM, EXE Propagate
-			3. Insert a NOP instruction in EXE stage and reset the hazard flag
+			3. Insert a NOP instruction in EXE stage
+			4. Invoke the hazard detection unit again (multi-cycle commands may stall for more than one cycle)
 
 		Else 
 			1. If there's a branch:
@@ -832,18 +1516,25 @@ public:
 
 				Flush(SIM_PIPELINE_DEPTH - 3);
 
-				mf_is_hazard = false;
+				//a load hazard is resolved by a single bubble, a multi-cycle command may need more
+				mf_is_hazard = m_hazard_detection_unit();
+				m_timing_stats.hazardStalls++;
 			}
 
 			else{
 				if (is_branch) {
 					FlushUntil(SIM_PIPELINE_DEPTH - 2);
 
+					//the flushed EXE command was performed on the previous cycle, drop its multi-cycle result
+					m_multiplier.Squash(m_cycle - 1);
+					m_divider.Squash(m_cycle - 1);
+
 					//use the old values of memory stage to set the pc before it's updated
 					SetProgramCounter(dynamic_cast<Memory*>(m_stages[SIM_PIPELINE_DEPTH - 2])->m_EXE_calculations.EXE_calculation);
 						
 					//put down the flag
 					is_branch = false;
+					m_timing_stats.branchFlushes++;
 				}
 					//update the machine
 				PipeStage this_stage_dat = { m_machine_state.pipeStageState[0].cmd,
@@ -884,6 +1575,7 @@ public:
 			//there's a memory stall, Flush WB stage
 		else{
 			Flush(SIM_PIPELINE_DEPTH - 1);
+			m_timing_stats.memoryStalls++;
 			return;
 		}
 	}
@@ -904,6 +1596,81 @@ public:
 	}
 
 private:
+	/*! SimCore::Snapshot
+	The micro-architectural state of the machine at the beginning of a cycle:
+	pipe latches (SIM_coreState), private stage latches, control flags and the memory timing state.
+	The architectural state (register file and data memory) is not restored from the snapshot,
+	it is recovered by undoing the writes logged after undo_log_size.
+	*/
+	struct Snapshot {
+		uint32_t cycle;
+		size_t undo_log_size;
+		SIM_coreState machine_state;
+		StageState stages[SIM_PIPELINE_DEPTH];
+		bool is_hazard;
+		bool update_flag;
+		SIM_memState memory_state;
+		std::vector<FunctionalUnit::InFlight> multiplier_state;
+		std::vector<FunctionalUnit::InFlight> divider_state;
+		SIM_timingStats timing_stats;
+		BbvProfiler::State bbv_state;
+
+		static bool CycleLess(uint32_t cycle, const Snapshot& snapshot) {
+			return cycle < snapshot.cycle;
+		}
+	};
+
+	/*! SimCore::UndoRecord
+	A single logged write: the register index or data memory address and the value it held before the write
+	*/
+	struct UndoRecord {
+		bool is_memory;
+		uint32_t location;
+		int32_t old_value;
+	};
+
+	/*! SimCore::TakeSnapshot
+	Saves the current machine state (see SimCore::Snapshot) at the end of the snapshots container
+	*/
+	void TakeSnapshot() {
+		//after moving backwards the snapshot of the restored cycle is already held
+		if (!m_snapshots.empty() && m_snapshots.back().cycle == m_cycle) return;
+
+		m_snapshots.push_back(Snapshot());
+		Snapshot& snapshot = m_snapshots.back();
+		snapshot.cycle = m_cycle;
+		snapshot.undo_log_size = m_undo_log.size();
+		snapshot.machine_state = m_machine_state;
+		for (size_t i = 0; i < SIM_PIPELINE_DEPTH; i++)
+			m_stages[i]->SaveState(snapshot.stages[i]);
+		snapshot.is_hazard = mf_is_hazard;
+		snapshot.update_flag = m_update_flag;
+		SIM_MemGetState(&snapshot.memory_state);
+		snapshot.multiplier_state = m_multiplier.InFlightCommands();
+		snapshot.divider_state = m_divider.InFlightCommands();
+		snapshot.timing_stats = m_timing_stats;
+		snapshot.bbv_state = m_bbv_profiler.GetState();
+	}
+
+	/*! SimCore::RestoreSnapshot
+	Restores the micro-architectural state saved by TakeSnapshot (the register file is left untouched)
+	\param[in] snapshot The snapshot to restore
+	*/
+	void RestoreSnapshot(const Snapshot& snapshot) {
+		m_cycle = snapshot.cycle;
+		m_machine_state.pc = snapshot.machine_state.pc;
+		memcpy(m_machine_state.pipeStageState, snapshot.machine_state.pipeStageState, sizeof(m_machine_state.pipeStageState));
+		for (size_t i = 0; i < SIM_PIPELINE_DEPTH; i++)
+			m_stages[i]->RestoreState(snapshot.stages[i]);
+		mf_is_hazard = snapshot.is_hazard;
+		m_update_flag = snapshot.update_flag;
+		SIM_MemSetState(&snapshot.memory_state);
+		m_multiplier.SetInFlightCommands(snapshot.multiplier_state);
+		m_divider.SetInFlightCommands(snapshot.divider_state);
+		m_timing_stats = snapshot.timing_stats;
+		m_bbv_profiler.SetState(snapshot.bbv_state);
+	}
+
 	/*! SimCore::m_stages
 	A container that holds 5 pointers represting the PipeStages.
 	Since PipeStage is abstract the pointers should point to one of PipeStage's derived classes
@@ -943,6 +1710,46 @@ private:
 	A flag that indicates if the machine can be updated. If false, this means we have a memory stall in the pipe.
 	*/
 	bool m_update_flag;
+
+	/*! SimCore::m_cycle
+	Number of cycles simulated since the last reset
+	*/
+	uint32_t m_cycle;
+
+	/*! SimCore::m_snapshot_interval
+	Number of cycles between two snapshots
+	*/
+	uint32_t m_snapshot_interval;
+
+	/*! SimCore::m_snapshots
+	Snapshots taken every m_snapshot_interval cycles, ordered by cycle
+	*/
+	std::vector<Snapshot> m_snapshots;
+
+	/*! SimCore::m_undo_log
+	All the register and data memory writes since the last reset, oldest first
+	*/
+	std::vector<UndoRecord> m_undo_log;
+
+	/*! SimCore::m_multiplier
+	Multi-cycle unit executing MUL commands
+	*/
+	FunctionalUnit m_multiplier;
+
+	/*! SimCore::m_divider
+	Multi-cycle unit executing DIV commands
+	*/
+	FunctionalUnit m_divider;
+
+	/*! SimCore::m_timing_stats
+	Timing statistics since the last reset (the cycles field is taken from m_cycle)
+	*/
+	SIM_timingStats m_timing_stats;
+
+	/*! SimCore::m_bbv_profiler
+	Basic-block vector profiler of the committed commands
+	*/
+	BbvProfiler m_bbv_profiler;
 };
 
 /*! machine_core
@@ -957,13 +1764,13 @@ int SIM_CoreReset(void)
 	SIM_coreState & machine_state =  machine_core.GetMachineState();
 	void* res = memset((void*)&machine_state, 0x0, sizeof(SIM_coreState));
 	SIM_MemInstRead(machine_state.pc, &machine_state.pipeStageState[0].cmd);
+	machine_core.ResetHistory();
 	return res != NULL ? 0 : -1;
 }
 
 void SIM_CoreClkTick(void)
 {
-	machine_core.UpdateMachineState();
-	machine_core.Operate();
+	machine_core.ClockTick();
 }
 
 void SIM_CoreGetState(SIM_coreState *curState)
@@ -975,3 +1782,65 @@ void SIM_CoreGetState(SIM_coreState *curState)
 
 	return;
 }
+
+int SIM_CoreSetSnapshotInterval(uint32_t interval)
+{
+	return machine_core.SetSnapshotInterval(interval) ? 0 : -1;
+}
+
+uint32_t SIM_CoreGetCycle(void)
+{
+	return machine_core.Cycle();
+}
+
+int SIM_StepBack(uint32_t n)
+{
+	if (n > machine_core.Cycle())
+		return -1;
+
+	machine_core.GotoCycle(machine_core.Cycle() - n);
+	return 0;
+}
+
+int SIM_GotoCycle(uint32_t cycle)
+{
+	machine_core.GotoCycle(cycle);
+	return 0;
+}
+
+int SIM_CoreSetFuncUnit(SIM_cmd_opcode opcode, uint32_t latency, bool isPipelined)
+{
+	return machine_core.SetFunctionalUnit(opcode, latency, isPipelined) ? 0 : -1;
+}
+
+int SIM_CoreGetFuncUnit(SIM_cmd_opcode opcode, uint32_t *latency, bool *isPipelined)
+{
+	if (CMD_MUL != opcode && CMD_DIV != opcode)
+		return -1;
+
+	if (NULL != latency) *latency = machine_core.UnitOf(opcode).Latency();
+	if (NULL != isPipelined) *isPipelined = machine_core.UnitOf(opcode).IsPipelined();
+	return 0;
+}
+
+void SIM_CoreGetTimingStats(SIM_timingStats *stats)
+{
+	if (NULL != stats)
+		*stats = machine_core.TimingStats();
+}
+
+int SIM_CoreSetBbvInterval(uint32_t interval)
+{
+	machine_core.SetBbvInterval(interval);
+	return 0;
+}
+
+uint32_t SIM_CoreGetBbvIntervalCount(void)
+{
+	return machine_core.BbvIntervalCount();
+}
+
+int SIM_CoreGetBbv(uint32_t interval, SIM_bbvInterval *info, uint32_t *blockPcs, uint32_t *blockCounts)
+{
+	return machine_core.GetBbv(interval, info, blockPcs, blockCounts) ? 0 : -1;
+}
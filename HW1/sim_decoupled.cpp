@@ -0,0 +1,446 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #1 */
+/* Decoupled functional / timing simulation of the pipelined core on two host threads */
+
+#include "sim_api.h"
+#include "sim_functional.h"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+/*! SpscQueue
+A lock-free, bounded, single-producer single-consumer ring buffer.
+The producer only writes m_tail and the consumer only writes m_head, each index is published with release semantics
+and read with acquire semantics by the other side, so an element is fully written before it is visible to the consumer.
+The two indices live on separate cache lines to avoid false sharing between the two host cores.
+\tparam T The element type
+\tparam LogCapacity log2 of the number of elements
+*/
+template <typename T, unsigned LogCapacity>
+class SpscQueue
+{
+public:
+	SpscQueue() : m_head(0), m_tail(0) {
+		m_buffer.resize(Capacity);
+	}
+
+	/*! SpscQueue::TryPush
+	\param[in] value The element to enqueue (producer side only)
+	\return false if the queue is full
+	*/
+	bool TryPush(const T& value) {
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		m_buffer[tail & (Capacity - 1)] = value;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*! SpscQueue::TryPop
+	\param[out] value The dequeued element (consumer side only)
+	\return false if the queue is empty
+	*/
+	bool TryPop(T& value) {
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (m_tail.load(std::memory_order_acquire) == head)
+			return false;
+
+		value = m_buffer[head & (Capacity - 1)];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	static const size_t Capacity = (size_t)1 << LogCapacity;
+
+	std::vector<T> m_buffer;
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) std::atomic<size_t> m_tail;
+};
+
+typedef SpscQueue<ExecutedCmd, 12> CmdQueue;
+
+/*! FunctionalFrontEnd
+Executes the program architecturally (no pipeline) and streams every executed command to the timing back-end.
+Data memory is read with SIM_MemDataPeek, so it does not disturb the memory timing driven by the back-end.
+Stores are kept in a private overlay: the back-end performs the same stores on the memory simulator later,
+and an address is never peeked after the front-end has stored to it.
+*/
+class FunctionalFrontEnd : public FunctionalContext
+{
+public:
+	/*! FunctionalFrontEnd::FunctionalFrontEnd
+	\param[in] queue The queue to the back-end
+	\param[in] stop A flag raised by the back-end when it doesn't need more commands
+	*/
+	FunctionalFrontEnd(CmdQueue& queue, std::atomic<bool>& stop) : m_queue(queue), mf_stop(stop) {}
+
+	/*! FunctionalFrontEnd::Run
+	Executes up to max_cmds commands (the pipe can not fetch more than one correct path command per cycle,
+	so the front-end never reads instructions the core would not fetch)
+	\param[in] max_cmds Maximal number of commands to execute
+	*/
+	void Run(uint32_t max_cmds) {
+		for (uint32_t i = 0; i < max_cmds; i++) {
+			ExecutedCmd executed;
+			Execute(executed);
+
+			while (!m_queue.TryPush(executed)) {
+				if (mf_stop.load(std::memory_order_relaxed)) return;
+				std::this_thread::yield();
+			}
+		}
+	}
+
+protected:
+	/*! FunctionalFrontEnd::ReadData (virtual)
+	\param[in] addr A data memory address
+	\return the latest value stored by the front-end, or the memory simulator value if it never stored to the address
+	*/
+	virtual int32_t ReadData(uint32_t addr) {
+		std::map<uint32_t, int32_t>::const_iterator it = m_stores.find(addr);
+		return (m_stores.end() != it) ? it->second : SIM_MemDataPeek(addr);
+	}
+
+	/*! FunctionalFrontEnd::WriteData (virtual)
+	The store is only recorded in the overlay, the back-end writes it to the memory simulator
+	*/
+	virtual void WriteData(uint32_t addr, int32_t value) {
+		m_stores[addr] = value;
+	}
+
+private:
+	CmdQueue& m_queue;
+	std::atomic<bool>& mf_stop;
+
+	/*! FunctionalFrontEnd::m_stores
+	Data memory overlay of the stores executed by the front-end
+	*/
+	std::map<uint32_t, int32_t> m_stores;
+};
+
+/*! TimingBackEnd
+Models only the occupancy of the 5 pipe stages by the commands streamed from the front-end.
+The control rules mirror SimCore::UpdateMachineState, SimCore::Operate and SimCore::HDU one to one, so the
+timing statistics match the core cycle by cycle:
+	- a hazard inserts a bubble in EXE and holds IF and ID
+	- a taken branch is resolved in MEM and flushes IF, ID and EXE
+	- a LOAD wait-state freezes the pipe and flushes WB
+	- MUL and DIV occupy their (pipelined or unpipelined) unit for their latency
+The wrong path commands fetched after a taken branch are read from the instruction memory by the back-end itself,
+since they can stall in ID and occupy a functional unit (until squashed) in the core as well.
+*/
+class TimingBackEnd
+{
+	/*! TimingBackEnd::Slot
+	The content of a pipe stage, a bubble is an all-zero (NOP) slot
+	*/
+	struct Slot {
+		ExecutedCmd executed;
+		bool is_wrong_path;
+	};
+
+	/*! TimingBackEnd::UnitTiming
+	Timing model of a multi-cycle functional unit (see SimCore::FunctionalUnit), only the destination and the cycles are kept
+	*/
+	struct UnitTiming {
+		struct InFlight {
+			int dst;
+			uint32_t issue_cycle;
+			uint32_t ready_cycle;
+		};
+
+		uint32_t latency;
+		bool is_pipelined;
+		std::vector<InFlight> in_flight;
+
+		void Issue(int dst, uint32_t cycle) {
+			InFlight command = { dst, cycle, cycle + latency };
+			in_flight.push_back(command);
+		}
+
+		void Complete(uint32_t cycle) {
+			for (size_t i = 0; i < in_flight.size(); ) {
+				if (in_flight[i].ready_cycle <= cycle) in_flight.erase(in_flight.begin() + i);
+				else i++;
+			}
+		}
+
+		void Squash(uint32_t cycle) {
+			for (size_t i = 0; i < in_flight.size(); ) {
+				if (in_flight[i].issue_cycle >= cycle) in_flight.erase(in_flight.begin() + i);
+				else i++;
+			}
+		}
+
+		uint32_t PendingWrite(int reg) const {
+			uint32_t ready_cycle = 0;
+			for (size_t i = 0; i < in_flight.size(); i++) {
+				if (in_flight[i].dst == reg) ready_cycle = std::max(ready_cycle, in_flight[i].ready_cycle);
+			}
+			return ready_cycle;
+		}
+
+		uint32_t BusyUntil() const {
+			if (is_pipelined) return 0;
+
+			uint32_t ready_cycle = 0;
+			for (size_t i = 0; i < in_flight.size(); i++)
+				ready_cycle = std::max(ready_cycle, in_flight[i].ready_cycle);
+			return ready_cycle;
+		}
+	};
+
+public:
+	/*! TimingBackEnd::TimingBackEnd
+	\param[in] queue The queue from the front-end
+	\param[in] stop A flag raised when the back-end doesn't need more commands
+	*/
+	TimingBackEnd(CmdQueue& queue, std::atomic<bool>& stop) : m_queue(queue), mf_stop(stop),
+		m_cycle(0), mf_is_hazard(false), mf_update(true), mf_wrong_path(false), m_wrong_path_pc(0) {
+		memset(m_stages, 0x0, sizeof(m_stages));
+		memset(&m_stats, 0x0, sizeof(m_stats));
+		SIM_CoreGetFuncUnit(CMD_MUL, &m_multiplier.latency, &m_multiplier.is_pipelined);
+		SIM_CoreGetFuncUnit(CMD_DIV, &m_divider.latency, &m_divider.is_pipelined);
+	}
+
+	/*! TimingBackEnd::Run
+	Simulates the given number of cycles (core and memory clocks) and raises the stop flag
+	\param[in] cycles Number of cycles to simulate
+	*/
+	void Run(uint32_t cycles) {
+		Fetch(m_stages[IF]);
+		for (uint32_t i = 0; i < cycles; i++) {
+			Update();
+			Operate();
+			m_cycle++;
+			SIM_MemClkTick();
+		}
+		mf_stop.store(true, std::memory_order_relaxed);
+	}
+
+	/*! TimingBackEnd::Stats
+	\return the timing statistics of the simulated cycles
+	*/
+	SIM_timingStats Stats() const {
+		SIM_timingStats stats = m_stats;
+		stats.cycles = m_cycle;
+		return stats;
+	}
+
+private:
+	enum { IF = 0, ID, EXE, MEM, WB };
+
+	/*! TimingBackEnd::Fetch
+	Fetches the next correct path command from the queue, or the next wrong path command after a taken branch
+	\param[out] slot The IF stage
+	*/
+	void Fetch(Slot& slot) {
+		memset(&slot, 0x0, sizeof(slot));
+		if (mf_wrong_path) {
+			SIM_MemInstRead(m_wrong_path_pc, &slot.executed.cmd);
+			slot.executed.pc = m_wrong_path_pc;
+			slot.is_wrong_path = true;
+			m_wrong_path_pc += 4;
+			return;
+		}
+
+		while (!m_queue.TryPop(slot.executed))
+			std::this_thread::yield();
+
+		if (slot.executed.is_taken) {
+			mf_wrong_path = true;
+			m_wrong_path_pc = slot.executed.pc + 4;
+		}
+	}
+
+	void Bubble(Slot& slot) {
+		memset(&slot, 0x0, sizeof(slot));
+	}
+
+	/*! TimingBackEnd::Update
+	Mirrors SimCore::UpdateMachineState
+	*/
+	void Update() {
+		if (!mf_update) {
+			Bubble(m_stages[WB]);
+			m_stats.memoryStalls++;
+			return;
+		}
+
+		//wrong path commands never reach MEM, so the branch outcome of the front-end is the one resolved in MEM
+		const bool is_branch = m_stages[MEM].executed.is_taken;
+		if (mf_is_hazard && !is_branch) {
+			m_stages[WB] = m_stages[MEM];
+			m_stages[MEM] = m_stages[EXE];
+			Bubble(m_stages[EXE]);
+			mf_is_hazard = Hazard();
+			m_stats.hazardStalls++;
+		}
+		else {
+			if (is_branch) {
+				Bubble(m_stages[IF]);
+				Bubble(m_stages[ID]);
+				Bubble(m_stages[EXE]);
+				m_multiplier.Squash(m_cycle - 1);
+				m_divider.Squash(m_cycle - 1);
+				mf_wrong_path = false;
+				m_stats.branchFlushes++;
+			}
+			for (int i = WB; i > IF; i--)
+				m_stages[i] = m_stages[i - 1];
+			Fetch(m_stages[IF]);
+			mf_is_hazard = Hazard();
+		}
+	}
+
+	/*! TimingBackEnd::Operate
+	Mirrors SimCore::Operate: WB and the multi-cycle units complete, then MEM accesses the memory simulator
+	and EXE issues multi-cycle commands. On a memory stall only the LOAD in MEM is retried.
+	*/
+	void Operate() {
+		if (CMD_NOP != m_stages[WB].executed.cmd.opcode)
+			m_stats.committedCmds++;
+		m_multiplier.Complete(m_cycle);
+		m_divider.Complete(m_cycle);
+
+		const bool is_update = mf_update;
+		const ExecutedCmd& MEM_cmd = m_stages[MEM].executed;
+		if (CMD_LOAD == MEM_cmd.cmd.opcode) {
+			int32_t loaded_data;
+			mf_update = (0 <= SIM_MemDataRead(MEM_cmd.addr, &loaded_data));
+		}
+		else if (is_update && CMD_STORE == MEM_cmd.cmd.opcode)
+			SIM_MemDataWrite(MEM_cmd.addr, MEM_cmd.store_value);
+
+		const SIM_cmd& EXE_cmd = m_stages[EXE].executed.cmd;
+		if (is_update && (CMD_MUL == EXE_cmd.opcode || CMD_DIV == EXE_cmd.opcode))
+			UnitOf(EXE_cmd.opcode).Issue(EXE_cmd.dst, m_cycle);
+	}
+
+	/*! TimingBackEnd::Hazard
+	Mirrors SimCore::HDU::operator() (multi-cycle hazards, then the LOAD-use rule)
+	\return true if the ID command has to be stalled
+	*/
+	bool Hazard() {
+		const SIM_cmd& EXE_cmd = m_stages[EXE].executed.cmd;
+		const SIM_cmd& ID_cmd = m_stages[ID].executed.cmd;
+
+		if (MultiCycleHazard(EXE_cmd, ID_cmd))
+			return true;
+
+		if (CMD_LOAD == EXE_cmd.opcode) {
+			if (!(CMD_NOP == ID_cmd.opcode || CMD_BR == ID_cmd.opcode) &&
+				(EXE_cmd.dst == ID_cmd.src1 || EXE_cmd.dst == ID_cmd.src2))
+				return true;
+
+			return (CMD_BR == ID_cmd.opcode || CMD_BREQ == ID_cmd.opcode || CMD_BRNEQ == ID_cmd.opcode) &&
+				ID_cmd.dst == EXE_cmd.dst;
+		}
+
+		return false;
+	}
+
+	/*! TimingBackEnd::MultiCycleHazard
+	Mirrors SimCore::HDU::MultiCycleHazard
+	*/
+	bool MultiCycleHazard(const SIM_cmd& EXE_cmd, const SIM_cmd& ID_cmd) {
+		const uint32_t next_cycle = m_cycle + 1;
+
+		int read_regs[3];
+		int read_count = 0;
+		switch (ID_cmd.opcode)
+		{
+		case CMD_NOP:
+			break;
+		case CMD_BR:
+			read_regs[read_count++] = ID_cmd.dst;
+			break;
+		case CMD_STORE:
+		case CMD_BREQ:
+		case CMD_BRNEQ:
+			read_regs[read_count++] = ID_cmd.dst;
+			//fall through
+		default:
+			read_regs[read_count++] = ID_cmd.src1;
+			if (!ID_cmd.isSrc2Imm) read_regs[read_count++] = ID_cmd.src2;
+			break;
+		}
+
+		for (int i = 0; i < read_count; i++) {
+			if (PendingWrite(EXE_cmd, read_regs[i]) > next_cycle)
+				return true;
+		}
+
+		if ((CMD_ADD == ID_cmd.opcode || CMD_SUB == ID_cmd.opcode || CMD_LOAD == ID_cmd.opcode ||
+			 CMD_MUL == ID_cmd.opcode || CMD_DIV == ID_cmd.opcode) &&
+			PendingWrite(EXE_cmd, ID_cmd.dst) > next_cycle)
+			return true;
+
+		if (CMD_MUL == ID_cmd.opcode || CMD_DIV == ID_cmd.opcode) {
+			const UnitTiming& unit = UnitOf(ID_cmd.opcode);
+			uint32_t busy_until = unit.BusyUntil();
+			if (ID_cmd.opcode == EXE_cmd.opcode && !unit.is_pipelined)
+				busy_until = std::max(busy_until, m_cycle + unit.latency);
+			if (busy_until > next_cycle)
+				return true;
+		}
+
+		return false;
+	}
+
+	uint32_t PendingWrite(const SIM_cmd& EXE_cmd, int reg) {
+		uint32_t ready_cycle = std::max(m_multiplier.PendingWrite(reg), m_divider.PendingWrite(reg));
+		if ((CMD_MUL == EXE_cmd.opcode || CMD_DIV == EXE_cmd.opcode) && EXE_cmd.dst == reg)
+			ready_cycle = std::max(ready_cycle, m_cycle + UnitOf(EXE_cmd.opcode).latency);
+		return ready_cycle;
+	}
+
+	UnitTiming& UnitOf(int opcode) {
+		return (CMD_DIV == opcode) ? m_divider : m_multiplier;
+	}
+
+	CmdQueue& m_queue;
+	std::atomic<bool>& mf_stop;
+	Slot m_stages[SIM_PIPELINE_DEPTH];
+	uint32_t m_cycle;
+	bool mf_is_hazard;
+	bool mf_update;
+
+	/*! TimingBackEnd::mf_wrong_path
+	Raised when a taken branch is fetched, the next fetches are wrong path until the branch flushes the pipe
+	*/
+	bool mf_wrong_path;
+	int32_t m_wrong_path_pc;
+	UnitTiming m_multiplier;
+	UnitTiming m_divider;
+	SIM_timingStats m_stats;
+};
+
+
+
+/*! SIM_DecoupledRun
+Implements SIM_DecoupledRun API function: the front-end runs on a new thread, the back-end on the calling thread.
+The front-end executes at most cycles + 1 commands, the number of commands the core can fetch on the correct path.
+It runs ahead of the back-end (up to the queue capacity), so the program must not run off the end of the loaded
+code block within these commands (the core would read garbage commands there as well, only later).
+*/
+int SIM_DecoupledRun(uint32_t cycles, SIM_timingStats *stats)
+{
+	if (NULL == stats) return -1;
+
+	CmdQueue queue;
+	std::atomic<bool> stop(false);
+	FunctionalFrontEnd front_end(queue, stop);
+	TimingBackEnd back_end(queue, stop);
+
+	std::thread front_end_thread(&FunctionalFrontEnd::Run, &front_end, cycles + 1);
+	back_end.Run(cycles);
+	front_end_thread.join();
+
+	*stats = back_end.Stats();
+	return 0;
+}
@@ -0,0 +1,108 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #1 */
+/* Functional (architectural) execution of commands, shared by the decoupled and the multithreaded simulations */
+
+#ifndef SIM_FUNCTIONAL_H_
+#define SIM_FUNCTIONAL_H_
+
+#include "sim_api.h"
+
+/*! ExecutedCmd
+A single command executed functionally, with everything a timing model needs:
+the command itself (for hazard detection), its pc, the resolved memory address and stored value, and the branch outcome
+*/
+struct ExecutedCmd
+{
+	SIM_cmd cmd;
+	int32_t pc;
+	uint32_t addr;
+	int32_t store_value;
+	bool is_taken;
+};
+
+/*! FunctionalContext
+An architectural context (pc and register file) that executes the program one command at a time,
+with the same semantics as SimCore (a taken branch continues at pc + dst + 4, like the core which increments
+the pc after setting it, and a division by zero yields 0).
+The data memory is accessed through ReadData and WriteData, by default directly on the memory simulator
+without affecting its timing (SIM_MemDataPeek and SIM_MemDataPoke)
+*/
+class FunctionalContext
+{
+public:
+	/*! FunctionalContext::FunctionalContext
+	The context starts at pc 0 with a cleared register file
+	*/
+	FunctionalContext() : m_pc(0) {
+		memset(m_regs, 0x0, sizeof(m_regs));
+	}
+
+	virtual ~FunctionalContext() {}
+
+	/*! FunctionalContext::Execute
+	Executes the command at the current pc and advances the pc
+	\param[out] executed The executed command
+	*/
+	void Execute(ExecutedCmd& executed) {
+		SIM_cmd& cmd = executed.cmd;
+		SIM_MemInstRead(m_pc, &cmd);
+		executed.pc = m_pc;
+		executed.addr = 0;
+		executed.store_value = 0;
+		executed.is_taken = false;
+
+		const int32_t src1_val = m_regs[cmd.src1];
+		const int32_t src2_val = cmd.isSrc2Imm ? cmd.src2 : m_regs[cmd.src2];
+		const int32_t dst_val = m_regs[cmd.dst];
+
+		switch (cmd.opcode)
+		{
+		case CMD_ADD:	m_regs[cmd.dst] = src1_val + src2_val; break;
+		case CMD_SUB:	m_regs[cmd.dst] = src1_val - src2_val; break;
+		case CMD_MUL:	m_regs[cmd.dst] = (int32_t)((int64_t)src1_val * src2_val); break;
+		case CMD_DIV:	m_regs[cmd.dst] = (0 == src2_val) ? 0 : (int32_t)((int64_t)src1_val / src2_val); break;
+		case CMD_LOAD:	{
+						executed.addr = src1_val + src2_val;
+						m_regs[cmd.dst] = ReadData(executed.addr); }
+						break;
+		case CMD_STORE:	{
+						executed.addr = dst_val + src2_val;
+						executed.store_value = src1_val;
+						WriteData(executed.addr, src1_val); }
+						break;
+		case CMD_BR:	executed.is_taken = true; break;
+		case CMD_BREQ:	executed.is_taken = (src1_val == src2_val); break;
+		case CMD_BRNEQ:	executed.is_taken = (src1_val != src2_val); break;
+		default:
+			break;
+		}
+
+		m_pc = executed.is_taken ? (m_pc + dst_val + 4) : (m_pc + 4);
+	}
+
+	int32_t Pc() const { return m_pc; }
+
+	const int32_t* Registers() const { return m_regs; }
+
+protected:
+	/*! FunctionalContext::ReadData (virtual)
+	\param[in] addr A data memory address
+	\return the value a LOAD reads
+	*/
+	virtual int32_t ReadData(uint32_t addr) {
+		return SIM_MemDataPeek(addr);
+	}
+
+	/*! FunctionalContext::WriteData (virtual)
+	\param[in] addr A data memory address
+	\param[in] value The value a STORE writes
+	*/
+	virtual void WriteData(uint32_t addr, int32_t value) {
+		SIM_MemDataPoke(addr, value);
+	}
+
+private:
+	int32_t m_pc;
+	int32_t m_regs[SIM_REGFILE_SIZE];
+};
+
+#endif /* SIM_FUNCTIONAL_H_ */
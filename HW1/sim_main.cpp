@@ -41,17 +41,17 @@ void DumpCoreState(SIM_coreState *state)
 
 int main(int argc, char const *argv[])
 {
-    int i, simDuration;
+    int i, simDuration, gotoCycle;
     ;
     char const *memFname = argv[1];
     char const *simDurationStr = argv[2];
 
     SIM_coreState curState;
 
-    if (argc != 3)
+    if (argc != 3 && argc != 4)
     {
         fprintf(stderr,
-                "Usage: %s <memory image filename> <number of cycles to run>\n",
+                "Usage: %s <memory image filename> <number of cycles to run> [<cycle to go back to>]\n",
                 argv[0]);
         exit(1);
     }
@@ -89,5 +89,20 @@ int main(int argc, char const *argv[])
     SIM_CoreGetState(&curState);
     DumpCoreState(&curState);
 
+    /* Reverse execution */
+    if (argc == 4)
+    {
+        gotoCycle = atoi(argv[3]);
+        if (gotoCycle < 0 || gotoCycle > simDuration)
+        {
+            fprintf(stderr, "Invalid go back cycle argument: %s\n", argv[3]);
+            exit(5);
+        }
+        SIM_GotoCycle(gotoCycle);
+        printf("Went back to cycle %d. The state is:\n", gotoCycle);
+        SIM_CoreGetState(&curState);
+        DumpCoreState(&curState);
+    }
+
     return 0;
 }
@@ -18,7 +18,7 @@ typedef struct
     uint32_t ticks; // for LRU
 } cache_line;
 
-cache_line cache[8];
+cache_line cache[SIM_MEM_CACHE_SIZE];
 
 uint32_t get_start(char *line)
 {
@@ -168,6 +168,10 @@ void get_inst(char *line, int inst_num)
     case 7:
         add_sub_branch(line, inst_num);
         break;
+    case 8: // MUL
+    case 9: // DIV
+        add_sub_branch(line, inst_num);
+        break;
     }
 }
 
@@ -179,6 +183,10 @@ int SIM_MemReset(const char *memImgFname)
     {
         return -1; // can't open img file
     }
+    // reset the timing state, so the memory simulator can be reset more than once in a process
+    ticks = 0;
+    read_tick = 0;
+    memset(cache, 0, sizeof(cache));
     while (fgets(line, 1024, img) != NULL)
     {
         if (line[0] == '#' || line[0] == '\n')   // comment or empty line
@@ -191,7 +199,8 @@ int SIM_MemReset(const char *memImgFname)
             int inst = 0;
             fgets(line, 1024, img);
             // get next instructions
-            while (line[0] != '\n' && line[0] != '#' && line[0] != 'D')
+            // a data block starts with "D@", commands may start with 'D' as well (DIV)
+            while (line[0] != '\n' && line[0] != '#' && !(line[0] == 'D' && line[1] == '@'))
             {
                 get_inst(line, inst);
                 ++inst;
@@ -229,7 +238,7 @@ void SIM_MemClkTick()
 int cache_lookup(uint32_t addr)
 {
     int i;
-    for (i = 0; i < 8; ++i)
+    for (i = 0; i < SIM_MEM_CACHE_SIZE; ++i)
     {
         if (cache[i].addr == addr)
         {
@@ -245,7 +254,7 @@ void insert_to_cache(uint32_t addr)
     int addr_i = addr - data_start;
     addr_i = addr_i / 4;
     // insert if there is an empty space
-    for (i = 0; i < 8; ++i)
+    for (i = 0; i < SIM_MEM_CACHE_SIZE; ++i)
     {
         if (cache[i].valid == 0)
         {
@@ -259,7 +268,7 @@ void insert_to_cache(uint32_t addr)
     // no empty space, find LRU
     int remove = -1;
     int max_ticks = 0;
-    for (i = 0; i < 8; ++i)
+    for (i = 0; i < SIM_MEM_CACHE_SIZE; ++i)
     {
         if ((ticks - cache[i].ticks) > (uint32_t)max_ticks)
         {
@@ -337,3 +346,45 @@ void SIM_MemInstRead(uint32_t addr, SIM_cmd *dst)
     dst->src2 = instructions[addr].src2;
     dst->isSrc2Imm = instructions[addr].isSrc2Imm;
 }
+
+int32_t SIM_MemDataPeek(uint32_t addr)
+{
+    int addr_i = addr - data_start;
+    addr_i = addr_i / 4; // addr is aligned to 4 byte
+    return data[addr_i];
+}
+
+void SIM_MemDataPoke(uint32_t addr, int32_t val)
+{
+    int addr_i = addr - data_start;
+    addr_i = addr_i / 4; // addr is aligned to 4 byte
+    data[addr_i] = val;
+}
+
+void SIM_MemGetState(SIM_memState *state)
+{
+    int i;
+    state->ticks = ticks;
+    state->readTick = read_tick;
+    for (i = 0; i < SIM_MEM_CACHE_SIZE; ++i)
+    {
+        state->cache[i].addr = cache[i].addr;
+        state->cache[i].val = cache[i].val;
+        state->cache[i].valid = cache[i].valid;
+        state->cache[i].ticks = cache[i].ticks;
+    }
+}
+
+void SIM_MemSetState(const SIM_memState *state)
+{
+    int i;
+    ticks = state->ticks;
+    read_tick = state->readTick;
+    for (i = 0; i < SIM_MEM_CACHE_SIZE; ++i)
+    {
+        cache[i].addr = state->cache[i].addr;
+        cache[i].val = state->cache[i].val;
+        cache[i].valid = state->cache[i].valid;
+        cache[i].ticks = state->cache[i].ticks;
+    }
+}
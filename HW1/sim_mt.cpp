@@ -0,0 +1,496 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #1 */
+/* Fine-grained multithreaded core: several architectural contexts sharing one pipeline */
+
+#include "sim_api.h"
+#include "sim_functional.h"
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+/*! MtCore
+A 5-stage pipeline shared by up to SIM_MT_MAX_THREADS architectural contexts (pc and register file each).
+Every pipe slot is tagged with the thread of its command, and the control rules of SimCore are applied per thread:
+	1.	Hazards - the LOAD-use and multi-cycle RAW/WAW hazards are detected only between commands of the same thread,
+		the structural hazard of an unpipelined unit is shared by all the threads. A hazard holds IF and ID (all threads)
+
+	2.	Branches - a taken branch is resolved in MEM and flushes only the commands of its own thread from IF, ID and EXE
+
+	3.	Memory stalls - instead of freezing the pipe, a LOAD that gets a wait-state leaves the pipe to a miss queue
+		and its thread is suspended: its younger commands are flushed and fetched again (replayed) when the LOAD completes.
+		The memory simulator serves a single read at a time, so the queued LOADs are read one after another,
+		and a LOAD that reaches MEM while the queue is not empty waits in the queue as well
+
+Commands are executed functionally when they are first fetched (see FunctionalContext), so the contexts see the shared
+data memory in fetch order. The timing side only writes the current value back on STORE, to update the cache.
+The fetched thread is chosen by the policy:
+	SIM_MT_SWITCH_ON_STALL - keep fetching the same thread until it is suspended on a memory read
+	SIM_MT_ROUND_ROBIN - fetch the next ready thread every cycle
+*/
+class MtCore
+{
+	/*! MtCore::Slot
+	The content of a pipe stage, a bubble has thread -1 and an all-zero (NOP) command
+	*/
+	struct Slot {
+		int thread;
+		ExecutedCmd executed;
+		bool is_wrong_path;
+	};
+
+	/*! MtCore::Context
+	A thread: its architectural state, the commands to fetch again after a memory stall,
+	and the wrong path state after fetching a taken branch
+	*/
+	struct Context {
+		FunctionalContext functional;
+		std::deque<ExecutedCmd> replay;
+		bool is_wrong_path;
+		int32_t wrong_path_pc;
+		bool is_suspended;
+	};
+
+	/*! MtCore::UnitTiming
+	Timing model of a multi-cycle functional unit shared by the threads (see SimCore::FunctionalUnit)
+	*/
+	struct UnitTiming {
+		struct InFlight {
+			int thread;
+			int dst;
+			uint32_t issue_cycle;
+			uint32_t ready_cycle;
+		};
+
+		uint32_t latency;
+		bool is_pipelined;
+		std::vector<InFlight> in_flight;
+
+		void Issue(int thread, int dst, uint32_t cycle) {
+			InFlight command = { thread, dst, cycle, cycle + latency };
+			in_flight.push_back(command);
+		}
+
+		void Complete(uint32_t cycle) {
+			for (size_t i = 0; i < in_flight.size(); ) {
+				if (in_flight[i].ready_cycle <= cycle) in_flight.erase(in_flight.begin() + i);
+				else i++;
+			}
+		}
+
+		void Squash(int thread, uint32_t cycle) {
+			for (size_t i = 0; i < in_flight.size(); ) {
+				if (in_flight[i].thread == thread && in_flight[i].issue_cycle >= cycle) in_flight.erase(in_flight.begin() + i);
+				else i++;
+			}
+		}
+
+		uint32_t PendingWrite(int thread, int reg) const {
+			uint32_t ready_cycle = 0;
+			for (size_t i = 0; i < in_flight.size(); i++) {
+				if (in_flight[i].thread == thread && in_flight[i].dst == reg)
+					ready_cycle = std::max(ready_cycle, in_flight[i].ready_cycle);
+			}
+			return ready_cycle;
+		}
+
+		uint32_t BusyUntil() const {
+			if (is_pipelined) return 0;
+
+			uint32_t ready_cycle = 0;
+			for (size_t i = 0; i < in_flight.size(); i++)
+				ready_cycle = std::max(ready_cycle, in_flight[i].ready_cycle);
+			return ready_cycle;
+		}
+	};
+
+	/*! MtCore::ParkedLoad
+	A LOAD waiting in the miss queue
+	*/
+	struct ParkedLoad {
+		int thread;
+		uint32_t addr;
+	};
+
+public:
+	/*! MtCore::MtCore
+	An empty core, SIM_MtReset has to be called before the simulation (the memory simulator holds no program yet)
+	*/
+	MtCore() : m_policy(SIM_MT_SWITCH_ON_STALL), m_cycle(0), mf_is_hazard(false), mf_park_mem(false), m_last_thread(0) {
+		for (int i = 0; i < SIM_PIPELINE_DEPTH; i++)
+			Bubble(m_stages[i]);
+		memset(&m_stats, 0x0, sizeof(m_stats));
+	}
+
+	/*! MtCore::Reset
+	Starts a new simulation: every context starts at pc 0 with a cleared register file, and the first thread is fetched
+	\param[in] threads Number of contexts
+	\param[in] policy The thread selection policy
+	*/
+	void Reset(uint32_t threads, SIM_mtPolicy policy) {
+		m_policy = policy;
+		m_contexts.assign(threads, Context());
+		for (size_t i = 0; i < m_contexts.size(); i++) {
+			m_contexts[i].is_wrong_path = false;
+			m_contexts[i].wrong_path_pc = 0;
+			m_contexts[i].is_suspended = false;
+		}
+		for (int i = 0; i < SIM_PIPELINE_DEPTH; i++)
+			Bubble(m_stages[i]);
+		m_parked.clear();
+		m_cycle = 0;
+		mf_is_hazard = false;
+		mf_park_mem = false;
+		//round-robin starts with the first thread as well
+		m_last_thread = (SIM_MT_ROUND_ROBIN == policy) ? threads - 1 : 0;
+		memset(&m_stats, 0x0, sizeof(m_stats));
+
+		SIM_CoreGetFuncUnit(CMD_MUL, &m_multiplier.latency, &m_multiplier.is_pipelined);
+		SIM_CoreGetFuncUnit(CMD_DIV, &m_divider.latency, &m_divider.is_pipelined);
+		m_multiplier.in_flight.clear();
+		m_divider.in_flight.clear();
+
+		Fetch(m_stages[IF]);
+		//the reset fetch is not a switch, only the fetches of the clock ticks are counted
+		m_stats.threadSwitches = 0;
+	}
+
+	/*! MtCore::ClockTick
+	Advances the core by one clock cycle (the memory clock is driven by the caller)
+	*/
+	void ClockTick() {
+		if (m_contexts.empty()) return;
+
+		for (size_t i = 0; i < m_contexts.size(); i++) {
+			if (m_contexts[i].is_suspended) m_stats.threadSuspendedCycles[i]++;
+		}
+
+		Update();
+		Operate();
+		m_cycle++;
+	}
+
+	/*! MtCore::GetThreadState
+	\param[in] thread A context index
+	\param[out] pc The pc of the next command the thread executes (ignored if NULL)
+	\param[out] regs The register file (ignored if NULL)
+	\return false for an invalid context
+	*/
+	bool GetThreadState(uint32_t thread, int32_t* pc, int32_t* regs) const {
+		if (thread >= m_contexts.size()) return false;
+
+		const FunctionalContext& functional = m_contexts[thread].functional;
+		if (NULL != pc) *pc = functional.Pc();
+		if (NULL != regs) memcpy(regs, functional.Registers(), SIM_REGFILE_SIZE * sizeof(int32_t));
+		return true;
+	}
+
+	/*! MtCore::Stats
+	\return the statistics since the last reset
+	*/
+	SIM_mtStats Stats() const {
+		SIM_mtStats stats = m_stats;
+		stats.cycles = m_cycle;
+		stats.threads = (uint32_t)m_contexts.size();
+		stats.committedCmds = 0;
+		for (size_t i = 0; i < m_contexts.size(); i++)
+			stats.committedCmds += stats.threadCommittedCmds[i];
+		return stats;
+	}
+
+private:
+	enum { IF = 0, ID, EXE, MEM, WB };
+
+	void Bubble(Slot& slot) {
+		memset(&slot, 0x0, sizeof(slot));
+		slot.thread = -1;
+	}
+
+	/*! MtCore::SelectThread
+	\return the thread to fetch from according to the policy, -1 if all the threads are suspended
+	*/
+	int SelectThread() const {
+		const int threads = (int)m_contexts.size();
+		if (SIM_MT_SWITCH_ON_STALL == m_policy && !m_contexts[m_last_thread].is_suspended)
+			return m_last_thread;
+
+		for (int i = 1; i <= threads; i++) {
+			const int thread = (m_last_thread + i) % threads;
+			if (!m_contexts[thread].is_suspended) return thread;
+		}
+		return -1;
+	}
+
+	/*! MtCore::Fetch
+	Fetches from the selected thread: a wrong path command after a taken branch, a replayed command after a memory
+	stall, or the next command executed by the thread context
+	\param[out] slot The IF stage
+	*/
+	void Fetch(Slot& slot) {
+		Bubble(slot);
+		const int thread = SelectThread();
+		if (0 > thread) {
+			m_stats.idleCycles++;
+			return;
+		}
+
+		if (thread != m_last_thread) m_stats.threadSwitches++;
+		m_last_thread = thread;
+
+		Context& context = m_contexts[thread];
+		slot.thread = thread;
+		if (context.is_wrong_path) {
+			SIM_MemInstRead(context.wrong_path_pc, &slot.executed.cmd);
+			slot.executed.pc = context.wrong_path_pc;
+			slot.is_wrong_path = true;
+			context.wrong_path_pc += 4;
+			return;
+		}
+
+		if (!context.replay.empty()) {
+			slot.executed = context.replay.front();
+			context.replay.pop_front();
+		}
+		else context.functional.Execute(slot.executed);
+
+		if (slot.executed.is_taken) {
+			context.is_wrong_path = true;
+			context.wrong_path_pc = slot.executed.pc + 4;
+		}
+	}
+
+	/*! MtCore::FlushThread
+	Flushes the commands of a thread from IF, ID and EXE
+	\param[in] thread The thread
+	\param[in] is_replayed Whether the flushed correct path commands are fetched again (memory stall) or dropped (branch)
+	*/
+	void FlushThread(int thread, bool is_replayed) {
+		Context& context = m_contexts[thread];
+		//youngest first, so the oldest flushed command ends at the front of the replay queue
+		for (int i = IF; i <= EXE; i++) {
+			if (m_stages[i].thread != thread) continue;
+			if (is_replayed && !m_stages[i].is_wrong_path)
+				context.replay.push_front(m_stages[i].executed);
+			Bubble(m_stages[i]);
+		}
+		//the flushed EXE command was performed on the previous cycle, drop its multi-cycle result
+		m_multiplier.Squash(thread, m_cycle - 1);
+		m_divider.Squash(thread, m_cycle - 1);
+		context.is_wrong_path = false;
+	}
+
+	/*! MtCore::Update
+	Mirrors SimCore::UpdateMachineState, except that a LOAD with a wait-state leaves MEM and suspends its thread
+	*/
+	void Update() {
+		if (mf_park_mem) {
+			const Slot& MEM_slot = m_stages[MEM];
+			ParkedLoad parked = { MEM_slot.thread, MEM_slot.executed.addr };
+			m_parked.push_back(parked);
+			m_contexts[MEM_slot.thread].is_suspended = true;
+			FlushThread(MEM_slot.thread, true);
+			Bubble(m_stages[MEM]);
+			mf_park_mem = false;
+			mf_is_hazard = Hazard();
+		}
+
+		const Slot& MEM_slot = m_stages[MEM];
+		const bool is_branch = (0 <= MEM_slot.thread) && MEM_slot.executed.is_taken;
+		if (mf_is_hazard && !is_branch) {
+			m_stages[WB] = m_stages[MEM];
+			m_stages[MEM] = m_stages[EXE];
+			Bubble(m_stages[EXE]);
+			mf_is_hazard = Hazard();
+			m_stats.hazardStalls++;
+		}
+		else {
+			if (is_branch) {
+				FlushThread(MEM_slot.thread, false);
+				m_stats.branchFlushes++;
+			}
+			for (int i = WB; i > IF; i--)
+				m_stages[i] = m_stages[i - 1];
+			Fetch(m_stages[IF]);
+			mf_is_hazard = Hazard();
+		}
+	}
+
+	/*! MtCore::Operate
+	WB and the multi-cycle units complete, the oldest queued LOAD continues its memory read,
+	then MEM accesses the memory simulator and EXE issues multi-cycle commands
+	*/
+	void Operate() {
+		const Slot& WB_slot = m_stages[WB];
+		if (0 <= WB_slot.thread && CMD_NOP != WB_slot.executed.cmd.opcode)
+			m_stats.threadCommittedCmds[WB_slot.thread]++;
+		m_multiplier.Complete(m_cycle);
+		m_divider.Complete(m_cycle);
+
+		//a queued LOAD completes (and commits) as soon as its data arrives, its thread is fetched again
+		if (!m_parked.empty()) {
+			int32_t loaded_data;
+			if (0 <= SIM_MemDataRead(m_parked.front().addr, &loaded_data)) {
+				const int thread = m_parked.front().thread;
+				m_stats.threadCommittedCmds[thread]++;
+				m_contexts[thread].is_suspended = false;
+				m_parked.pop_front();
+			}
+		}
+
+		const Slot& MEM_slot = m_stages[MEM];
+		if (CMD_LOAD == MEM_slot.executed.cmd.opcode) {
+			int32_t loaded_data;
+			//the memory simulator serves a single read, a LOAD behind a queued one has to wait in the queue
+			mf_park_mem = !m_parked.empty() || (0 > SIM_MemDataRead(MEM_slot.executed.addr, &loaded_data));
+		}
+		else if (CMD_STORE == MEM_slot.executed.cmd.opcode)
+			SIM_MemDataWrite(MEM_slot.executed.addr, SIM_MemDataPeek(MEM_slot.executed.addr));
+
+		const Slot& EXE_slot = m_stages[EXE];
+		if (0 <= EXE_slot.thread && (CMD_MUL == EXE_slot.executed.cmd.opcode || CMD_DIV == EXE_slot.executed.cmd.opcode))
+			UnitOf(EXE_slot.executed.cmd.opcode).Issue(EXE_slot.thread, EXE_slot.executed.cmd.dst, m_cycle);
+	}
+
+	/*! MtCore::Hazard
+	Mirrors SimCore::HDU::operator() for commands of the same thread
+	\return true if the ID command has to be stalled
+	*/
+	bool Hazard() {
+		const Slot& EXE_slot = m_stages[EXE];
+		const Slot& ID_slot = m_stages[ID];
+		if (0 > ID_slot.thread) return false;
+
+		const SIM_cmd& EXE_cmd = EXE_slot.executed.cmd;
+		const SIM_cmd& ID_cmd = ID_slot.executed.cmd;
+		if (MultiCycleHazard(EXE_slot, ID_slot))
+			return true;
+
+		if (EXE_slot.thread == ID_slot.thread && CMD_LOAD == EXE_cmd.opcode) {
+			if (!(CMD_NOP == ID_cmd.opcode || CMD_BR == ID_cmd.opcode) &&
+				(EXE_cmd.dst == ID_cmd.src1 || EXE_cmd.dst == ID_cmd.src2))
+				return true;
+
+			return (CMD_BR == ID_cmd.opcode || CMD_BREQ == ID_cmd.opcode || CMD_BRNEQ == ID_cmd.opcode) &&
+				ID_cmd.dst == EXE_cmd.dst;
+		}
+
+		return false;
+	}
+
+	/*! MtCore::MultiCycleHazard
+	Mirrors SimCore::HDU::MultiCycleHazard, with register hazards only against commands of the ID thread
+	*/
+	bool MultiCycleHazard(const Slot& EXE_slot, const Slot& ID_slot) {
+		const SIM_cmd& EXE_cmd = EXE_slot.executed.cmd;
+		const SIM_cmd& ID_cmd = ID_slot.executed.cmd;
+		const uint32_t next_cycle = m_cycle + 1;
+
+		int read_regs[3];
+		int read_count = 0;
+		switch (ID_cmd.opcode)
+		{
+		case CMD_NOP:
+			break;
+		case CMD_BR:
+			read_regs[read_count++] = ID_cmd.dst;
+			break;
+		case CMD_STORE:
+		case CMD_BREQ:
+		case CMD_BRNEQ:
+			read_regs[read_count++] = ID_cmd.dst;
+			//fall through
+		default:
+			read_regs[read_count++] = ID_cmd.src1;
+			if (!ID_cmd.isSrc2Imm) read_regs[read_count++] = ID_cmd.src2;
+			break;
+		}
+
+		for (int i = 0; i < read_count; i++) {
+			if (PendingWrite(EXE_slot, ID_slot.thread, read_regs[i]) > next_cycle)
+				return true;
+		}
+
+		if ((CMD_ADD == ID_cmd.opcode || CMD_SUB == ID_cmd.opcode || CMD_LOAD == ID_cmd.opcode ||
+			 CMD_MUL == ID_cmd.opcode || CMD_DIV == ID_cmd.opcode) &&
+			PendingWrite(EXE_slot, ID_slot.thread, ID_cmd.dst) > next_cycle)
+			return true;
+
+		if (CMD_MUL == ID_cmd.opcode || CMD_DIV == ID_cmd.opcode) {
+			const UnitTiming& unit = UnitOf(ID_cmd.opcode);
+			uint32_t busy_until = unit.BusyUntil();
+			if (ID_cmd.opcode == EXE_cmd.opcode && !unit.is_pipelined)
+				busy_until = std::max(busy_until, m_cycle + unit.latency);
+			if (busy_until > next_cycle)
+				return true;
+		}
+
+		return false;
+	}
+
+	uint32_t PendingWrite(const Slot& EXE_slot, int thread, int reg) {
+		const SIM_cmd& EXE_cmd = EXE_slot.executed.cmd;
+		uint32_t ready_cycle = std::max(m_multiplier.PendingWrite(thread, reg), m_divider.PendingWrite(thread, reg));
+		if (EXE_slot.thread == thread && (CMD_MUL == EXE_cmd.opcode || CMD_DIV == EXE_cmd.opcode) && EXE_cmd.dst == reg)
+			ready_cycle = std::max(ready_cycle, m_cycle + UnitOf(EXE_cmd.opcode).latency);
+		return ready_cycle;
+	}
+
+	UnitTiming& UnitOf(int opcode) {
+		return (CMD_DIV == opcode) ? m_divider : m_multiplier;
+	}
+
+	SIM_mtPolicy m_policy;
+	std::vector<Context> m_contexts;
+	Slot m_stages[SIM_PIPELINE_DEPTH];
+
+	/*! MtCore::m_parked
+	The miss queue: LOADs waiting for the memory simulator, oldest first
+	*/
+	std::deque<ParkedLoad> m_parked;
+	uint32_t m_cycle;
+	bool mf_is_hazard;
+
+	/*! MtCore::mf_park_mem
+	Raised when the LOAD in MEM got a wait-state, the next update moves it to the miss queue
+	*/
+	bool mf_park_mem;
+
+	/*! MtCore::m_last_thread
+	The last fetched thread
+	*/
+	int m_last_thread;
+	UnitTiming m_multiplier;
+	UnitTiming m_divider;
+	SIM_mtStats m_stats;
+};
+
+/*! mt_core
+Static object representing the multithreaded simulator
+*/
+static MtCore mt_core;
+
+
+
+int SIM_MtReset(uint32_t threads, SIM_mtPolicy policy)
+{
+	if (0 == threads || threads > SIM_MT_MAX_THREADS ||
+		(SIM_MT_SWITCH_ON_STALL != policy && SIM_MT_ROUND_ROBIN != policy))
+		return -1;
+
+	mt_core.Reset(threads, policy);
+	return 0;
+}
+
+void SIM_MtClkTick(void)
+{
+	mt_core.ClockTick();
+}
+
+int SIM_MtGetThreadState(uint32_t thread, int32_t *pc, int32_t *regFile)
+{
+	return mt_core.GetThreadState(thread, pc, regFile) ? 0 : -1;
+}
+
+void SIM_MtGetStats(SIM_mtStats *stats)
+{
+	if (NULL != stats)
+		*stats = mt_core.Stats();
+}
@@ -0,0 +1,86 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #1                                      */
+/* Multithreaded core simulation, compared with the single-thread core                      */
+/* Usage: ./sim_mt <memory image filename> <number of cycles to run> <threads> [stall|rr]   */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "sim_api.h"
+
+int main(int argc, char const *argv[])
+{
+    int i, simDuration, threads;
+    SIM_mtPolicy policy;
+    SIM_mtStats mtStats;
+    SIM_timingStats coreStats;
+
+    if (argc != 4 && argc != 5)
+    {
+        fprintf(stderr,
+                "Usage: %s <memory image filename> <number of cycles to run> <threads> [stall|rr]\n",
+                argv[0]);
+        exit(1);
+    }
+
+    simDuration = atoi(argv[2]);
+    threads = atoi(argv[3]);
+    policy = SIM_MT_SWITCH_ON_STALL;
+    if (argc == 5 && strcmp(argv[4], "rr") == 0)
+        policy = SIM_MT_ROUND_ROBIN;
+    else if (argc == 5 && strcmp(argv[4], "stall") != 0)
+    {
+        fprintf(stderr, "Invalid policy argument: %s\n", argv[4]);
+        exit(4);
+    }
+    if (simDuration <= 0)
+    {
+        fprintf(stderr, "Invalid simulation durection argument: %s\n", argv[2]);
+        exit(4);
+    }
+
+    /* Single-thread reference */
+    if (SIM_MemReset(argv[1]) != 0)
+    {
+        fprintf(stderr, "Failed initializing memory simulator!\n");
+        exit(2);
+    }
+    SIM_CoreReset();
+    for (i = 0; i < simDuration; ++i)
+    {
+        SIM_CoreClkTick();
+        SIM_MemClkTick();
+    }
+    SIM_CoreGetTimingStats(&coreStats);
+
+    /* Multithreaded core */
+    SIM_MemReset(argv[1]);
+    if (SIM_MtReset(threads, policy) != 0)
+    {
+        fprintf(stderr, "Invalid number of threads: %s (1 to %d)\n", argv[3], SIM_MT_MAX_THREADS);
+        exit(3);
+    }
+    for (i = 0; i < simDuration; ++i)
+    {
+        SIM_MtClkTick();
+        SIM_MemClkTick();
+    }
+    SIM_MtGetStats(&mtStats);
+
+    printf("Multithreaded core: %u threads, %s policy, %u cycles\n", mtStats.threads,
+           (policy == SIM_MT_ROUND_ROBIN) ? "round-robin" : "switch on stall", mtStats.cycles);
+    printf("Thread\tCommitted\tIPC\tSuspended cycles\n");
+    for (i = 0; i < (int)mtStats.threads; ++i)
+    {
+        printf("%d\t%u\t%.3f\t%u\n", i, mtStats.threadCommittedCmds[i],
+               (double)mtStats.threadCommittedCmds[i] / mtStats.cycles, mtStats.threadSuspendedCycles[i]);
+    }
+    printf("Aggregate\t%u\t%.3f\n", mtStats.committedCmds, (double)mtStats.committedCmds / mtStats.cycles);
+    printf("Idle cycles: %u, hazard stalls: %u, branch flushes: %u, thread switches: %u\n",
+           mtStats.idleCycles, mtStats.hazardStalls, mtStats.branchFlushes, mtStats.threadSwitches);
+
+    printf("\nSingle-thread core: %u committed, IPC %.3f, memory stall cycles: %u\n",
+           coreStats.committedCmds, (double)coreStats.committedCmds / coreStats.cycles, coreStats.memoryStalls);
+    printf("Throughput speedup: %.3f\n",
+           (coreStats.committedCmds == 0) ? 0.0 : (double)mtStats.committedCmds / coreStats.committedCmds);
+    return 0;
+}
@@ -0,0 +1,114 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #1                                      */
+/* Basic-block vector profiling and SimPoint interval selection                             */
+/* Usage: ./sim_profile <memory image filename> <number of cycles to run>                   */
+/*                      <commands per interval> [<max clusters>]                            */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "sim_api.h"
+
+#define DEFAULT_MAX_CLUSTERS 10
+#define SIMPOINT_SEED 1
+
+int main(int argc, char const *argv[])
+{
+    int i, simDuration, intervalLength, maxClusters;
+    uint32_t intervalCount, pointCount, totalCycles, totalCmds;
+    double estimatedCPI;
+    SIM_bbvInterval info;
+    SIM_simPoint *points;
+    SIM_timingStats stats;
+
+    if (argc != 4 && argc != 5)
+    {
+        fprintf(stderr,
+                "Usage: %s <memory image filename> <number of cycles to run> <commands per interval> [<max clusters>]\n",
+                argv[0]);
+        exit(1);
+    }
+
+    simDuration = atoi(argv[2]);
+    intervalLength = atoi(argv[3]);
+    maxClusters = (argc == 5) ? atoi(argv[4]) : DEFAULT_MAX_CLUSTERS;
+    if (simDuration <= 0 || intervalLength <= 0 || maxClusters <= 0)
+    {
+        fprintf(stderr, "Invalid cycles, interval or clusters argument\n");
+        exit(4);
+    }
+
+    if (SIM_MemReset(argv[1]) != 0)
+    {
+        fprintf(stderr, "Failed initializing memory simulator!\n");
+        exit(2);
+    }
+    if (SIM_CoreReset() != 0)
+    {
+        fprintf(stderr, "Failed reseting core!\n");
+        exit(3);
+    }
+
+    /* Profiling run */
+    SIM_CoreSetBbvInterval(intervalLength);
+    for (i = 0; i < simDuration; ++i)
+    {
+        SIM_CoreClkTick();
+        SIM_MemClkTick();
+    }
+
+    intervalCount = SIM_CoreGetBbvIntervalCount();
+    if (intervalCount == 0)
+    {
+        fprintf(stderr, "No interval of %d commands completed in %d cycles\n", intervalLength, simDuration);
+        exit(5);
+    }
+
+    printf("Interval\tStart cycle\tCycles\tCPI\tBasic blocks\n");
+    totalCycles = 0;
+    totalCmds = 0;
+    for (i = 0; i < (int)intervalCount; ++i)
+    {
+        SIM_CoreGetBbv(i, &info, NULL, NULL);
+        printf("%d\t%u\t%u\t%.3f\t%u\n", i, info.startCycle, info.cycles,
+               (double)info.cycles / info.commands, info.blockCount);
+        totalCycles += info.cycles;
+        totalCmds += info.commands;
+    }
+
+    /* Interval selection */
+    points = (SIM_simPoint *)malloc(maxClusters * sizeof(SIM_simPoint));
+    if (points == NULL || SIM_SimPointSelect(maxClusters, SIMPOINT_SEED, points, &pointCount) != 0)
+    {
+        fprintf(stderr, "Failed selecting simulation points!\n");
+        exit(6);
+    }
+
+    /* Detailed simulation of the representative intervals only, from their checkpoint (start cycle) */
+    printf("\nSimulation points (%u of %u intervals):\n", pointCount, intervalCount);
+    printf("Interval\tStart cycle\tWeight\tCPI\n");
+    estimatedCPI = 0.0;
+    for (i = 0; i < (int)pointCount; ++i)
+    {
+        uint32_t startCycle, committed;
+        double pointCPI;
+
+        SIM_GotoCycle(points[i].startCycle);
+        SIM_CoreGetTimingStats(&stats);
+        startCycle = stats.cycles;
+        committed = stats.committedCmds;
+        while (stats.committedCmds - committed < (uint32_t)intervalLength)
+        {
+            SIM_CoreClkTick();
+            SIM_MemClkTick();
+            SIM_CoreGetTimingStats(&stats);
+        }
+        pointCPI = (double)(stats.cycles - startCycle) / intervalLength;
+        estimatedCPI += points[i].weight * pointCPI;
+        printf("%u\t%u\t%.3f\t%.3f\n", points[i].interval, points[i].startCycle, points[i].weight, pointCPI);
+    }
+
+    printf("\nEstimated CPI: %.3f (simulated %u of %u intervals)\n", estimatedCPI, pointCount, intervalCount);
+    printf("Profiled CPI: %.3f\n", (double)totalCycles / totalCmds);
+
+    free(points);
+    return 0;
+}
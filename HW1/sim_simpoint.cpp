@@ -0,0 +1,272 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #1 */
+/* SimPoint-style selection of representative intervals from the basic-block vector profile */
+
+#include "sim_api.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#define SIMPOINT_KMEANS_TRIES 5
+#define SIMPOINT_KMEANS_ITERATIONS 100
+#define SIMPOINT_BIC_THRESHOLD 0.9
+
+/*! SimPoint
+Clusters the profiled intervals of the core (see SIM_CoreSetBbvInterval) as follows:
+	1.	Every basic-block vector is normalized by the number of commands in its interval,
+		so it holds the fraction of the interval spent in each basic block
+
+	2.	The vectors are reduced to SIM_SIMPOINT_DIMENSIONS dimensions by a random projection.
+		The projection matrix entries are uniform in [-1, 1] and are derived from a hash of the block pc,
+		so the matrix never has to be built for all the blocks of the program
+
+	3.	k-means runs for every k from 1 to the maximal number of clusters (the best of a few random initializations),
+		and each clustering is scored with the Bayesian information criterion (BIC)
+
+	4.	The smallest k whose score reaches SIMPOINT_BIC_THRESHOLD of the score range is chosen.
+		The interval closest to each cluster center represents it, weighted by the cluster size
+*/
+class SimPoint
+{
+	typedef std::vector<double> Point;
+
+	/*! SimPoint::Clustering
+	The result of a single k-means run
+	*/
+	struct Clustering {
+		std::vector<Point> centers;
+		std::vector<uint32_t> assignment;
+		double distortion;
+	};
+
+public:
+	/*! SimPoint::SimPoint
+	Projects the completed intervals of the core profile
+	\param[in] seed Seed of the random projection and of the k-means initializations
+	*/
+	SimPoint(uint32_t seed) : m_seed(seed), m_random_state((seed * 2654435761u) | 1) {
+		const uint32_t interval_count = SIM_CoreGetBbvIntervalCount();
+		m_points.resize(interval_count, Point(SIM_SIMPOINT_DIMENSIONS, 0.0));
+		m_start_cycles.resize(interval_count);
+
+		for (uint32_t i = 0; i < interval_count; i++) {
+			SIM_bbvInterval info;
+			SIM_CoreGetBbv(i, &info, NULL, NULL);
+			std::vector<uint32_t> block_pcs(info.blockCount), block_counts(info.blockCount);
+			SIM_CoreGetBbv(i, &info, block_pcs.data(), block_counts.data());
+
+			m_start_cycles[i] = info.startCycle;
+			for (uint32_t b = 0; b < info.blockCount; b++) {
+				const double fraction = (double)block_counts[b] / info.commands;
+				for (int d = 0; d < SIM_SIMPOINT_DIMENSIONS; d++)
+					m_points[i][d] += fraction * ProjectionEntry(block_pcs[b], d);
+			}
+		}
+	}
+
+	/*! SimPoint::Select
+	\param[in] max_clusters Maximal number of clusters
+	\param[out] points The representative intervals, ordered by interval index
+	\return the number of representative intervals
+	*/
+	uint32_t Select(uint32_t max_clusters, SIM_simPoint* points) {
+		const uint32_t max_k = std::min<uint32_t>(max_clusters, (uint32_t)m_points.size());
+
+		std::vector<Clustering> clusterings(max_k);
+		std::vector<double> scores(max_k);
+		for (uint32_t k = 1; k <= max_k; k++) {
+			clusterings[k - 1] = BestKMeans(k);
+			scores[k - 1] = Bic(clusterings[k - 1], k);
+		}
+
+		const double min_score = *std::min_element(scores.begin(), scores.end());
+		const double max_score = *std::max_element(scores.begin(), scores.end());
+		uint32_t chosen = 0;
+		while (scores[chosen] < min_score + SIMPOINT_BIC_THRESHOLD * (max_score - min_score))
+			chosen++;
+
+		return Representatives(clusterings[chosen], points);
+	}
+
+private:
+	/*! SimPoint::ProjectionEntry
+	\param[in] block_pc The basic block pc (the projection matrix row)
+	\param[in] dimension The projected dimension (the projection matrix column)
+	\return a pseudo random value, uniform in [-1, 1]
+	*/
+	double ProjectionEntry(uint32_t block_pc, int dimension) const {
+		uint64_t hash = ((uint64_t)block_pc << 32) ^ ((uint64_t)dimension << 8) ^ m_seed;
+		hash += 0x9E3779B97F4A7C15ull;
+		hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+		hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+		hash ^= hash >> 31;
+		return 2.0 * ((hash >> 11) * (1.0 / 9007199254740992.0)) - 1.0;
+	}
+
+	/*! SimPoint::Random
+	\return the next value of a xorshift generator, used for the k-means initializations
+	*/
+	uint32_t Random() {
+		m_random_state ^= m_random_state << 13;
+		m_random_state ^= m_random_state >> 17;
+		m_random_state ^= m_random_state << 5;
+		return m_random_state;
+	}
+
+	static double Distance(const Point& a, const Point& b) {
+		double distance = 0.0;
+		for (size_t d = 0; d < a.size(); d++)
+			distance += (a[d] - b[d]) * (a[d] - b[d]);
+		return distance;
+	}
+
+	/*! SimPoint::BestKMeans
+	\param[in] k Number of clusters
+	\return the clustering with the smallest distortion over SIMPOINT_KMEANS_TRIES random initializations
+	*/
+	Clustering BestKMeans(uint32_t k) {
+		Clustering best;
+		best.distortion = DBL_MAX;
+		for (int i = 0; i < SIMPOINT_KMEANS_TRIES; i++) {
+			Clustering clustering = KMeans(k);
+			if (clustering.distortion < best.distortion)
+				best = clustering;
+		}
+		return best;
+	}
+
+	/*! SimPoint::KMeans
+	Lloyd's algorithm, the initial centers are k distinct random intervals
+	\param[in] k Number of clusters
+	\return the clustering
+	*/
+	Clustering KMeans(uint32_t k) {
+		const uint32_t n = (uint32_t)m_points.size();
+		Clustering clustering;
+
+		std::vector<uint32_t> order(n);
+		for (uint32_t i = 0; i < n; i++) order[i] = i;
+		for (uint32_t i = 0; i < k; i++) {
+			std::swap(order[i], order[i + Random() % (n - i)]);
+			clustering.centers.push_back(m_points[order[i]]);
+		}
+
+		clustering.assignment.assign(n, k);
+		for (int iteration = 0; iteration < SIMPOINT_KMEANS_ITERATIONS; iteration++) {
+			bool is_changed = false;
+			for (uint32_t i = 0; i < n; i++) {
+				uint32_t closest = 0;
+				for (uint32_t c = 1; c < k; c++) {
+					if (Distance(m_points[i], clustering.centers[c]) < Distance(m_points[i], clustering.centers[closest]))
+						closest = c;
+				}
+				is_changed = is_changed || (closest != clustering.assignment[i]);
+				clustering.assignment[i] = closest;
+			}
+			if (!is_changed) break;
+
+			//move each center to the mean of its intervals, an empty cluster keeps its center
+			std::vector<Point> sums(k, Point(SIM_SIMPOINT_DIMENSIONS, 0.0));
+			std::vector<uint32_t> sizes(k, 0);
+			for (uint32_t i = 0; i < n; i++) {
+				sizes[clustering.assignment[i]]++;
+				for (int d = 0; d < SIM_SIMPOINT_DIMENSIONS; d++)
+					sums[clustering.assignment[i]][d] += m_points[i][d];
+			}
+			for (uint32_t c = 0; c < k; c++) {
+				if (0 == sizes[c]) continue;
+				for (int d = 0; d < SIM_SIMPOINT_DIMENSIONS; d++)
+					clustering.centers[c][d] = sums[c][d] / sizes[c];
+			}
+		}
+
+		clustering.distortion = 0.0;
+		for (uint32_t i = 0; i < n; i++)
+			clustering.distortion += Distance(m_points[i], clustering.centers[clustering.assignment[i]]);
+		return clustering;
+	}
+
+	/*! SimPoint::Bic
+	The Bayesian information criterion of a clustering under a spherical Gaussian model (Pelleg and Moore, X-means)
+	\param[in] clustering The clustering
+	\param[in] k Number of clusters
+	\return the BIC score, higher is better
+	*/
+	double Bic(const Clustering& clustering, uint32_t k) const {
+		const double n = (double)m_points.size();
+		const double dimensions = SIM_SIMPOINT_DIMENSIONS;
+		const double variance = std::max((n > k) ? clustering.distortion / (n - k) : 0.0, 1e-12);
+
+		std::vector<uint32_t> sizes(k, 0);
+		for (size_t i = 0; i < clustering.assignment.size(); i++)
+			sizes[clustering.assignment[i]]++;
+
+		double likelihood = 0.0;
+		for (uint32_t c = 0; c < k; c++) {
+			if (0 == sizes[c]) continue;
+			const double size = sizes[c];
+			likelihood += size * std::log(size) - size * std::log(n) - size / 2.0 * std::log(2.0 * M_PI)
+				- size * dimensions / 2.0 * std::log(variance) - (size - k) / 2.0;
+		}
+
+		const double parameters = (k - 1) + dimensions * k + 1;
+		return likelihood - parameters / 2.0 * std::log(n);
+	}
+
+	/*! SimPoint::Representatives
+	\param[in] clustering The chosen clustering
+	\param[out] points The interval closest to the center of every non-empty cluster, ordered by interval index
+	\return the number of representative intervals
+	*/
+	uint32_t Representatives(const Clustering& clustering, SIM_simPoint* points) const {
+		const uint32_t n = (uint32_t)m_points.size();
+		const uint32_t k = (uint32_t)clustering.centers.size();
+
+		std::vector<uint32_t> representative(k, n), sizes(k, 0);
+		for (uint32_t i = 0; i < n; i++) {
+			const uint32_t c = clustering.assignment[i];
+			sizes[c]++;
+			if (n == representative[c] ||
+				Distance(m_points[i], clustering.centers[c]) < Distance(m_points[representative[c]], clustering.centers[c]))
+				representative[c] = i;
+		}
+
+		std::vector<uint32_t> clusters;
+		for (uint32_t c = 0; c < k; c++) {
+			if (0 != sizes[c]) clusters.push_back(c);
+		}
+
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			for (size_t j = 0; j < clusters.size(); j++) {
+				if (representative[clusters[j]] != i) continue;
+				points[count].interval = i;
+				points[count].startCycle = m_start_cycles[i];
+				points[count].weight = (double)sizes[clusters[j]] / n;
+				count++;
+			}
+		}
+		return count;
+	}
+
+	uint32_t m_seed;
+	uint32_t m_random_state;
+
+	/*! SimPoint::m_points
+	The projected basic-block vector of every interval
+	*/
+	std::vector<Point> m_points;
+	std::vector<uint32_t> m_start_cycles;
+};
+
+
+
+int SIM_SimPointSelect(uint32_t maxClusters, uint32_t seed, SIM_simPoint *points, uint32_t *count)
+{
+	if (0 == maxClusters || NULL == points || NULL == count || 0 == SIM_CoreGetBbvIntervalCount())
+		return -1;
+
+	SimPoint simpoint(seed);
+	*count = simpoint.Select(maxClusters, points);
+	return 0;
+}
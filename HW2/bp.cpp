@@ -2,200 +2,202 @@
 /* This file should hold your implementation of the predictor simulator */
 
 #include "bp_api.h"
+#include "bp_history.h"
+#include "bp_tables.h"
+#include "bp_tage.h"
+#include "bp_perceptron.h"
+#include "bp_loop.h"
+#include "bp_target.h"
+#include "bp_bitslice.h"
+#include "bp_stats.h"
+#include "bp_alias.h"
+#include "bp_kernel.h"
 #include <vector>
+#include <deque>
 #include <iostream>
 #include <cmath>
 #include <exception>
 #include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <cstring>
 
 
 using namespace std;
 
-#define SNT 0
-#define WNT 1
-#define WT 2
-#define ST 3
-
-#define PREDICTION(x) (x & 0b10) >> 1
-
 #define TAG(pc, mask) ( pc & mask) >> 2
 
 #define HISTORY(unmasked, mask) (unmasked & mask)
 
-class PredictionTable;
 class BranchTargetBuffer;
 class BranchPredictor;
 
-class PredictionTable
+class LocalTable : public PredictionTable
 {
 public:
-	PredictionTable(unsigned char histTableSize) : m_table_tag_mask(0x1) {
-		while (--histTableSize)
-			m_table_tag_mask = (m_table_tag_mask << 1) | 0x1;
-		
+	//every BTB entry owns a row of 2^histSize state machines, each row starts at a byte boundary
+	//so it can be reset without touching the rows of the other entries
+	//the rows are indexed by the BTB entry of the branch (not by its pc), so they follow the BTB replacement
+	LocalTable(unsigned btbSize, unsigned histSize) : PredictionTable(histSize),
+		m_row_size(m_table_tag_mask + 1),
+		m_row_bytes((m_row_size + COUNTERS_PER_BYTE - 1) / COUNTERS_PER_BYTE),
+		m_tables(btbSize * m_row_bytes * COUNTERS_PER_BYTE), m_btb_size(btbSize) {}
+	virtual ~LocalTable() {}
+
+	virtual bool Prediction(uint32_t history, unsigned entry) {
+		return PREDICTION(m_tables.State(Index(history, entry))) ? true : false;
 	}
-	virtual ~PredictionTable(){}
 
-	virtual bool Prediction(unsigned char history, unsigned  = 0) = 0;
-
-	virtual void Update(unsigned char history, bool actual_prediction, unsigned int = 0) = 0;
+	virtual void Update(uint32_t history, bool actual_prediction, unsigned int entry) {
+		m_tables.Update(Index(history, entry), actual_prediction);
+		return;
+	}
 
-protected:
-	unsigned char m_table_tag_mask;
-};
+	void InitAt(unsigned entry) {
+		//reset all state machines at the table of the branch to 'WNT' (Weakly Not Taken)
+		m_tables.Reset((size_t)entry * m_row_bytes, m_row_bytes);
+		return;
+	}
 
-class LocalTable : public PredictionTable
-{
-public:
-	LocalTable(unsigned btbSize, unsigned histSize) : PredictionTable(histSize), m_tag_mask(0x1) {
+	virtual uint64_t StorageBits() const {
+		return (uint64_t)m_btb_size * m_row_size * 2;
+	}
 
-		m_tables.clear();
-		m_tables.resize(btbSize);
+	virtual void Transfer(StateArchive& archive) { m_tables.Transfer(archive); }
 
-		const unsigned table_size = (unsigned)pow(2, histSize);
-		//initialize all state machines to Weakly-Not-Taken (WNT)
-		for (size_t i = 0; i < m_tables.size(); i++){
-			m_tables[i].reserve(table_size);
-			
-			for (size_t j = 0; j < table_size; j++)
-				m_tables[i].push_back(WNT);
-		}
+private:
+	size_t Index(uint32_t history, unsigned entry) const {
+		return (size_t)entry * m_row_bytes * COUNTERS_PER_BYTE + HISTORY(history, m_table_tag_mask);
+	}
 
-		while (btbSize / 2 - 1){
-			m_tag_mask = (m_tag_mask << 1) | 0x1;
-			btbSize /= 2;
-		}
+	const unsigned m_row_size;
+	const unsigned m_row_bytes;
+	PackedCounters m_tables;
+	const unsigned m_btb_size;
+};
 
-		m_tag_mask = m_tag_mask << 2;
-	}
-	virtual ~LocalTable() {
-		m_tables.clear();
-	}
-
-	virtual bool Prediction(unsigned char history, unsigned pc) {
-		//should not happen in this stage
-		if ((TAG(pc, m_tag_mask)) >= m_tables.size() ||
-			(unsigned)(HISTORY(history, m_table_tag_mask)) >= m_tables[0].size())
-			throw std::exception();
-
-		unsigned char history_machine_state = m_tables[TAG(pc, m_tag_mask)][HISTORY(history, m_table_tag_mask)];
-		int prediction = PREDICTION(history_machine_state);
-
-		return prediction ? true : false;
-	}
-
-	virtual void Update(unsigned char history, bool actual_prediction, unsigned int pc) {
-		//should not happen in this stage
-		if ((TAG(pc, m_tag_mask)) >= m_tables.size() || 
-			(unsigned)(HISTORY(history, m_table_tag_mask)) >= m_tables[0].size())
-			throw std::exception();
-
-		//else
-		unsigned char& decision = m_tables[TAG(pc, m_tag_mask)][HISTORY(history, m_table_tag_mask)];
-		switch (decision)
-		{
-		case SNT: 
-			decision = (actual_prediction) ? (WNT) : (SNT);
-			break;
-		case WNT: 
-			decision = (actual_prediction) ? (WT) : (SNT);
-			break;
-		case WT: 
-			decision = (actual_prediction) ? (ST) : (WNT);
-			break;
-		case ST: 
-			decision = (actual_prediction) ? (ST) : (WT);
-			break;
-			//should not happen
-		default:
-			throw std::exception();
+class GlobalTable : public PredictionTable
+{
+public:
+	GlobalTable(unsigned histSize) : PredictionTable(histSize), m_tables((size_t)m_table_tag_mask + 1), m_aliasing(NULL) {}
+	virtual ~GlobalTable() {
+		if (NULL != m_aliasing) delete m_aliasing;
+	}
 
-		}
+	virtual bool Prediction(uint32_t history, unsigned = 0) {
+		return (PREDICTION(m_tables.State(HISTORY(history, m_table_tag_mask)))) ? true : false;
+	}
 
+	//the pc of the branch is needed by the aliasing analysis only
+	virtual void Update(uint32_t history, bool actual_prediction, unsigned int pc = 0) {
+		const size_t index = HISTORY(history, m_table_tag_mask);
+		if (NULL != m_aliasing)
+			m_aliasing->Update(index, pc, m_tables.State(index), actual_prediction);
+		m_tables.Update(index, actual_prediction);
 		return;
 	}
 
-	void InitAt(uint32_t pc) {
-		//should not happen
-		if (TAG(pc, m_tag_mask) >= m_tables.size())
-			throw std::exception();
-
-		const unsigned branch_tag = TAG(pc, m_tag_mask);
-		const unsigned table_size = m_tables[0].size();
-
-		//flush the table
-		m_tables[branch_tag].resize(0);
-		
-		//realloc and reset
-		m_tables[branch_tag].reserve(table_size);
+	virtual uint64_t StorageBits() const {
+		return ((uint64_t)m_table_tag_mask + 1) * 2;
+	}
 
-		//reset all state machines at the table to 'WNT' (Weakly Not Taken)
-		for (size_t i = 0; i < table_size; i++)
-			m_tables[branch_tag].push_back(WNT);
+	//the aliasing analysis is not part of the state
+	virtual void Transfer(StateArchive& archive) { m_tables.Transfer(archive); }
 
-		return;
+	void TrackAliasing(const char* name) {
+		m_aliasing = new AliasTracker(name, (size_t)m_table_tag_mask + 1);
 	}
 
+	//the aliasing analysis, NULL when it is not enabled
+	const AliasTracker* Aliasing() const { return m_aliasing; }
+
 private:
-	unsigned int m_tag_mask;
-	std::vector<std::vector<unsigned char> > m_tables;
+	PackedCounters m_tables;
+	AliasTracker* m_aliasing;
 };
 
-class GlobalTable : public PredictionTable
+//tournament predictor (as in the Alpha 21264): a local history component and a global history component
+//the local history is given by the BTB, the global history is kept by the table
+//a chooser of 2-bit state machines (indexed by the pc) selects the component, 'WT' and 'ST' select the global component
+//the chooser is trained towards the correct component when the components disagree
+class HybridTable : public PredictionTable
 {
 public:
-	GlobalTable(unsigned char histTableSize) : PredictionTable(histTableSize){
-		const unsigned table_size = (unsigned)pow(2, histTableSize);
-		m_tables.reserve(table_size);
+	HybridTable(unsigned histSize, unsigned chooserBits, bool isShare) : PredictionTable(histSize),
+		m_local(histSize), m_global(histSize), m_global_history(histSize, INDEX_BITS(histSize)),
+		m_chooser((size_t)1 << chooserBits), m_chooser_mask((0x1 << chooserBits) - 1), m_is_share(isShare),
+		m_history_size(histSize) {
+		m_stats.branches = m_stats.localCorrect = m_stats.globalCorrect = 0;
+		m_stats.chooserLocal = m_stats.chooserGlobal = m_stats.correct = 0;
+	}
+	virtual ~HybridTable() {}
 
-		for (size_t i = 0; i < table_size; i++)
-			m_tables.push_back(WNT);
+	virtual bool Prediction(uint32_t history, unsigned pc) {
+		return IsGlobalChosen(pc) ? m_global.Prediction(GlobalHistory(pc)) : m_local.Prediction(history);
+	}
 
+	virtual void Update(uint32_t history, bool actual_prediction, unsigned int pc) {
+		const uint32_t global_history = GlobalHistory(pc);
+		const bool local_prediction = m_local.Prediction(history);
+		const bool global_prediction = m_global.Prediction(global_history);
+		const bool is_global_chosen = IsGlobalChosen(pc);
+
+		m_stats.branches++;
+		m_stats.localCorrect += (local_prediction == actual_prediction);
+		m_stats.globalCorrect += (global_prediction == actual_prediction);
+		m_stats.chooserLocal += !is_global_chosen;
+		m_stats.chooserGlobal += is_global_chosen;
+		m_stats.correct += ((is_global_chosen ? global_prediction : local_prediction) == actual_prediction);
+
+		if (local_prediction != global_prediction)
+			m_chooser.Update((pc >> 2) & m_chooser_mask, global_prediction == actual_prediction);
+
+		m_local.Update(history, actual_prediction, pc);
+		m_global.Update(global_history, actual_prediction, pc);
+		m_global_history.Push(actual_prediction);
 		return;
 	}
-	virtual ~GlobalTable() {
-		m_tables.clear();
-	}
-
-	virtual bool Prediction(unsigned char history, unsigned = 0) {
-		if ((unsigned)(HISTORY(history, m_table_tag_mask)) >= m_tables.size())
-			throw std::exception();
-
-		//else 
-		return (PREDICTION(m_tables[HISTORY(history, m_table_tag_mask)])) ? true : false;
-	}
-
-	virtual void Update(unsigned char history, bool actual_prediction, unsigned int = 0) {
-		unsigned masked_history = HISTORY(history, m_table_tag_mask);
-		//should not happen here
-		if ( masked_history >= m_tables.size())
-			throw std::exception();
-
-		unsigned char& decision = m_tables[HISTORY(history, m_table_tag_mask)];
-		switch (decision)
-		{
-		case SNT:
-			decision = (actual_prediction) ? (WNT) : (SNT);
-			break;
-		case WNT:
-			decision = (actual_prediction) ? (WT) : (SNT);
-			break;
-		case WT:
-			decision = (actual_prediction) ? (ST) : (WNT);
-			break;
-		case ST:
-			decision = (actual_prediction) ? (ST) : (WT);
-			break;
-			//should not happen
-		default:
-			throw std::exception();
 
-		}
+	virtual uint64_t StorageBits() const {
+		return m_local.StorageBits() + m_global.StorageBits() + ((uint64_t)m_chooser_mask + 1) * 2 + m_history_size;
+	}
 
-		return;
+	virtual void Transfer(StateArchive& archive) {
+		m_local.Transfer(archive);
+		m_global.Transfer(archive);
+		m_global_history.Transfer(archive);
+		m_chooser.Transfer(archive);
 	}
+
+	const BP_hybridStats& Stats() const { return m_stats; }
+
+	void TrackAliasing() {
+		m_local.TrackAliasing("hybrid_local");
+		m_global.TrackAliasing("hybrid_global");
+	}
+
+	const AliasTracker* LocalAliasing() const { return m_local.Aliasing(); }
+	const AliasTracker* GlobalAliasing() const { return m_global.Aliasing(); }
+
 private:
-	std::vector<unsigned char> m_tables;
+	bool IsGlobalChosen(unsigned pc) const {
+		return PREDICTION(m_chooser.State((pc >> 2) & m_chooser_mask));
+	}
+
+	uint32_t GlobalHistory(unsigned pc) const {
+		//here the 'share' feature is implemented by bitwise XOR between the pc and the history
+		return m_global_history.Folded() ^ (m_is_share ? ((pc >> 2) & m_table_tag_mask) : 0);
+	}
+
+	GlobalTable m_local;
+	GlobalTable m_global;
+	HistoryRegister m_global_history;
+	PackedCounters m_chooser;
+	const uint32_t m_chooser_mask;
+	const bool m_is_share;
+	const unsigned m_history_size;
+	BP_hybridStats m_stats;
 };
 
 
@@ -203,82 +205,251 @@ class BranchTargetBuffer
 {
 	
 public:
-	BranchTargetBuffer(unsigned btbSize, unsigned histSize) : m_btb_tag_mask(0x1), m_history_mask(0x1){
+	//btbWays entries of every set are searched for the branch, btbTagBits 0 keeps the full pc as the tag
+	BranchTargetBuffer(const BP_config& config, unsigned histSize) : m_btb_tag_mask(0),
+		m_history_mask((0x1 << INDEX_BITS(histSize)) - 1), m_ways(config.btbWays), m_set_mask(config.btbSize / config.btbWays - 1),
+		m_set_bits(0), m_replacement(config.btbReplacement) {
+		const BTB_line empty = { 0, 0, BP_BRANCH_COND, false, 0 };
+		m_buffer.assign(config.btbSize, empty);
+
+		//the pc bits of the BTB index, the same mask as the kernel and the sliced run
+		m_btb_tag_mask = (config.btbSize - 1) << 2;
+
+		while ((m_set_mask >> m_set_bits) & 0x1)
+			m_set_bits++;
+
+		//the pc is word aligned, the bits above the set index are stored as the full tag
+		m_is_full_tag = (0 == config.btbTagBits);
+		m_tag_bits = m_is_full_tag ? 30 - m_set_bits : config.btbTagBits;
+		m_tag_mask = m_is_full_tag ? ~0u : (0x1u << m_tag_bits) - 1;
+		m_tag_shift = m_is_full_tag ? 0 : 2 + m_set_bits;
+
+		//the LRU rank of every way (0 is the most recently used), or a tree of PLRU bits for every set
+		for (size_t entry = 0; entry < m_buffer.size(); entry++)
+			m_buffer[entry].lru = (uint8_t)(entry % m_ways);
+		m_plru.assign(m_set_mask + 1, 0);
+
+		m_stats.lookups = m_stats.hits = 0;
+		m_stats.allocations = m_stats.conflictEvictions = 0;
+	}
+	virtual ~BranchTargetBuffer() {
 		m_buffer.clear();
-		m_buffer.reserve(btbSize);
+	}
 
-		for (size_t i = 0; i < btbSize; i++)
-			m_buffer.push_back(BTB_line(0, 0));
+	//looks the branch up in the ways of its set, never throws
+	//returns -1 on a tag miss (cold or aliased branch), otherwise sets the history (and the target when dst is not NULL)
+	//and returns the entry of the branch
+	virtual int Lookup(uint32_t pc, uint32_t* history, uint32_t* dst) = 0;
 
-		while (--histSize) 
-			m_history_mask = (m_history_mask << 1) | 0x1;
-		
+	//updates the entry returned by Lookup
+	virtual void Update(int entry, uint32_t targetPc, bool taken) = 0;
+
+	//allocates an entry for the branch, the victim is a free way of the set, otherwise the (pseudo) least recently used way
+	//returns false when the branch is already in the buffer
+	virtual bool InitAt(uint32_t pc) {
+		if (Find(pc) >= 0) return false;
+
+		const size_t entry = (1 == m_ways) ? Set(pc) : Victim(pc);
+		m_stats.allocations++;
+		if (m_buffer[entry].valid) m_stats.conflictEvictions++;
+
+		BTB_line& line = m_buffer[entry];
+		line.tag = Tag(pc);
+		line.target = 0;
+		line.type = BP_BRANCH_COND;
+		line.valid = true;
+		Touch(entry);
+		return true;
+	}
+
+	//the entry of the branch, -1 when it is not in the buffer
+	int Find(uint32_t pc) const {
+		const size_t first = Set(pc) * m_ways;
+		const uint32_t tag = Tag(pc);
+		if (1 == m_ways)
+			return (m_buffer[first].tag == tag && m_buffer[first].valid) ? (int)first : -1;
 
-		while ((btbSize / 2) - 1) {
-			m_btb_tag_mask = (m_btb_tag_mask << 1) | 0x1;
-			btbSize /= 2;
+		for (size_t entry = first; entry < first + m_ways; entry++) {
+			if (m_buffer[entry].tag == tag && m_buffer[entry].valid)
+				return (int)entry;
 		}
-		m_btb_tag_mask = m_btb_tag_mask << 2;
 
+		return -1;
 	}
-	virtual ~BranchTargetBuffer() {
-		m_buffer.clear();
+
+	//the type of the branch of an entry, learned when the branch is updated
+	BP_branchType Type(int entry) const {
+		return (BP_branchType)m_buffer[entry].type;
 	}
 
-	virtual unsigned char ExtractHistory(uint32_t pc, uint32_t* dst) = 0;
+	void SetType(int entry, BP_branchType type) {
+		m_buffer[entry].type = (uint8_t)type;
+	}
 
-	virtual void Update(uint32_t pc, uint32_t targetPc, bool taken) = 0;
+	//writes the target only, for the delayed update mode that has already pushed the outcome into the history
+	void UpdateTarget(int entry, uint32_t targetPc) {
+		Write(entry, targetPc);
+	}
 
-	virtual bool InitAt(uint32_t pc) {
-		if (m_buffer[TAG(pc, m_btb_tag_mask)].first == pc) return false;
+	//the history that Update pushes the outcome of the branch of an entry into, NULL when the BTB keeps no history
+	virtual HistoryRegister* History(int) { return NULL; }
 
-		m_buffer[TAG(pc, m_btb_tag_mask)] = BTB_line(pc, 0);
-		return true;
+	void CountLookup(bool is_hit) {
+		m_stats.lookups++;
+		m_stats.hits += is_hit;
+	}
+
+	//the bits of an entry: valid bit, tag, word aligned target and branch type
+	//and the bits of the replacement state
+	virtual uint64_t StorageBits() const {
+		const unsigned replacement_bits = (1 == m_ways) ? 0 :
+			(BP_BTB_PLRU == m_replacement) ? m_ways - 1 : m_ways * Log2(m_ways);
+
+		return (uint64_t)m_buffer.size() * (1 + m_tag_bits + 30 + 3) + (uint64_t)(m_set_mask + 1) * replacement_bits;
+	}
+
+	//saves or loads the entries and the replacement state (see StateArchive), the statistics are not part of the state
+	virtual void Transfer(StateArchive& archive) {
+		archive.Expect(m_buffer.size());
+		for (size_t entry = 0; entry < m_buffer.size(); entry++) {
+			BTB_line& line = m_buffer[entry];
+			archive.Value(line.valid);
+			archive.Value(line.tag);
+			archive.Value(line.target);
+			archive.Value(line.type);
+			archive.Value(line.lru);
+			archive.Check(BP_BRANCH_TYPES > line.type && m_ways > line.lru);
+		}
+
+		archive.Expect(m_plru.size());
+		for (size_t set = 0; set < m_plru.size(); set++)
+			archive.Value(m_plru[set]);
+	}
+
+	BP_btbStats Stats() const {
+		BP_btbStats stats = m_stats;
+		stats.ways = m_ways;
+		stats.sets = m_set_mask + 1;
+		stats.tagBits = m_tag_bits;
+		stats.isPartialTag = !m_is_full_tag;
+		stats.storageBits = StorageBits();
+		return stats;
 	}
 
 protected:
-	typedef std::pair<unsigned, unsigned> BTB_line;
+	struct BTB_line {
+		uint32_t tag;
+		uint32_t target;
+		uint8_t type;
+		bool valid;
+		uint8_t lru;		//the LRU rank of the way in its set
+	};
+
+	//writes the target of an entry, which becomes the most recently used of its set
+	void Write(int entry, uint32_t targetPc) {
+		m_buffer[entry].target = targetPc;
+		Touch(entry);
+	}
+
+	static unsigned Log2(unsigned value) {
+		unsigned bits = 0;
+		while (value >> (bits + 1)) bits++;
+		return bits;
+	}
+
+	size_t Set(uint32_t pc) const { return (pc >> 2) & m_set_mask; }
+	//the full tag is the pc itself, a partial tag is the bits above the set index
+	uint32_t Tag(uint32_t pc) const { return (pc >> m_tag_shift) & m_tag_mask; }
+
+	void Touch(size_t entry) {
+		if (1 == m_ways) return;
+
+		const size_t first = entry - entry % m_ways;
+		const unsigned way = entry % m_ways;
+
+		if (BP_BTB_PLRU == m_replacement) {
+			//every node of the tree points away from the way that was used last
+			uint64_t& tree = m_plru[first / m_ways];
+			const unsigned levels = Log2(m_ways);
+			for (unsigned level = 0, node = 0; level < levels; level++) {
+				const unsigned right = (way >> (levels - 1 - level)) & 0x1;
+				tree = right ? (tree & ~(0x1ull << node)) : (tree | (0x1ull << node));
+				node = 2 * node + 1 + right;
+			}
+			return;
+		}
+
+		const uint8_t rank = m_buffer[entry].lru;
+		for (size_t other = first; other < first + m_ways; other++)
+			if (m_buffer[other].lru < rank) m_buffer[other].lru++;
+		m_buffer[entry].lru = 0;
+	}
+
+	size_t Victim(uint32_t pc) const {
+		const size_t first = Set(pc) * m_ways;
+		for (size_t entry = first; entry < first + m_ways; entry++)
+			if (!m_buffer[entry].valid) return entry;
+
+		if (BP_BTB_PLRU == m_replacement) {
+			const uint64_t tree = m_plru[first / m_ways];
+			unsigned way = 0;
+			for (unsigned level = 0, node = 0; level < Log2(m_ways); level++) {
+				const unsigned right = (tree >> node) & 0x1;
+				way = (way << 1) | right;
+				node = 2 * node + 1 + right;
+			}
+			return first + way;
+		}
+
+		for (size_t entry = first; entry < first + m_ways; entry++)
+			if (m_buffer[entry].lru == m_ways - 1) return entry;
+		return first;
+	}
+
 	std::vector<BTB_line> m_buffer;
+	std::vector<uint64_t> m_plru;
 
 	unsigned int  m_btb_tag_mask;
-	unsigned char m_history_mask;
+	//the histories are folded into the bits of m_history_mask
+	unsigned int  m_history_mask;
+
+	const unsigned m_ways;
+	const uint32_t m_set_mask;
+	unsigned m_set_bits;
+	bool m_is_full_tag;
+	unsigned m_tag_bits;
+	uint32_t m_tag_mask;
+	unsigned m_tag_shift;
+	const BP_btbReplacement m_replacement;
+	BP_btbStats m_stats;
 };
 
 class LocalBTB : public BranchTargetBuffer
 {
 public:
-	LocalBTB(unsigned btbSize, unsigned histSize) : BranchTargetBuffer(btbSize, histSize) {
-		m_histories.clear();
-		m_histories.reserve(btbSize);
-
-		for (size_t i = 0; i < btbSize; i++) m_histories.push_back(0x0);
-	}
+	LocalBTB(const BP_config& config) : BranchTargetBuffer(config, config.historySize),
+		m_histories(config.btbSize, HistoryRegister(config.historySize, INDEX_BITS(config.historySize))),
+		m_history_size(config.historySize) {}
 	virtual ~LocalBTB() {
 		m_histories.clear();
 	}
 
-	virtual unsigned char ExtractHistory(uint32_t pc, uint32_t* dst) {
-		//if the tag of the pc is not found in the buffer throw an exception
-		//The branch predictor will handle it accordingly
-		if (m_buffer[TAG(pc, m_btb_tag_mask)].first != pc)
-			throw std::exception();
+	virtual int Lookup(uint32_t pc, uint32_t* history, uint32_t* dst) {
+		const int entry = Find(pc);
+		//the tag of the pc is not found in the buffer, the branch predictor will handle it accordingly
+		if (entry < 0)
+			return -1;
 
-		if(NULL != dst) *dst = m_buffer[TAG(pc, m_btb_tag_mask)].second;
-		//else
-		//in case the history is not masked (should not happen, handled by Update), mask it
-		return m_histories[TAG(pc, m_btb_tag_mask)] & m_history_mask;
+		if(NULL != dst) *dst = m_buffer[entry].target;
+		*history = m_histories[entry].Folded();
+		return entry;
 	}
 
-	virtual void Update(uint32_t pc, uint32_t targetPc, bool taken) {
-		const unsigned branch_tag = TAG(pc, m_btb_tag_mask);
-		///should not happen at this stage
-		if (m_buffer[branch_tag].first != pc)
-			throw std::exception();
+	virtual void Update(int entry, uint32_t targetPc, bool taken) {
+		Write(entry, targetPc);
 
-		m_buffer[branch_tag] = BTB_line(pc, targetPc);
-
-		//shift the history by one bit, then perform an OR operation, then mask it 
-		m_histories[branch_tag] = ((m_histories[branch_tag] << 1) | int(taken)) & m_history_mask;
+		//shift the outcome into the history, the folded history is updated in O(1)
+		m_histories[entry].Push(taken);
 		
 		return;
 	}
@@ -286,35 +457,46 @@ public:
 	virtual bool InitAt(uint32_t pc) {
 		if (!BranchTargetBuffer::InitAt(pc)) return false;
 		
-		m_histories[TAG(pc, m_btb_tag_mask)] = 0x0;
+		m_histories[Find(pc)].Clear();
 		return true;
 	}
 
+	virtual HistoryRegister* History(int entry) { return &m_histories[entry]; }
+
+	virtual uint64_t StorageBits() const {
+		return BranchTargetBuffer::StorageBits() + (uint64_t)m_histories.size() * m_history_size;
+	}
+
+	virtual void Transfer(StateArchive& archive) {
+		BranchTargetBuffer::Transfer(archive);
+		archive.Expect(m_histories.size());
+		for (size_t entry = 0; entry < m_histories.size(); entry++)
+			m_histories[entry].Transfer(archive);
+	}
+
 protected:
-	std::vector<unsigned char> m_histories;
+	std::vector<HistoryRegister> m_histories;
+	const unsigned m_history_size;
 };
 
 class LShareBTB : public LocalBTB
 {
 public:
-	LShareBTB(unsigned btbSize, unsigned histSize) : LocalBTB(btbSize, histSize) {}
+	LShareBTB(const BP_config& config) : LocalBTB(config) {}
 	virtual ~LShareBTB() {}
 
-	virtual unsigned char ExtractHistory(uint32_t pc, uint32_t* dst) {
-		//if the tag of the pc is not found in the buffer throw an exception
-		//The branch predictor will handle it accordingly
-		const unsigned branch_tag = TAG(pc, m_btb_tag_mask);
-		if (m_buffer[branch_tag].first != pc)
-			throw std::exception();
+	virtual int Lookup(uint32_t pc, uint32_t* history, uint32_t* dst) {
+		const int entry = Find(pc);
+		//the tag of the pc is not found in the buffer, the branch predictor will handle it accordingly
+		if (entry < 0)
+			return -1;
 
-		if (NULL != dst) *dst = m_buffer[branch_tag].second;
-		//else
-		//in case the history is not masked (should not happen, handled by Update), mask it
-		unsigned char char_tag = branch_tag & 0xFF;
-		char_tag &= m_history_mask;
+		if (NULL != dst) *dst = m_buffer[entry].target;
+		const unsigned masked_tag = TAG(pc, m_btb_tag_mask) & m_history_mask;
 
 		//here the 'share' feature is implemented by bitwise XOR between the tag and the history
-		return m_histories[branch_tag] ^ char_tag;
+		*history = m_histories[entry].Folded() ^ masked_tag;
+		return entry;
 	}
 
 private:
@@ -324,57 +506,64 @@ private:
 class GlobalBTB : public BranchTargetBuffer
 {
 public:
-	GlobalBTB(unsigned btbSize, unsigned histSize) : BranchTargetBuffer(btbSize, histSize), m_history(0x0) {}
+	GlobalBTB(const BP_config& config) : BranchTargetBuffer(config, config.historySize),
+		m_history(config.historySize, INDEX_BITS(config.historySize)), m_history_size(config.historySize) {}
 	virtual ~GlobalBTB() {}
 
-	virtual unsigned char ExtractHistory(uint32_t pc, uint32_t* dst) {
-		const unsigned tag = TAG(pc, m_btb_tag_mask);
-		if (m_buffer[tag].first != pc)
-			throw std::exception();
+	virtual int Lookup(uint32_t pc, uint32_t* history, uint32_t* dst) {
+		const int entry = Find(pc);
+		if (entry < 0)
+			return -1;
 
-		if(NULL != dst) *dst = m_buffer[tag].second;
+		if(NULL != dst) *dst = m_buffer[entry].target;
 
-		return m_history;
+		*history = m_history.Folded();
+		return entry;
 	}
 
-	virtual void Update(uint32_t pc, uint32_t targetPc, bool taken) {
-		const unsigned branch_tag = TAG(pc, m_btb_tag_mask);
-
-		///should not happen at this stage
-		if (m_buffer[branch_tag].first != pc)
-			throw std::exception();
+	virtual void Update(int entry, uint32_t targetPc, bool taken) {
+		Write(entry, targetPc);
 
-		m_buffer[branch_tag].second = targetPc;
-
-		//shift the history by one bit, then perform an OR operation, then mask it 
-		m_history = ((m_history << 1) | int(taken)) & m_history_mask;
+		//shift the outcome into the history, the folded history is updated in O(1)
+		m_history.Push(taken);
 
 		return;
 	}
 
+	virtual uint64_t StorageBits() const {
+		return BranchTargetBuffer::StorageBits() + m_history_size;
+	}
+
+	virtual HistoryRegister* History(int) { return &m_history; }
+
+	virtual void Transfer(StateArchive& archive) {
+		BranchTargetBuffer::Transfer(archive);
+		m_history.Transfer(archive);
+	}
 
 protected:
-	unsigned char m_history;
+	HistoryRegister m_history;
+	const unsigned m_history_size;
 };
 
 class GShareBTB : public GlobalBTB
 {
 public:
-	GShareBTB(unsigned btbSize, unsigned histSize) : GlobalBTB(btbSize, histSize) {}
+	GShareBTB(const BP_config& config) : GlobalBTB(config) {}
 	virtual ~GShareBTB() {}
 
-	virtual unsigned char ExtractHistory(uint32_t pc, uint32_t* dst) {
-		const unsigned tag = TAG(pc, m_btb_tag_mask);
-		if (m_buffer[tag].first != pc)
-			throw std::exception();
+	virtual int Lookup(uint32_t pc, uint32_t* history, uint32_t* dst) {
+		const int entry = Find(pc);
+		if (entry < 0)
+			return -1;
 
-		if (NULL != dst) *dst = m_buffer[tag].second;
+		if (NULL != dst) *dst = m_buffer[entry].target;
 
-		unsigned char char_tag = tag & 0xFF;
-		char_tag &= m_history_mask;
+		const unsigned masked_tag = TAG(pc, m_btb_tag_mask) & m_history_mask;
 
 		//here the 'share' feature is implemented by bitwise XOR between the tag and the history
-		return m_history ^ char_tag ;
+		*history = m_history.Folded() ^ masked_tag;
+		return entry;
 	}
 
 private:
@@ -382,102 +571,908 @@ private:
 };
 
 
+//a BTB that holds the targets only, for the predictors that keep their own histories
+class TargetBTB : public BranchTargetBuffer
+{
+public:
+	TargetBTB(const BP_config& config) : BranchTargetBuffer(config, 1) {}
+	virtual ~TargetBTB() {}
+
+	virtual int Lookup(uint32_t pc, uint32_t* history, uint32_t* dst) {
+		const int entry = Find(pc);
+		if (entry < 0)
+			return -1;
+
+		if (NULL != dst) *dst = m_buffer[entry].target;
+
+		*history = 0;
+		return entry;
+	}
+
+	virtual void Update(int entry, uint32_t targetPc, bool) {
+		Write(entry, targetPc);
+		return;
+	}
+};
+
+
 class BranchPredictor
 {
 public:
-	BranchPredictor() : m_btb(NULL), m_tables(NULL) {}
+	//the BTB and the target predictor of the configuration can be built
+	//the ways are a power of 2 that divides the BTB into a power of 2 of sets (the set is masked out of the pc),
+	//the partial tags are narrower than the full tag
+	static bool IsValidBtb(const BP_config& config) {
+		const unsigned sets = (0 != config.btbWays) ? config.btbSize / config.btbWays : 0;
+		return BP_MAX_RAS_ENTRIES >= config.rasEntries && MAX_TABLE_INDEX_BITS >= config.indirectIndexBits &&
+			0 != config.btbWays && BP_MAX_BTB_WAYS >= config.btbWays && 0 == (config.btbWays & (config.btbWays - 1)) &&
+			0 == config.btbSize % config.btbWays && 0 != sets && 0 == (sets & (sets - 1)) && 30 >= config.btbTagBits;
+	}
+
+	BranchPredictor() : m_kernel(NULL), m_btb(NULL), m_tables(NULL), m_local_tables(NULL), m_hybrid(NULL), m_loop(NULL),
+		m_targets(NULL), m_branch_stats(NULL), m_top_branches(0), m_delay(0), m_is_late_history(false), m_is_fetched(false), m_repairs(0) {}
 	~BranchPredictor() {
-		if(NULL != m_btb)		delete m_btb;
-		if(NULL != m_tables)	delete m_tables;
+		Release();
   }
 
-	void Reset(unsigned btbSize, unsigned historySize,
-		bool isGlobalHist, bool isGlobalTable, bool isShare) {
+	void Reset(const BP_config& config) {
+		Build(config);
+		m_config = config;
+
+		//the predictor starts from the trained state of an earlier run, instead of the cold state
+		if ('\0' != config.loadState[0] && !LoadState(config.loadState))
+			throw std::runtime_error("");
+	}
+
+	//writes the state of the predictor to a state file
+	bool SaveState(const char* path) {
+		StateArchive archive;
+		if (!archive.Create(path))
+			return false;
+
+		Transfer(archive);
+		return archive.Close();
+	}
+
+	//loads a state file saved by a predictor of the same configuration
+	//returns false when it cannot be loaded, the predictor is then reset to the cold state
+	bool LoadState(const char* path) {
+		StateArchive archive;
+		if (archive.Open(path)) {
+			Transfer(archive);
+			if (archive.Close()) {
+				m_last.is_valid = false;
+				m_in_flight.clear();
+				m_is_fetched = false;
+				return true;
+			}
+		}
+
+		BP_config config = m_config;
+		config.loadState[0] = '\0';
+		Build(config);
+		return false;
+	}
+
+	//builds the cold predictor of the configuration
+	void Build(const BP_config& config) {
 		
-		if (!isGlobalTable && isShare)
+		if ((!config.isGlobalTable && config.isShare) || 0 == config.historySize || BP_MAX_HISTORY_SIZE < config.historySize)
+			throw std::runtime_error("");
+
+		if (BP_TAGE == config.engine && (0 == config.tageTables || BP_TAGE_MAX_TABLES < config.tageTables ||
+			0 == config.tageIndexBits || MAX_TABLE_INDEX_BITS < config.tageIndexBits ||
+			2 > config.tageTagBits || 16 < config.tageTagBits))
+			throw std::runtime_error("");
+
+		if (BP_PERCEPTRON == config.engine && (0 == config.perceptronIndexBits || MAX_TABLE_INDEX_BITS < config.perceptronIndexBits))
+			throw std::runtime_error("");
+
+		if (BP_HYBRID == config.engine && (0 == config.hybridChooserBits || MAX_TABLE_INDEX_BITS < config.hybridChooserBits))
+			throw std::runtime_error("");
+
+		if (config.loopPredictor && (0 == config.loopIndexBits || MAX_TABLE_INDEX_BITS < config.loopIndexBits))
+			throw std::runtime_error("");
+
+		if (!IsValidBtb(config) || BP_MAX_UPDATE_DELAY < config.updateDelay)
 			throw std::runtime_error("");
 		
-		if (NULL != m_btb)
-			delete m_btb;
+		Release();
+
+		if (config.loopPredictor)
+			m_loop = new LoopPredictor(config.loopIndexBits);
+		m_targets = new TargetPredictor(config.rasEntries, config.indirectIndexBits);
+		if (0 != config.statsTopBranches)
+			m_branch_stats = new BranchStatsTable();
+		m_top_branches = config.statsTopBranches;
+
+		m_kernel = CreateKernel(config, m_targets);
+
+		m_delay = config.updateDelay;
+		m_is_late_history = config.lateHistory;
+		m_in_flight.clear();
+		m_is_fetched = false;
+		m_repairs = 0;
+
+		m_last.pc = 0;
+		m_last.is_valid = false;
+		for (int i = 0; i < BP_BRANCH_TYPES; i++)
+			m_target_stats.branches[i] = m_target_stats.directionMispredictions[i] = m_target_stats.targetMispredictions[i] = 0;
+
+		if (NULL != m_kernel)
+			return;
+
+		if (BP_TAGE == config.engine) {
+			m_btb = new TargetBTB(config);
+			m_tables = new TageTable(config.historySize, config.tageTables, config.tageIndexBits, config.tageTagBits);
+			return;
+		}
+
+		if (BP_PERCEPTRON == config.engine) {
+			m_btb = new TargetBTB(config);
+			m_tables = new PerceptronTable(config.historySize, config.perceptronIndexBits);
+			return;
+		}
 
-		if (isGlobalHist){
-			if (isGlobalTable)	
-				m_btb = new GShareBTB(btbSize, historySize);
+		if (BP_HYBRID == config.engine) {
+			if (config.isShare)
+				m_btb = new LShareBTB(config);
 			else
-				m_btb = new GlobalBTB(btbSize, historySize);
+				m_btb = new LocalBTB(config);
+			m_tables = m_hybrid = new HybridTable(config.historySize, config.hybridChooserBits, config.isShare);
+			if (config.aliasingAnalysis) {
+				m_hybrid->TrackAliasing();
+				m_aliasing.push_back(m_hybrid->LocalAliasing());
+				m_aliasing.push_back(m_hybrid->GlobalAliasing());
+			}
+			return;
+		}
+
+		if (config.isGlobalHist){
+			if (config.isGlobalTable)	
+				m_btb = new GShareBTB(config);
+			else
+				m_btb = new GlobalBTB(config);
 		} 
 		else{
-			if (isGlobalTable)
-				m_btb = new LShareBTB(btbSize, historySize);
+			if (config.isGlobalTable)
+				m_btb = new LShareBTB(config);
 			else	
-				m_btb = new LocalBTB(btbSize, historySize);
+				m_btb = new LocalBTB(config);
 		}
 			
-		if (isGlobalTable)
-				m_tables = new GlobalTable(historySize);
-		else	m_tables = new LocalTable(btbSize, historySize);
+		if (config.isGlobalTable) {
+			GlobalTable* global_table = new GlobalTable(config.historySize);
+			m_tables = global_table;
+			if (config.aliasingAnalysis) {
+				global_table->TrackAliasing("global_tables");
+				m_aliasing.push_back(global_table->Aliasing());
+			}
+		}
+		else	m_tables = m_local_tables = new LocalTable(config.btbSize, config.historySize);
 
-		m_is_global_table = isGlobalTable;
-		m_is_share = isShare;
 		return;
 	}
 
 	void InitAt(uint32_t pc) {
+		if (NULL != m_kernel) {
+			m_kernel->InitAt(pc);
+			return;
+		}
+
 		if (m_btb->InitAt(pc)){
-			if (!m_is_global_table)
-				dynamic_cast<LocalTable*>(m_tables)->InitAt(pc);
+			if (NULL != m_local_tables)
+				m_local_tables->InitAt(m_btb->Find(pc));
+
+			//a branch that missed in the BTB when it was predicted enters the speculative history once it is allocated
+			if (0 != m_delay && !m_is_late_history && m_is_fetched && m_fetched.pc == pc && m_fetched.entry < 0) {
+				m_fetched.entry = m_btb->Lookup(pc, &m_fetched.history, NULL);
+				PushSpeculative(m_fetched);
+			}
 		}
 
 		return;
 	}
 
 	bool Predict(uint32_t pc, uint32_t *dst) {
-		try
-		{
-			unsigned char history = m_btb->ExtractHistory(pc, dst);
-			//add here bit concatenation in case that isShare is true
-			bool prediction = m_tables->Prediction(history, pc);
-			*dst = (prediction) ? *dst : (pc + 4);
-
+		if (NULL != m_kernel) {
+			const bool prediction = m_kernel->Predict(pc, dst);
+			Remember(pc, prediction, *dst);
 			return prediction;
 		}
-		catch (const std::exception&)
-		{
-			*dst = pc + 4;
-			return false;
+
+		uint32_t history = 0;
+		bool prediction = false;
+
+		//a branch that is not in the BTB (cold or aliased) is predicted not taken
+		const int entry = m_btb->Lookup(pc, &history, dst);
+		m_btb->CountLookup(entry >= 0);
+		if (entry >= 0) {
+			const BP_branchType type = m_btb->Type(entry);
+
+			//the branches that are not conditional are always taken, the returns and the indirect branches
+			//may take their target from the target predictor
+			if (BP_BRANCH_COND != type) {
+				prediction = true;
+				m_targets->Predict(pc, type, dst);
+			}
+			else {
+				prediction = m_tables->Prediction(history, TableIndex(pc, entry));
+				if (NULL != m_loop)
+					prediction = m_loop->Prediction(pc, prediction);
+			}
 		}
+
+		if (!prediction) *dst = pc + 4;
+		Remember(pc, prediction, *dst);
+
+		if (0 != m_delay)
+			Fetch(pc, entry, history, prediction, *dst);
+		return prediction;
 	}
 
-	void Update(uint32_t pc, uint32_t targetPc, bool taken) {
-		try
-		{
-			unsigned char history = m_btb->ExtractHistory(pc, NULL);
-			m_btb->Update(pc, targetPc, taken);
-			m_tables->Update(history, taken, pc);
+	void Update(uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type) {
+		CountPrediction(pc, targetPc, taken, type);
+
+		if (NULL != m_kernel) {
+			m_kernel->Update(pc, targetPc, taken, type);
+			return;
+		}
+
+		if (0 != m_delay) {
+			Delay(pc, targetPc, taken, type);
+			return;
+		}
+
+		//the return address stack and the path history follow every branch, also the ones that miss in the BTB
+		m_targets->Update(pc, type, targetPc);
+
+		uint32_t history;
+		//a branch that is not in the BTB is not updated
+		const int entry = m_btb->Lookup(pc, &history, NULL);
+		if (entry < 0)
 			return;
+
+		m_btb->SetType(entry, type);
+
+		const unsigned table_index = TableIndex(pc, entry);
+		if (NULL != m_loop)
+			m_loop->Update(pc, taken, m_tables->Prediction(history, table_index));
+
+		m_btb->Update(entry, targetPc, taken);
+		m_tables->Update(history, taken, table_index);
+		return;
+	}
+
+	//the statistics of the hybrid predictor, NULL for the other engines
+	const BP_hybridStats* HybridStats() const {
+		return (NULL != m_hybrid) ? &m_hybrid->Stats() : NULL;
+	}
+
+	//the statistics of the loop predictor, NULL when it is not enabled
+	const BP_loopStats* LoopStats() const {
+		return (NULL != m_loop) ? &m_loop->Stats() : NULL;
+	}
+
+	const BP_targetStats& TargetStats() const { return m_target_stats; }
+
+	BP_btbStats BtbStats() const { return (NULL != m_kernel) ? m_kernel->BtbStats() : m_btb->Stats(); }
+
+	BP_stats Stats() const {
+		const BP_btbStats btb = BtbStats();
+		BP_stats stats;
+		stats.branches = stats.directionMispredictions = stats.targetMispredictions = 0;
+		for (int i = 0; i < BP_BRANCH_TYPES; i++) {
+			stats.branches += m_target_stats.branches[i];
+			stats.directionMispredictions += m_target_stats.directionMispredictions[i];
+			stats.targetMispredictions += m_target_stats.targetMispredictions[i];
 		}
-		catch (...)
-		{
+		stats.staticBranches = (NULL != m_branch_stats) ? m_branch_stats->Size() : 0;
+		stats.btbLookups = btb.lookups;
+		stats.btbHits = btb.hits;
+		stats.btbAllocations = btb.allocations;
+		stats.btbReplacements = btb.conflictEvictions;
+		stats.historyRepairs = m_repairs;
+		return stats;
+	}
+
+	//the per branch statistics, NULL when they are not counted
+	const BranchStatsTable* BranchStats() const { return m_branch_stats; }
+
+	//the number of branches listed by the report
+	unsigned TopBranches() const { return m_top_branches; }
+
+	unsigned UpdateDelay() const { return m_delay; }
+
+	//the aliasing analysis of a table, NULL when it is not enabled or there is no such table
+	const AliasTracker* Aliasing(unsigned table) const {
+		return (table < m_aliasing.size()) ? m_aliasing[table] : NULL;
+	}
+
+	//the storage of the BTB and the direction prediction tables
+	uint64_t StorageBits() const {
+		return (NULL != m_kernel) ? m_kernel->StorageBits() : m_btb->StorageBits() + m_tables->StorageBits();
+	}
+
+	//predicts, sets and updates every branch of the trace, as bp_main
+	//the loop of a specialized predictor is compiled with its parameters, when the branches are not counted one by one
+	void Run(const BP_branch* trace, size_t branches) {
+		if (NULL != m_kernel && NULL == m_branch_stats) {
+			m_kernel->Run(trace, branches, &m_target_stats);
 			return;
 		}
+
+		for (size_t i = 0; i < branches; i++) {
+			uint32_t dst;
+			Predict(trace[i].pc, &dst);
+			InitAt(trace[i].pc);
+			Update(trace[i].pc, trace[i].targetPc, trace[i].taken, trace[i].type);
+		}
 	}
 
 private:
+	//the local tables are indexed by the BTB entry of the branch, the other tables by its pc
+	unsigned TableIndex(uint32_t pc, int entry) const {
+		return (NULL != m_local_tables) ? (unsigned)entry : pc;
+	}
+
+	//the state of the predictor: the configuration, the BTB entries, the histories and the tables
+	//the statistics and the branches in flight of the delayed update mode are not part of it
+	void Transfer(StateArchive& archive) {
+		//the options that do not change the predictions (statistics, analysis, delayed update, the generic predictor)
+		//are not part of the configuration of the state
+		const uint64_t fields[] = { m_config.btbSize, m_config.historySize, m_config.isGlobalHist, m_config.isGlobalTable,
+			m_config.isShare, (uint64_t)m_config.engine, m_config.tageTables, m_config.tageIndexBits, m_config.tageTagBits,
+			m_config.perceptronIndexBits, m_config.hybridChooserBits, m_config.loopPredictor, m_config.loopIndexBits,
+			m_config.rasEntries, m_config.indirectIndexBits, m_config.btbWays, m_config.btbTagBits,
+			(uint64_t)m_config.btbReplacement };
+		for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+			archive.Expect(fields[i]);
+
+		//the specialized predictor saves the state of the generic predictor of its configuration
+		if (NULL != m_kernel)
+			m_kernel->Transfer(archive);
+		else {
+			m_btb->Transfer(archive);
+			m_tables->Transfer(archive);
+		}
+
+		if (NULL != m_loop)
+			m_loop->Transfer(archive);
+		m_targets->Transfer(archive);
+	}
+
+	//remembers the prediction, to tell direction mispredictions from target mispredictions when the branch is updated
+	void Remember(uint32_t pc, bool prediction, uint32_t target) {
+		m_last.pc = pc;
+		m_last.is_valid = true;
+		m_last.taken = prediction;
+		m_last.target = target;
+	}
+
+	void CountPrediction(uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type) {
+		//a branch updated without a prediction (or after the prediction of another branch) counts as predicted not taken
+		const bool is_predicted = m_last.is_valid && m_last.pc == pc;
+		const bool predicted_taken = is_predicted && m_last.taken;
+		m_last.is_valid = false;
+
+		const bool is_direction_mispredicted = (predicted_taken != taken);
+		const bool is_target_mispredicted = !is_direction_mispredicted && taken && m_last.target != targetPc;
+
+		m_target_stats.branches[type]++;
+		m_target_stats.directionMispredictions[type] += is_direction_mispredicted;
+		m_target_stats.targetMispredictions[type] += is_target_mispredicted;
+
+		if (NULL != m_branch_stats)
+			m_branch_stats->Count(pc, taken, is_direction_mispredicted, is_target_mispredicted);
+	}
+
+	//a branch of the delayed update mode, from its prediction until it is updated
+	struct InFlight {
+		uint32_t pc;
+		uint32_t target_pc;
+		bool taken;
+		BP_branchType type;
+		bool prediction;
+		uint32_t predicted_target;
+		int entry;							//the BTB entry that made the prediction, -1 on a BTB miss
+		uint32_t history;					//the history that indexed the tables
+		HistoryRegister* history_register;	//the history that the prediction was pushed into, NULL if none
+		HistoryRegister checkpoint;			//history_register before the prediction was pushed
+		BP_branchType predicted_type;		//the type of the BTB entry, conditional on a BTB miss
+		TargetPredictor::Checkpoint targets;	//the return address stack and the path history before the prediction
+	};
+
+	//the speculative history is updated with the prediction of the branch as soon as it is predicted,
+	//and so are the return address stack and the path history, by the type of the BTB entry
+	//a branch that is predicted but never updated keeps its prediction in the history
+	void Fetch(uint32_t pc, int entry, uint32_t history, bool prediction, uint32_t target) {
+		m_fetched.pc = pc;
+		m_fetched.prediction = prediction;
+		m_fetched.predicted_target = target;
+		m_fetched.entry = entry;
+		m_fetched.history = history;
+		m_fetched.history_register = NULL;
+		m_fetched.predicted_type = (entry >= 0) ? m_btb->Type(entry) : BP_BRANCH_COND;
+		m_targets->Save(&m_fetched.targets);
+		m_is_fetched = true;
+
+		if (m_is_late_history)
+			return;
+
+		m_targets->Speculate(pc, m_fetched.predicted_type, target);
+		if (entry >= 0)
+			PushSpeculative(m_fetched);
+	}
+
+	void PushSpeculative(InFlight& branch) {
+		branch.history_register = m_btb->History(branch.entry);
+		if (NULL == branch.history_register) return;
+
+		branch.checkpoint = *branch.history_register;
+		branch.history_register->Push(branch.prediction);
+	}
+
+	//the branch waits until m_delay younger branches are updated
+	//a mispredicted branch redirects the fetch, so the next branch is predicted only after it is updated:
+	//it is updated at once, after all the older branches in flight
+	void Delay(uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type) {
+		InFlight branch;
+		if (m_is_fetched && m_fetched.pc == pc)
+			branch = m_fetched;
+		else {
+			//updated without a prediction, the branch has no speculative history to repair
+			branch.prediction = false;
+			branch.predicted_target = pc + 4;
+			branch.entry = -1;
+			branch.history = 0;
+			branch.history_register = NULL;
+			branch.predicted_type = BP_BRANCH_COND;
+			m_targets->Save(&branch.targets);
+		}
+		m_is_fetched = false;
+
+		branch.pc = pc;
+		branch.target_pc = targetPc;
+		branch.taken = taken;
+		branch.type = type;
+		m_in_flight.push_back(branch);
+
+		const bool is_mispredicted = (branch.prediction != taken) || (taken && branch.predicted_target != targetPc);
+		while (m_in_flight.size() > (is_mispredicted ? 0 : m_delay)) {
+			Resolve(m_in_flight.front());
+			m_in_flight.pop_front();
+		}
+	}
+
+	//the update of the oldest branch in flight, as Update makes it, except that its outcome is already in the history
+	//(unless the histories are updated late)
+	void Resolve(const InFlight& branch) {
+		ResolveTargets(branch);
+
+		uint32_t history;
+		const int entry = m_btb->Lookup(branch.pc, &history, NULL);
+		if (entry < 0)
+			return;
+
+		//the state machine that made the prediction is trained, unless the branch has moved in the BTB since
+		const bool is_same_entry = (entry == branch.entry);
+		if (is_same_entry)
+			history = branch.history;
+
+		m_btb->SetType(entry, branch.type);
+
+		const unsigned table_index = TableIndex(branch.pc, entry);
+		if (NULL != m_loop)
+			m_loop->Update(branch.pc, branch.taken, m_tables->Prediction(history, table_index));
+
+		if (m_is_late_history)
+			m_btb->Update(entry, branch.target_pc, branch.taken);
+		else
+			m_btb->UpdateTarget(entry, branch.target_pc);
+		m_tables->Update(history, branch.taken, table_index);
+
+		if (is_same_entry && NULL != branch.history_register && branch.prediction != branch.taken)
+			Repair(branch);
+	}
+
+	//a mispredicted branch restores the return address stack and the path history before it is updated,
+	//a branch whose type was not known at its prediction updates them late
+	void ResolveTargets(const InFlight& branch) {
+		const bool is_mispredicted = (branch.prediction != branch.taken) ||
+			(branch.taken && branch.predicted_target != branch.target_pc);
+		if (m_is_late_history)
+			m_targets->Update(branch.pc, branch.type, branch.target_pc);
+		else if (is_mispredicted) {
+			m_targets->Restore(branch.targets);
+			m_targets->Update(branch.pc, branch.type, branch.target_pc);
+		}
+		else {
+			m_targets->Train(branch.pc, branch.type, branch.target_pc, branch.targets.path);
+			if (branch.predicted_type != branch.type)
+				m_targets->Speculate(branch.pc, branch.type, branch.target_pc);
+		}
+	}
+
+	//restores the history from the checkpoint of the mispredicted branch, with its outcome
+	//(the mispredicted branch is the youngest in flight, no younger prediction was pushed on top of it)
+	void Repair(const InFlight& branch) {
+		*branch.history_register = branch.checkpoint;
+		branch.history_register->Push(branch.taken);
+		m_repairs++;
+	}
+
+	void Release() {
+		if(NULL != m_kernel)	delete m_kernel;
+		if(NULL != m_btb)		delete m_btb;
+		if(NULL != m_tables)	delete m_tables;
+		if(NULL != m_loop)		delete m_loop;
+		if(NULL != m_targets)	delete m_targets;
+		if(NULL != m_branch_stats)	delete m_branch_stats;
+		m_kernel = NULL;
+		m_btb = NULL;
+		m_tables = NULL;
+		m_local_tables = NULL;
+		m_hybrid = NULL;
+		m_loop = NULL;
+		m_targets = NULL;
+		m_branch_stats = NULL;
+		m_aliasing.clear();
+	}
+
+	//the configuration of the last Reset
+	BP_config m_config;
+
+	//the specialized predictor of the configuration, NULL when the BTB and the tables below run it
+	PredictorKernel* m_kernel;
 	BranchTargetBuffer* m_btb;
 	PredictionTable* m_tables;
-	bool m_is_global_table;
-	bool m_is_share;
+	//the tables when they are local (a table per BTB entry), NULL otherwise
+	LocalTable* m_local_tables;
+	HybridTable* m_hybrid;
+	LoopPredictor* m_loop;
+	TargetPredictor* m_targets;
+	BranchStatsTable* m_branch_stats;
+	unsigned m_top_branches;
+	//the aliasing analysis of every shared table, owned by the tables
+	vector<const AliasTracker*> m_aliasing;
+
+	//the delayed update mode: the branch predicted last, and the branches waiting for their update (the oldest first)
+	unsigned m_delay;
+	bool m_is_late_history;
+	InFlight m_fetched;
+	bool m_is_fetched;
+	std::deque<InFlight> m_in_flight;
+	uint64_t m_repairs;
+
+	//the last prediction
+	struct {
+		uint32_t pc;
+		bool is_valid;
+		bool taken;
+		uint32_t target;
+	} m_last;
+	BP_targetStats m_target_stats;
 };
 
 
-static BranchPredictor Predictor;
+//a predictor instance of the handle API
+struct BP_predictor {
+	BranchPredictor predictor;
+};
+
+//the instance of the functions without a handle
+static BP_predictor DefaultPredictor;
 
 
 int BP_init(unsigned btbSize, unsigned historySize,
              bool isGlobalHist, bool isGlobalTable, bool isShare){
+	BP_config config;
+	BP_defaultConfig(&config, btbSize, historySize, isGlobalHist, isGlobalTable, isShare);
+	return BP_initConfig(&config);
+}
+
+void BP_defaultConfig(BP_config *config, unsigned btbSize, unsigned historySize,
+	bool isGlobalHist, bool isGlobalTable, bool isShare){
+	config->btbSize = btbSize;
+	config->historySize = historySize;
+	config->isGlobalHist = isGlobalHist;
+	config->isGlobalTable = isGlobalTable;
+	config->isShare = isShare;
+
+	config->engine = BP_TWO_LEVEL;
+
+	config->tageTables = 4;
+	config->tageIndexBits = 10;
+	config->tageTagBits = 9;
+
+	config->perceptronIndexBits = 10;
+
+	config->hybridChooserBits = 12;
+
+	config->loopPredictor = false;
+	config->loopIndexBits = 6;
+
+	config->rasEntries = 16;
+	config->indirectIndexBits = 9;
+
+	config->btbWays = 1;
+	config->btbTagBits = 0;
+	config->btbReplacement = BP_BTB_LRU;
+
+	config->statsTopBranches = 0;
+
+	config->aliasingAnalysis = false;
+
+	config->updateDelay = 0;
+	config->lateHistory = false;
+	config->genericPredictor = false;
+	config->loadState[0] = '\0';
+	config->saveState[0] = '\0';
+	return;
+}
+
+int BP_parseOption(BP_config *config, const char *option){
+	const string token(option);
+
+	if ("two_level" == token) config->engine = BP_TWO_LEVEL;
+	else if ("tage" == token) config->engine = BP_TAGE;
+	else if ("perceptron" == token) config->engine = BP_PERCEPTRON;
+	else if ("hybrid" == token) config->engine = BP_HYBRID;
+	else if ("loop" == token) config->loopPredictor = true;
+	else if ("lru" == token) config->btbReplacement = BP_BTB_LRU;
+	else if ("plru" == token) config->btbReplacement = BP_BTB_PLRU;
+	else if ("stats" == token) config->statsTopBranches = 10;
+	else if ("aliasing" == token) config->aliasingAnalysis = true;
+	else if ("late_history" == token) config->lateHistory = true;
+	else if ("generic" == token) config->genericPredictor = true;
+	else {
+		//name=value, the value is a non negative integer
+		const size_t separator = token.find('=');
+		if (string::npos == separator || separator + 1 == token.size())
+			return -1;
+
+		const string name = token.substr(0, separator);
+
+		//name=path, the state files
+		if ("load_state" == name || "save_state" == name) {
+			const string path = token.substr(separator + 1);
+			if (BP_MAX_STATE_PATH <= path.size())
+				return -1;
+
+			strcpy(("load_state" == name) ? config->loadState : config->saveState, path.c_str());
+			return 0;
+		}
+
+		char* end = NULL;
+		const unsigned value = strtoul(token.c_str() + separator + 1, &end, 0);
+		if ('\0' != *end)
+			return -1;
+
+		if ("tage_tables" == name)				config->tageTables = value;
+		else if ("tage_index_bits" == name)		config->tageIndexBits = value;
+		else if ("tage_tag_bits" == name)		config->tageTagBits = value;
+		else if ("perceptron_index_bits" == name)	config->perceptronIndexBits = value;
+		else if ("hybrid_chooser_bits" == name)	config->hybridChooserBits = value;
+		else if ("loop_index_bits" == name)		config->loopIndexBits = value;
+		else if ("ras_entries" == name)			config->rasEntries = value;
+		else if ("indirect_index_bits" == name)	config->indirectIndexBits = value;
+		else if ("btb_ways" == name)			config->btbWays = value;
+		else if ("btb_tag_bits" == name)		config->btbTagBits = value;
+		else if ("stats" == name)				config->statsTopBranches = value;
+		else if ("update_delay" == name)		config->updateDelay = value;
+		else return -1;
+	}
+
+	return 0;
+}
+
+int BP_initConfig(const BP_config *config){
+	return BP_predictorInit(&DefaultPredictor, config);
+}
+
+int BP_saveState(const char *path){
+	return BP_predictorSaveState(&DefaultPredictor, path);
+}
+
+int BP_loadState(const char *path){
+	return BP_predictorLoadState(&DefaultPredictor, path);
+}
+
+BP_predictor* BP_create(const BP_config *config){
+	BP_predictor* predictor = NULL;
+	try
+	{
+		predictor = new BP_predictor;
+		predictor->predictor.Reset(*config);
+	}
+	catch (const std::bad_alloc& AllocExp)
+	{
+		AllocExp.what();
+		delete predictor;
+		return NULL;
+	}
+	catch (const std::runtime_error& RTExp) {
+		RTExp.what();
+		delete predictor;
+		return NULL;
+	}
+
+	return predictor;
+}
+
+void BP_destroy(BP_predictor *predictor){
+	delete predictor;
+	return;
+}
+
+int BP_predictorInit(BP_predictor *predictor, const BP_config *config){
 	try
 	{
-		Predictor.Reset(btbSize, historySize, isGlobalHist, isGlobalTable, isShare);
+		predictor->predictor.Reset(*config);
+	}
+	catch (const std::bad_alloc& AllocExp)
+	{
+		AllocExp.what();
+		return -1;
+	}
+	catch (const std::runtime_error& RTExp) {
+		RTExp.what();
+		return -1;
+	}
+
+	return 0;
+}
+
+int BP_predictorSaveState(BP_predictor *predictor, const char *path){
+	return predictor->predictor.SaveState(path) ? 0 : -1;
+}
+
+int BP_predictorLoadState(BP_predictor *predictor, const char *path){
+	try
+	{
+		if (!predictor->predictor.LoadState(path))
+			return -1;
+	}
+	catch (const std::bad_alloc& AllocExp)
+	{
+		AllocExp.what();
+		return -1;
+	}
+
+	return 0;
+}
+
+int BP_run(const BP_config *config, const BP_branch *trace, size_t branches, BP_runStats *stats){
+	return BP_runWarm(config, NULL, 0, trace, branches, stats);
+}
+
+//the branches and the mispredictions counted by the predictor so far
+static void CountRun(const BranchPredictor& predictor, BP_runStats* stats) {
+	const BP_targetStats& targets = predictor.TargetStats();
+	stats->branches = stats->directionMispredictions = stats->targetMispredictions = 0;
+	for (int i = 0; i < BP_BRANCH_TYPES; i++) {
+		stats->branches += targets.branches[i];
+		stats->directionMispredictions += targets.directionMispredictions[i];
+		stats->targetMispredictions += targets.targetMispredictions[i];
+	}
+	stats->storageBits = predictor.StorageBits();
+}
+
+int BP_runWarm(const BP_config *config, const BP_branch *warmup, size_t warmupBranches,
+	const BP_branch *trace, size_t branches, BP_runStats *stats){
+	try
+	{
+		BranchPredictor predictor;
+		predictor.Reset(*config);
+
+		//the warm-up branches train the predictor, and are taken out of the counts
+		BP_runStats warm;
+		predictor.Run(warmup, warmupBranches);
+		CountRun(predictor, &warm);
+
+		predictor.Run(trace, branches);
+		CountRun(predictor, stats);
+		stats->branches -= warm.branches;
+		stats->directionMispredictions -= warm.directionMispredictions;
+		stats->targetMispredictions -= warm.targetMispredictions;
+	}
+	catch (const std::bad_alloc& AllocExp)
+	{
+		AllocExp.what();
+		return -1;
+	}
+	catch (const std::runtime_error& RTExp) {
+		RTExp.what();
+		return -1;
+	}
+
+	return 0;
+}
+
+//the configurations of a sliced run differ in their history size (and share) only
+//the lanes start cold, a configuration that loads a state file runs on a predictor of its own (BP_run)
+static bool IsSliceable(const BP_config& config, const BP_config& first) {
+	return BP_TWO_LEVEL == config.engine && config.isGlobalHist && config.isGlobalTable && !config.loopPredictor &&
+		'\0' == config.loadState[0] &&
+		0 < config.historySize && MAX_TABLE_INDEX_BITS >= config.historySize &&
+		config.btbSize == first.btbSize && config.btbWays == first.btbWays && config.btbTagBits == first.btbTagBits &&
+		config.btbReplacement == first.btbReplacement && config.rasEntries == first.rasEntries &&
+		config.indirectIndexBits == first.indirectIndexBits && 0 == config.updateDelay;
+}
+
+int BP_runSliced(const BP_config *configs, unsigned count, const BP_branch *trace, size_t branches, BP_runStats *stats){
+	if (0 == count || BITSLICE_LANES < count)
+		return -1;
+
+	vector<unsigned> history_sizes;
+	vector<bool> is_share;
+	for (unsigned lane = 0; lane < count; lane++) {
+		if (!IsSliceable(configs[lane], configs[0]))
+			return -1;
+		history_sizes.push_back(configs[lane].historySize);
+		//as BranchPredictor::Reset, that gives every global history global tables configuration a GShareBTB
+		is_share.push_back(true);
+	}
+
+	const uint64_t all_lanes = (BITSLICE_LANES == count) ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+	const uint32_t btb_tag_mask = (configs[0].btbSize - 1) << 2;
+
+	try
+	{
+		if (!BranchPredictor::IsValidBtb(configs[0]))
+			throw std::runtime_error("");
+
+		//the BTB, the target predictor and the global history follow the same branches in all the lanes
+		TargetBTB btb(configs[0]);
+		TargetPredictor targets(configs[0].rasEntries, configs[0].indirectIndexBits);
+		HistoryBuffer history(MAX_TABLE_INDEX_BITS);
+		BitSlicedTables tables(history_sizes, is_share);
+		LaneCounters direction_mispredictions, target_mispredictions;
+
+		for (size_t i = 0; i < branches; i++) {
+			const BP_branch& branch = trace[i];
+			const uint32_t recent = (uint32_t)history.Recent();
+			const uint32_t pc_bits = TAG(branch.pc, btb_tag_mask);
+
+			//the prediction of every lane, as BranchPredictor::Predict makes it
+			uint32_t unused, dst = branch.pc + 4;
+			uint64_t taken_lanes = 0;
+			int entry = btb.Lookup(branch.pc, &unused, &dst);
+			if (entry >= 0) {
+				const BP_branchType type = btb.Type(entry);
+				if (BP_BRANCH_COND != type) {
+					taken_lanes = all_lanes;
+					targets.Predict(branch.pc, type, &dst);
+				}
+				else taken_lanes = tables.Prediction(recent, pc_bits);
+			}
+
+			direction_mispredictions.Add(taken_lanes ^ (branch.taken ? all_lanes : 0));
+			if (branch.taken && dst != branch.targetPc)
+				target_mispredictions.Add(taken_lanes);
+
+			btb.InitAt(branch.pc);
+
+			//the update, as BranchPredictor::Update makes it
+			targets.Update(branch.pc, branch.type, branch.targetPc);
+			entry = btb.Lookup(branch.pc, &unused, NULL);
+			if (entry < 0) continue;
+
+			btb.SetType(entry, branch.type);
+			btb.Update(entry, branch.targetPc, branch.taken);
+			tables.Update(recent, pc_bits, branch.taken);
+			history.Push(branch.taken);
+		}
+
+		for (unsigned lane = 0; lane < count; lane++) {
+			stats[lane].branches = branches;
+			stats[lane].directionMispredictions = direction_mispredictions.Total(lane);
+			stats[lane].targetMispredictions = target_mispredictions.Total(lane);
+			//the storage of a GShareBTB and its GlobalTable
+			stats[lane].storageBits = btb.StorageBits() + configs[lane].historySize +
+				((uint64_t)1 << configs[lane].historySize) * 2;
+		}
 	}
 	catch (const std::bad_alloc& AllocExp)
 	{
@@ -488,23 +1483,277 @@ int BP_init(unsigned btbSize, unsigned historySize,
 		RTExp.what();
 		return -1;
 	}
-	
-	if (!isGlobalTable && isShare) return -1;
 
 	return 0;
 }
 
+bool BP_predictorPredict(BP_predictor *predictor, uint32_t pc, uint32_t *dst){
+
+	return predictor->predictor.Predict(pc, dst);
+}
+
 bool BP_predict(uint32_t pc, uint32_t *dst){
+	return BP_predictorPredict(&DefaultPredictor, pc, dst);
+}
 
-	return Predictor.Predict(pc, dst);
+void BP_predictorSetBranchAt(BP_predictor *predictor, uint32_t pc){
+	predictor->predictor.InitAt(pc);
+	return;
 }
 
 void BP_setBranchAt(uint32_t pc){
-	Predictor.InitAt(pc);
+	BP_predictorSetBranchAt(&DefaultPredictor, pc);
+	return;
+}
+
+void BP_predictorUpdate(BP_predictor *predictor, uint32_t pc, uint32_t targetPc, bool taken){
+	predictor->predictor.Update(pc, targetPc, taken, BP_BRANCH_COND);
 	return;
 }
 
 void BP_update(uint32_t pc, uint32_t targetPc, bool taken){
-	Predictor.Update(pc, targetPc, taken);
+	BP_predictorUpdate(&DefaultPredictor, pc, targetPc, taken);
+	return;
+}
+
+void BP_predictorUpdateTyped(BP_predictor *predictor, uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type){
+	predictor->predictor.Update(pc, targetPc, taken, type);
+	return;
+}
+
+void BP_updateTyped(uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type){
+	BP_predictorUpdateTyped(&DefaultPredictor, pc, targetPc, taken, type);
+	return;
+}
+
+void BP_predictorRun(BP_predictor *predictor, const BP_branch *trace, size_t branches){
+	predictor->predictor.Run(trace, branches);
+	return;
+}
+
+//the number of pairs of branches listed by the aliasing report of a table
+#define ALIASING_REPORT_PAIRS 10
+
+static const char* branch_type_names[BP_BRANCH_TYPES] = { "cond", "uncond", "call", "ret", "indirect" };
+
+int BP_parseBranchType(const char *name, BP_branchType *type){
+	for (int i = 0; i < BP_BRANCH_TYPES; i++) {
+		if (string(branch_type_names[i]) != name) continue;
+
+		*type = (BP_branchType)i;
+		return 0;
+	}
+
+	return -1;
+}
+
+int BP_predictorGetHybridStats(BP_predictor *predictor, BP_hybridStats *stats){
+	const BP_hybridStats* hybrid_stats = predictor->predictor.HybridStats();
+	if (NULL == hybrid_stats) return -1;
+
+	*stats = *hybrid_stats;
+	return 0;
+}
+
+int BP_getHybridStats(BP_hybridStats *stats){
+	return BP_predictorGetHybridStats(&DefaultPredictor, stats);
+}
+
+void BP_predictorGetTargetStats(BP_predictor *predictor, BP_targetStats *stats){
+	*stats = predictor->predictor.TargetStats();
+	return;
+}
+
+void BP_getTargetStats(BP_targetStats *stats){
+	BP_predictorGetTargetStats(&DefaultPredictor, stats);
+	return;
+}
+
+void BP_predictorGetBtbStats(BP_predictor *predictor, BP_btbStats *stats){
+	*stats = predictor->predictor.BtbStats();
+	return;
+}
+
+void BP_getBtbStats(BP_btbStats *stats){
+	BP_predictorGetBtbStats(&DefaultPredictor, stats);
+	return;
+}
+
+int BP_predictorGetLoopStats(BP_predictor *predictor, BP_loopStats *stats){
+	const BP_loopStats* loop_stats = predictor->predictor.LoopStats();
+	if (NULL == loop_stats) return -1;
+
+	*stats = *loop_stats;
+	return 0;
+}
+
+int BP_getLoopStats(BP_loopStats *stats){
+	return BP_predictorGetLoopStats(&DefaultPredictor, stats);
+}
+
+void BP_predictorGetStats(BP_predictor *predictor, BP_stats *stats){
+	*stats = predictor->predictor.Stats();
+	return;
+}
+
+void BP_getStats(BP_stats *stats){
+	BP_predictorGetStats(&DefaultPredictor, stats);
+	return;
+}
+
+unsigned BP_predictorGetTopBranches(BP_predictor *predictor, BP_branchStats *branches, unsigned count){
+	const BranchStatsTable* branch_stats = predictor->predictor.BranchStats();
+	return (NULL != branch_stats) ? branch_stats->Top(branches, count) : 0;
+}
+
+unsigned BP_getTopBranches(BP_branchStats *branches, unsigned count){
+	return BP_predictorGetTopBranches(&DefaultPredictor, branches, count);
+}
+
+int BP_predictorGetAliasingStats(BP_predictor *predictor, unsigned table, BP_aliasingStats *stats){
+	const AliasTracker* aliasing = predictor->predictor.Aliasing(table);
+	if (NULL == aliasing) return -1;
+
+	*stats = aliasing->Stats();
+	return 0;
+}
+
+int BP_getAliasingStats(unsigned table, BP_aliasingStats *stats){
+	return BP_predictorGetAliasingStats(&DefaultPredictor, table, stats);
+}
+
+unsigned BP_predictorGetAliasingPairs(BP_predictor *predictor, unsigned table, BP_aliasingPair *pairs, unsigned count){
+	const AliasTracker* aliasing = predictor->predictor.Aliasing(table);
+	return (NULL != aliasing) ? aliasing->Pairs(pairs, count) : 0;
+}
+
+unsigned BP_getAliasingPairs(unsigned table, BP_aliasingPair *pairs, unsigned count){
+	return BP_predictorGetAliasingPairs(&DefaultPredictor, table, pairs, count);
+}
+
+static double Percent(uint64_t part, uint64_t total) {
+	return (0 == total) ? 0.0 : 100.0 * part / total;
+}
+
+void BP_predictorPrintReport(BP_predictor *predictor, FILE *out){
+	BP_hybridStats hybrid;
+	if (0 == BP_predictorGetHybridStats(predictor, &hybrid)) {
+		fprintf(out, "hybrid: %llu branches, accuracy %.2f%%\n", (unsigned long long)hybrid.branches,
+			Percent(hybrid.correct, hybrid.branches));
+		fprintf(out, "hybrid: local component accuracy %.2f%%, chosen %llu times (%.2f%%)\n",
+			Percent(hybrid.localCorrect, hybrid.branches), (unsigned long long)hybrid.chooserLocal,
+			Percent(hybrid.chooserLocal, hybrid.branches));
+		fprintf(out, "hybrid: global component accuracy %.2f%%, chosen %llu times (%.2f%%)\n",
+			Percent(hybrid.globalCorrect, hybrid.branches), (unsigned long long)hybrid.chooserGlobal,
+			Percent(hybrid.chooserGlobal, hybrid.branches));
+	}
+
+	BP_loopStats loop;
+	if (0 == BP_predictorGetLoopStats(predictor, &loop)) {
+		fprintf(out, "loop: %llu overrides of %llu branches, accuracy %.2f%%\n", (unsigned long long)loop.overrides,
+			(unsigned long long)loop.branches, Percent(loop.overridesCorrect, loop.overrides));
+		fprintf(out, "loop: %llu mispredictions removed, %llu added, %lld net removed\n",
+			(unsigned long long)loop.mispredictionsRemoved, (unsigned long long)loop.mispredictionsAdded,
+			(long long)loop.mispredictionsRemoved - (long long)loop.mispredictionsAdded);
+	}
+
+	//the BTB report is printed for the set associative or partially tagged BTBs only
+	BP_btbStats btb;
+	BP_predictorGetBtbStats(predictor, &btb);
+	if (1 != btb.ways || btb.isPartialTag) {
+		fprintf(out, "btb: %u sets x %u ways, %u bit tags, %llu bits of storage\n", btb.sets, btb.ways, btb.tagBits,
+			(unsigned long long)btb.storageBits);
+		fprintf(out, "btb: hit rate %.2f%% of %llu lookups, %llu allocations, %llu conflict evictions\n",
+			Percent(btb.hits, btb.lookups), (unsigned long long)btb.lookups, (unsigned long long)btb.allocations,
+			(unsigned long long)btb.conflictEvictions);
+	}
+
+	//the target report is printed for the traces that have branch types only
+	BP_targetStats targets;
+	BP_predictorGetTargetStats(predictor, &targets);
+	uint64_t branches = 0, typed_branches = 0, direction_mispredictions = 0, target_mispredictions = 0;
+	for (int i = 0; i < BP_BRANCH_TYPES; i++) {
+		branches += targets.branches[i];
+		typed_branches += (BP_BRANCH_COND != i) ? targets.branches[i] : 0;
+		direction_mispredictions += targets.directionMispredictions[i];
+		target_mispredictions += targets.targetMispredictions[i];
+	}
+
+	if (0 != typed_branches) {
+		fprintf(out, "targets: %llu branches, direction misprediction rate %.2f%%, target misprediction rate %.2f%%\n",
+			(unsigned long long)branches, Percent(direction_mispredictions, branches), Percent(target_mispredictions, branches));
+		for (int i = 0; i < BP_BRANCH_TYPES; i++) {
+			if (0 == targets.branches[i]) continue;
+			fprintf(out, "targets: %-8s %llu branches, direction misprediction rate %.2f%%, target misprediction rate %.2f%%\n",
+				branch_type_names[i], (unsigned long long)targets.branches[i],
+				Percent(targets.directionMispredictions[i], targets.branches[i]),
+				Percent(targets.targetMispredictions[i], targets.branches[i]));
+		}
+	}
+
+	//the statistics report is printed when the per branch statistics are counted
+	if (0 != predictor->predictor.TopBranches()) {
+		BP_stats stats;
+		BP_predictorGetStats(predictor, &stats);
+		const uint64_t mispredictions = stats.directionMispredictions + stats.targetMispredictions;
+		fprintf(out, "stats: %llu branches, %llu static branches, direction accuracy %.2f%%, target accuracy %.2f%%\n",
+			(unsigned long long)stats.branches, (unsigned long long)stats.staticBranches,
+			100.0 - Percent(stats.directionMispredictions, stats.branches), 100.0 - Percent(stats.targetMispredictions, stats.branches));
+		//the traces hold branches only, so the mispredictions are per 1000 branches rather than per 1000 instructions
+		fprintf(out, "stats: %llu mispredictions, %.2f per 1000 branches\n", (unsigned long long)mispredictions,
+			(0 == stats.branches) ? 0.0 : 1000.0 * mispredictions / stats.branches);
+		fprintf(out, "stats: btb hit rate %.2f%% of %llu lookups, %llu allocations, %llu replacements\n",
+			Percent(stats.btbHits, stats.btbLookups), (unsigned long long)stats.btbLookups,
+			(unsigned long long)stats.btbAllocations, (unsigned long long)stats.btbReplacements);
+
+		vector<BP_branchStats> top(predictor->predictor.TopBranches());
+		const unsigned count = BP_predictorGetTopBranches(predictor, top.data(), (unsigned)top.size());
+		fprintf(out, "stats: the %u most mispredicted branches\n", count);
+		for (unsigned i = 0; i < count; i++) {
+			const uint64_t branch_mispredictions = top[i].directionMispredictions + top[i].targetMispredictions;
+			fprintf(out, "stats: %2u. 0x%08x %llu executions, taken %.2f%%, %llu direction and %llu target mispredictions "
+				"(%.2f%% of the executions, %.2f%% of all mispredictions)\n", i + 1, top[i].pc,
+				(unsigned long long)top[i].executions, Percent(top[i].taken, top[i].executions),
+				(unsigned long long)top[i].directionMispredictions, (unsigned long long)top[i].targetMispredictions,
+				Percent(branch_mispredictions, top[i].executions), Percent(branch_mispredictions, mispredictions));
+		}
+	}
+
+	//the delayed update report is printed in the delayed update mode only
+	if (0 != predictor->predictor.UpdateDelay()) {
+		BP_stats stats;
+		BP_predictorGetStats(predictor, &stats);
+		fprintf(out, "delay: updated %u branches late, %llu mispredictions, %llu history repairs\n",
+			predictor->predictor.UpdateDelay(), (unsigned long long)(stats.directionMispredictions + stats.targetMispredictions),
+			(unsigned long long)stats.historyRepairs);
+	}
+
+	BP_aliasingStats aliasing;
+	for (unsigned table = 0; 0 == BP_predictorGetAliasingStats(predictor, table, &aliasing); table++) {
+		fprintf(out, "aliasing: %s: %llu state machines, %llu used, %llu shared (by up to %llu branches)\n", aliasing.table,
+			(unsigned long long)aliasing.entries, (unsigned long long)aliasing.usedEntries,
+			(unsigned long long)aliasing.sharedEntries, (unsigned long long)aliasing.maxBranchesPerEntry);
+		fprintf(out, "aliasing: %s: %llu accesses, %llu aliased: %llu constructive, %llu destructive, %llu neutral\n",
+			aliasing.table, (unsigned long long)aliasing.accesses, (unsigned long long)aliasing.aliasedAccesses,
+			(unsigned long long)aliasing.constructive, (unsigned long long)aliasing.destructive,
+			(unsigned long long)aliasing.neutral);
+		const long long net_mispredictions = (long long)aliasing.destructive - (long long)aliasing.constructive;
+		fprintf(out, "aliasing: %s: %lld mispredictions due to aliasing (%.2f%% of the accesses)\n", aliasing.table,
+			net_mispredictions, (0 == aliasing.accesses) ? 0.0 : 100.0 * net_mispredictions / aliasing.accesses);
+
+		BP_aliasingPair pairs[ALIASING_REPORT_PAIRS];
+		const unsigned count = BP_predictorGetAliasingPairs(predictor, table, pairs, ALIASING_REPORT_PAIRS);
+		for (unsigned i = 0; i < count; i++) {
+			fprintf(out, "aliasing: %s: %2u. 0x%08x aliased by 0x%08x: %llu destructive, %llu constructive\n", aliasing.table,
+				i + 1, pairs[i].pc, pairs[i].otherPc, (unsigned long long)pairs[i].destructive,
+				(unsigned long long)pairs[i].constructive);
+		}
+	}
+
+	return;
+}
+
+void BP_printReport(FILE *out){
+	BP_predictorPrintReport(&DefaultPredictor, out);
 	return;
 }
@@ -0,0 +1,96 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Aliasing analysis of the state machines that the branches share in the global tables */
+
+#include "bp_alias.h"
+#include "bp_tables.h"
+#include <algorithm>
+
+static int64_t NetMispredictions(const BP_aliasingPair& pair) {
+	return (int64_t)pair.destructive - (int64_t)pair.constructive;
+}
+
+static bool IsWorsePair(const BP_aliasingPair& a, const BP_aliasingPair& b) {
+	if (NetMispredictions(a) != NetMispredictions(b)) return NetMispredictions(a) > NetMispredictions(b);
+	if (a.destructive != b.destructive) return a.destructive > b.destructive;
+	if (a.pc != b.pc) return a.pc < b.pc;
+	return a.otherPc < b.otherPc;
+}
+
+AliasTracker::AliasTracker(const char* name, size_t entries) {
+	Entry unused = { 0, 0, 0 };
+	m_entries.assign(entries, unused);
+
+	m_stats.table = name;
+	m_stats.entries = entries;
+	m_stats.usedEntries = m_stats.sharedEntries = m_stats.maxBranchesPerEntry = 0;
+	m_stats.accesses = m_stats.aliasedAccesses = 0;
+	m_stats.constructive = m_stats.destructive = m_stats.neutral = 0;
+}
+
+void AliasTracker::Update(size_t entry, uint32_t pc, unsigned char shared_state, bool taken) {
+	Entry& shared = m_entries[entry];
+
+	//a branch that is new to the entry starts its private state machine where all the state machines start
+	const std::pair<PrivateStates::iterator, bool> inserted = m_private.insert(std::make_pair(Key((uint32_t)entry, pc), WNT));
+	unsigned char& private_state = inserted.first->second;
+	if (inserted.second && 0 == shared.branches++)
+		shared.last_pc = pc;
+
+	if (shared.last_pc != pc) {
+		shared.other_pc = shared.last_pc;
+		shared.last_pc = pc;
+	}
+
+	m_stats.accesses++;
+	//the shared and the private state machines are the same until another branch uses the entry
+	if (shared.branches > 1) {
+		m_stats.aliasedAccesses++;
+
+		const bool shared_prediction = PREDICTION(shared_state);
+		const bool private_prediction = PREDICTION(private_state);
+		if (shared_prediction == private_prediction)
+			m_stats.neutral++;
+		else {
+			PairCounts& pair = m_pairs[Key(pc, shared.other_pc)];
+			if (shared_prediction == taken) {
+				m_stats.constructive++;
+				pair.constructive++;
+			}
+			else {
+				m_stats.destructive++;
+				pair.destructive++;
+			}
+		}
+	}
+
+	private_state = taken ? (private_state + (private_state != ST)) : (private_state - (private_state != SNT));
+}
+
+BP_aliasingStats AliasTracker::Stats() const {
+	BP_aliasingStats stats = m_stats;
+	for (size_t entry = 0; entry < m_entries.size(); entry++) {
+		const uint32_t branches = m_entries[entry].branches;
+		stats.usedEntries += (0 != branches);
+		stats.sharedEntries += (branches > 1);
+		stats.maxBranchesPerEntry = std::max(stats.maxBranchesPerEntry, (uint64_t)branches);
+	}
+	return stats;
+}
+
+unsigned AliasTracker::Pairs(BP_aliasingPair* pairs, unsigned count) const {
+	std::vector<BP_aliasingPair> all;
+	all.reserve(m_pairs.size());
+	for (std::unordered_map<uint64_t, PairCounts>::const_iterator it = m_pairs.begin(); it != m_pairs.end(); ++it) {
+		BP_aliasingPair pair;
+		pair.pc = (uint32_t)(it->first >> 32);
+		pair.otherPc = (uint32_t)it->first;
+		pair.constructive = it->second.constructive;
+		pair.destructive = it->second.destructive;
+		all.push_back(pair);
+	}
+
+	const size_t top = std::min((size_t)count, all.size());
+	std::partial_sort(all.begin(), all.begin() + top, all.end(), IsWorsePair);
+	std::copy(all.begin(), all.begin() + top, pairs);
+	return (unsigned)top;
+}
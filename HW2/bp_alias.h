@@ -0,0 +1,52 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Aliasing analysis of the state machines that the branches share in the global tables */
+
+#ifndef BP_ALIAS_H_
+#define BP_ALIAS_H_
+
+#include "bp_api.h"
+#include <vector>
+#include <unordered_map>
+
+//follows the branches that use every state machine of a shared table
+//every branch also gets a private state machine for every entry it uses, trained as if no other branch touched
+//the entry, so an aliased access is classified by the prediction it would have had without the other branches
+class AliasTracker
+{
+public:
+	AliasTracker(const char* name, size_t entries);
+	~AliasTracker() {}
+
+	//the branch pc is updated with taken at entry, shared_state is the state of the shared state machine before the update
+	void Update(size_t entry, uint32_t pc, unsigned char shared_state, bool taken);
+
+	BP_aliasingStats Stats() const;
+
+	//up to count pairs with the most mispredictions due to aliasing (destructive less constructive), the worst first
+	unsigned Pairs(BP_aliasingPair* pairs, unsigned count) const;
+
+private:
+	struct Entry {
+		uint32_t last_pc;		//the last branch that used the entry
+		uint32_t other_pc;		//the last branch other than last_pc that used the entry
+		uint32_t branches;		//the number of branches that used the entry
+	};
+
+	struct PairCounts {
+		uint64_t constructive;
+		uint64_t destructive;
+	};
+
+	typedef std::unordered_map<uint64_t, unsigned char> PrivateStates;
+
+	static uint64_t Key(uint32_t high, uint32_t low) { return ((uint64_t)high << 32) | low; }
+
+	std::vector<Entry> m_entries;
+	//the private state machines, by entry and pc
+	PrivateStates m_private;
+	//the aliased accesses that changed the prediction, by the pc of the branch and the pc of the other branch
+	std::unordered_map<uint64_t, PairCounts> m_pairs;
+	BP_aliasingStats m_stats;
+};
+
+#endif /* BP_ALIAS_H_ */
@@ -16,6 +16,216 @@ extern "C" {
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+
+/* The maximal history length (in branches) of the predictor
+ * histories longer than 16 branches are folded to 16 bits to index the prediction tables
+ */
+#define BP_MAX_HISTORY_SIZE 1024
+
+#define BP_TAGE_MAX_TABLES 12 /* Maximal number of tagged tables of the TAGE predictor */
+#define BP_MAX_RAS_ENTRIES 1024 /* Maximal number of entries of the return address stack */
+#define BP_MAX_BTB_WAYS 64 /* Maximal associativity of the BTB */
+#define BP_MAX_UPDATE_DELAY 4096 /* Maximal number of branches in flight of the delayed update mode */
+#define BP_MAX_STATE_PATH 256 /* Maximal length of the path of a state file, with the terminating null */
+
+/* The branch types, given by an optional fourth field of the trace lines (the default is "cond") */
+typedef enum {
+    BP_BRANCH_COND = 0, /* "cond" - conditional direct branch */
+    BP_BRANCH_UNCOND,   /* "uncond" - unconditional direct jump */
+    BP_BRANCH_CALL,     /* "call" - direct call, pushes the return address */
+    BP_BRANCH_RET,      /* "ret" - return, pops the return address */
+    BP_BRANCH_INDIRECT, /* "indirect" - indirect jump */
+    BP_BRANCH_TYPES
+} BP_branchType;
+
+/* The predictor engines
+ * selected by an optional field of the config line, after the five standard fields (see BP_parseOption)
+ */
+typedef enum {
+    BP_TWO_LEVEL = 0, /* "two_level" - the two-level predictor described by the five standard fields (default) */
+    BP_TAGE,          /* "tage" - TAGE predictor, historySize is the longest history of its tagged tables */
+    BP_PERCEPTRON,    /* "perceptron" - hashed perceptron predictor, historySize is the number of weights of a branch */
+    BP_HYBRID         /* "hybrid" - tournament of a local history and a global history component (isShare applies to both) */
+} BP_engine;
+
+/* The replacement policy of a set associative BTB */
+typedef enum {
+    BP_BTB_LRU = 0, /* "lru" - least recently used */
+    BP_BTB_PLRU     /* "plru" - tree pseudo least recently used */
+} BP_btbReplacement;
+
+/* The full predictor configuration */
+typedef struct {
+    /* The five standard fields of the config line */
+    unsigned btbSize;
+    unsigned historySize;
+    bool isGlobalHist;
+    bool isGlobalTable;
+    bool isShare;
+
+    BP_engine engine;
+
+    /* TAGE (engine BP_TAGE) */
+    unsigned tageTables;    /* Number of tagged tables, 1 to BP_TAGE_MAX_TABLES ("tage_tables=N", default 4) */
+    unsigned tageIndexBits; /* log2 of the number of entries of every tagged table ("tage_index_bits=N", default 10) */
+    unsigned tageTagBits;   /* Width of the partial tags of the tagged tables ("tage_tag_bits=N", default 9) */
+
+    /* Perceptron (engine BP_PERCEPTRON) */
+    unsigned perceptronIndexBits; /* log2 of the number of weight vectors ("perceptron_index_bits=N", default 10) */
+
+    /* Tournament (engine BP_HYBRID) */
+    unsigned hybridChooserBits; /* log2 of the number of chooser state machines ("hybrid_chooser_bits=N", default 12) */
+
+    /* Loop predictor, overrides the prediction of any engine for counted loops ("loop") */
+    bool loopPredictor;
+    unsigned loopIndexBits; /* log2 of the number of loop predictor entries ("loop_index_bits=N", default 6) */
+
+    /* Target prediction of the returns and the indirect branches, for any engine */
+    unsigned rasEntries;        /* Entries of the return address stack, 0 disables it ("ras_entries=N", default 16) */
+    unsigned indirectIndexBits; /* log2 of the entries of the indirect target cache, 0 disables it ("indirect_index_bits=N", default 9) */
+
+    /* BTB organization, the BTB is direct mapped with full tags by default */
+    unsigned btbWays;                 /* Ways of every set, a power of 2 that divides btbSize into a power of 2 of sets
+                                       ("btb_ways=N", default 1) */
+    unsigned btbTagBits;              /* Width of the partial tags, 0 for full tags ("btb_tag_bits=N", default 0) */
+    BP_btbReplacement btbReplacement; /* Replacement policy ("lru" or "plru", default "lru") */
+
+    /* Per branch statistics, counted only when the report lists the most mispredicted branches */
+    unsigned statsTopBranches; /* Number of branches listed by the report ("stats" for 10, "stats=N", default 0: not counted) */
+
+    /* Aliasing analysis of the global tables of the two-level and the tournament engines ("aliasing") */
+    bool aliasingAnalysis;
+
+    /* Delayed update: a branch is updated only after updateDelay younger branches were updated ("update_delay=N", default 0)
+     * the BTB histories (global or local), the return address stack and the path history are updated speculatively with the
+     * predictions, and repaired from a checkpoint
+     * when a misprediction is updated; the histories kept by the TAGE, perceptron and tournament tables are updated late
+     * a mispredicted branch redirects the fetch, so it is updated at once (after the older branches in flight)
+     */
+    unsigned updateDelay;
+    bool lateHistory; /* The BTB histories, the return address stack and the path history are updated late too ("late_history") */
+
+    /* The two-level configurations of a direct mapped BTB with full tags and a history of 1, 2, 4, 8 or 16 branches
+     * (without the loop predictor, the aliasing analysis or the delayed update) run on predictors specialized at compile
+     * time, which predict as the generic predictor; "generic" runs them on the generic predictor
+     */
+    bool genericPredictor;
+
+    /* State files (see BP_saveState), empty paths for none
+     * the predictor starts from the state of loadState instead of the cold state ("load_state=path"),
+     * and bp_main saves the state of the predictor to saveState after the trace ("save_state=path")
+     */
+    char loadState[BP_MAX_STATE_PATH];
+    char saveState[BP_MAX_STATE_PATH];
+} BP_config;
+
+/* The statistics of the tournament predictor, counted when the branches are updated */
+typedef struct {
+    uint64_t branches;      /* Number of updated branches */
+    uint64_t correct;       /* Correct predictions of the tournament predictor */
+    uint64_t localCorrect;  /* Correct predictions of the local history component */
+    uint64_t globalCorrect; /* Correct predictions of the global history component */
+    uint64_t chooserLocal;  /* Number of times the chooser selected the local history component */
+    uint64_t chooserGlobal; /* Number of times the chooser selected the global history component */
+} BP_hybridStats;
+
+/* The statistics of the loop predictor, counted when the branches are updated */
+typedef struct {
+    uint64_t branches;              /* Number of updated branches */
+    uint64_t overrides;             /* Number of predictions made by the loop predictor */
+    uint64_t overridesCorrect;      /* Correct predictions of the loop predictor */
+    uint64_t mispredictionsRemoved; /* Overrides that were correct where the other components mispredicted */
+    uint64_t mispredictionsAdded;   /* Overrides that mispredicted where the other components were correct */
+} BP_loopStats;
+
+/* The direction and target mispredictions of every branch type, counted when the branches are updated
+ * a target misprediction is a branch that is predicted taken and taken, with a wrong target
+ */
+typedef struct {
+    uint64_t branches[BP_BRANCH_TYPES];
+    uint64_t directionMispredictions[BP_BRANCH_TYPES];
+    uint64_t targetMispredictions[BP_BRANCH_TYPES];
+} BP_targetStats;
+
+/* The organization, storage and statistics of the BTB, counted when the branches are predicted and set */
+typedef struct {
+    unsigned sets;
+    unsigned ways;
+    unsigned tagBits;           /* Width of the stored tags */
+    bool isPartialTag;          /* The tags are partial, distinct branches may share an entry */
+    uint64_t storageBits;       /* Entries (valid bit, tag, target, type), histories and replacement state */
+    uint64_t lookups;           /* Number of predictions */
+    uint64_t hits;              /* Predictions of branches that were found in the BTB */
+    uint64_t allocations;       /* Branches that were allocated an entry */
+    uint64_t conflictEvictions; /* Allocations that evicted another branch from its set */
+} BP_btbStats;
+
+/* The overall statistics of the predictor
+ * the branches are counted when they are updated, the BTB lookups when they are predicted and set
+ */
+typedef struct {
+    uint64_t branches;
+    uint64_t staticBranches;          /* Number of distinct branches, counted with the per branch statistics only */
+    uint64_t directionMispredictions;
+    uint64_t targetMispredictions;    /* Branches predicted taken and taken, with a wrong target */
+    uint64_t btbLookups;
+    uint64_t btbHits;
+    uint64_t btbAllocations;          /* Branches that were allocated a BTB entry */
+    uint64_t btbReplacements;         /* Allocations that replaced another branch */
+    uint64_t historyRepairs;          /* Speculative histories restored after a misprediction (delayed update mode) */
+} BP_stats;
+
+/* The statistics of a static branch */
+typedef struct {
+    uint32_t pc;
+    uint64_t executions;
+    uint64_t taken;
+    uint64_t directionMispredictions;
+    uint64_t targetMispredictions;
+} BP_branchStats;
+
+/* The aliasing in a table of shared state machines, counted when the branches are updated
+ * every branch also trains a private state machine for every entry it uses, that no other branch touches:
+ * an aliased access (to an entry that other branches used too) is constructive when only the shared state machine
+ * predicts correctly, destructive when only the private state machine does, and neutral otherwise
+ */
+typedef struct {
+    const char *table;            /* "global_tables", or "hybrid_local" and "hybrid_global" for the tournament engine */
+    uint64_t entries;
+    uint64_t usedEntries;         /* Entries used by at least one branch */
+    uint64_t sharedEntries;       /* Entries used by two branches or more */
+    uint64_t maxBranchesPerEntry;
+    uint64_t accesses;
+    uint64_t aliasedAccesses;
+    uint64_t constructive;
+    uint64_t destructive;         /* destructive - constructive is the number of mispredictions due to aliasing */
+    uint64_t neutral;
+} BP_aliasingStats;
+
+/* The aliased accesses of a branch that changed its prediction, attributed to the last other branch that used the entry */
+typedef struct {
+    uint32_t pc;
+    uint32_t otherPc;
+    uint64_t constructive;
+    uint64_t destructive;
+} BP_aliasingPair;
+
+/* A branch of a trace that is held in memory */
+typedef struct {
+    uint32_t pc;
+    uint32_t targetPc;
+    bool taken;
+    BP_branchType type;
+} BP_branch;
+
+/* The result of a run of a configuration over a trace */
+typedef struct {
+    uint64_t branches;
+    uint64_t directionMispredictions;
+    uint64_t targetMispredictions; /* Branches predicted taken and taken, with a wrong target */
+    uint64_t storageBits;          /* Storage of the BTB and the direction prediction tables */
+} BP_runStats;
 
 /*************************************************************************/
 /* The following functions should be implemented in your bp.c (or .cpp) */
@@ -24,6 +234,7 @@ extern "C" {
 /*
  * BP_init - initialize the predictor
  * all input parameters are set (by the main) as declared in the trace file
+ * historySize is 1 to BP_MAX_HISTORY_SIZE
  * return 0 on success, otherwise (init failure) return <0
  */
 int BP_init(unsigned btbSize, unsigned historySize,
@@ -51,6 +262,198 @@ void BP_setBranchAt(uint32_t pc);
  */
 void BP_update(uint32_t pc, uint32_t targetPc, bool taken);
 
+/*
+ * BP_updateTyped - BP_update of a branch of a known type (BP_update is BP_updateTyped of a conditional branch)
+ * the type is kept in the BTB entry of the branch: the branches that are not conditional are predicted taken,
+ * the returns take their target from the return address stack and the indirect branches from the target cache
+ */
+void BP_updateTyped(uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type);
+
+/*
+ * BP_parseBranchType - the branch type of the type field of a trace line ("cond", "uncond", "call", "ret", "indirect")
+ * return 0 on success, otherwise (unknown type) return <0
+ */
+int BP_parseBranchType(const char *name, BP_branchType *type);
+
+/*************************************************************************/
+/* Extended configuration                                                */
+/*************************************************************************/
+
+/*
+ * BP_defaultConfig - sets the five standard fields of the config line, and the default values of all the other fields
+ * param[out] config - the configuration
+ */
+void BP_defaultConfig(BP_config *config, unsigned btbSize, unsigned historySize,
+bool isGlobalHist, bool isGlobalTable, bool isShare);
+
+/*
+ * BP_parseOption - applies an optional field of the config line to the configuration
+ * an option is either an engine name ("two_level", "tage", "perceptron", "hybrid"), "loop", a BTB replacement policy
+ * ("lru", "plru"), "stats", "aliasing", "late_history", "generic" or "name=value" (with a path as the value of "load_state"
+ * and "save_state")
+ * return 0 on success, otherwise (unknown option or bad value) return <0
+ */
+int BP_parseOption(BP_config *config, const char *option);
+
+/*
+ * BP_initConfig - initialize the predictor with the full configuration
+ * BP_init is BP_initConfig of the default configuration of its parameters
+ * with a loadState, the predictor starts from the state file (see BP_loadState)
+ * return 0 on success, otherwise (init failure, or a state file that cannot be loaded) return <0
+ */
+int BP_initConfig(const BP_config *config);
+
+/*
+ * BP_saveState - saves the state of the predictor (the BTB entries, the histories and the tables) to a state file
+ * the statistics and the branches in flight of the delayed update mode are not saved
+ * return 0 on success, otherwise (the file cannot be written) return <0
+ */
+int BP_saveState(const char *path);
+
+/*
+ * BP_loadState - loads a state file saved by a predictor of the same configuration (the statistics, the aliasing
+ * analysis, the delayed update and "generic" aside), the predictor goes on from the saved state
+ * return 0 on success, otherwise (the file cannot be read, it is broken or of another configuration) the predictor
+ * is reset to the cold state and return <0
+ */
+int BP_loadState(const char *path);
+
+/*
+ * BP_run - runs a private predictor of the configuration over a trace held in memory
+ * every branch is predicted, set (BP_setBranchAt) and updated, as by bp_main
+ * the predictor of BP_init is not touched, so runs of different configurations may proceed in parallel threads
+ * return 0 on success, otherwise (init failure) return <0
+ */
+int BP_run(const BP_config *config, const BP_branch *trace, size_t branches, BP_runStats *stats);
+
+/*
+ * BP_runWarm - BP_run of a predictor that is first warmed up on the warm-up branches
+ * the warm-up branches are predicted, set and updated as the branches of the trace, but they are not counted in stats
+ * BP_run is BP_runWarm without warm-up branches
+ * return 0 on success, otherwise (init failure) return <0
+ */
+int BP_runWarm(const BP_config *config, const BP_branch *warmup, size_t warmupBranches,
+    const BP_branch *trace, size_t branches, BP_runStats *stats);
+
+/*
+ * BP_runSliced - BP_run of up to 64 configurations at once, with a bit-sliced table per configuration
+ * the configurations must be global history global tables configurations of the two-level engine, with historySize
+ * up to 16, that differ only in historySize (and isShare, which BP_init ignores for them too: their tables are always
+ * indexed by the history XOR the pc), so their BTBs follow the same branches, and without a loadState (the lanes
+ * start cold)
+ * param[out] stats - the result of every configuration
+ * return 0 on success, otherwise (configurations that cannot be sliced together, or init failure) return <0
+ */
+int BP_runSliced(const BP_config *configs, unsigned count, const BP_branch *trace, size_t branches, BP_runStats *stats);
+
+/*************************************************************************/
+/* Statistics                                                            */
+/*************************************************************************/
+
+/*
+ * BP_getHybridStats - the statistics of the tournament predictor
+ * return 0 on success, <0 when the predictor is not a tournament predictor
+ */
+int BP_getHybridStats(BP_hybridStats *stats);
+
+/*
+ * BP_getLoopStats - the statistics of the loop predictor
+ * return 0 on success, <0 when the loop predictor is not enabled
+ */
+int BP_getLoopStats(BP_loopStats *stats);
+
+/*
+ * BP_getTargetStats - the direction and target mispredictions of every branch type
+ */
+void BP_getTargetStats(BP_targetStats *stats);
+
+/*
+ * BP_getBtbStats - the organization, storage and statistics of the BTB
+ */
+void BP_getBtbStats(BP_btbStats *stats);
+
+/*
+ * BP_getStats - the overall statistics of the predictor
+ */
+void BP_getStats(BP_stats *stats);
+
+/*
+ * BP_getTopBranches - the branches with the most mispredictions (direction and target), the most mispredicted first
+ * param[out] branches - room for count branches
+ * return the number of branches set, 0 when the per branch statistics are not counted (statsTopBranches is 0)
+ */
+unsigned BP_getTopBranches(BP_branchStats *branches, unsigned count);
+
+/*
+ * BP_getAliasingStats - the aliasing in a table of shared state machines
+ * param[in] table - 0 for the global tables of the two-level engine, 0 or 1 for the tournament engine
+ * return 0 on success, <0 when the aliasing analysis is not enabled or there is no such table
+ */
+int BP_getAliasingStats(unsigned table, BP_aliasingStats *stats);
+
+/*
+ * BP_getAliasingPairs - the pairs of branches with the most mispredictions due to aliasing in a table, the worst first
+ * param[out] pairs - room for count pairs
+ * return the number of pairs set
+ */
+unsigned BP_getAliasingPairs(unsigned table, BP_aliasingPair *pairs, unsigned count);
+
+/*
+ * BP_printReport - prints the statistics of the predictor components (nothing for the two-level predictor)
+ * with statsTopBranches, the report adds the overall statistics and the most mispredicted branches
+ * with aliasingAnalysis, the report adds the aliasing of every analyzed table and its worst pairs of branches
+ * param[in] out - the output stream, the drivers use stderr so that the predictions on stdout are unchanged
+ */
+void BP_printReport(FILE *out);
+
+/*************************************************************************/
+/* Predictor instances                                                   */
+/*************************************************************************/
+
+/* A predictor instance, the functions above use a default instance of their own
+ * the instances share no state, so different instances may be used by parallel threads
+ * (an instance itself is used by one thread at a time)
+ */
+typedef struct BP_predictor BP_predictor;
+
+/*
+ * BP_create - creates a predictor instance with the full configuration
+ * return the instance on success, otherwise (init failure) return NULL
+ */
+BP_predictor *BP_create(const BP_config *config);
+
+/*
+ * BP_destroy - releases a predictor instance created by BP_create (NULL is ignored)
+ */
+void BP_destroy(BP_predictor *predictor);
+
+/*
+ * The functions of an instance, every BP_predictorXxx(predictor, ...) is BP_xxx(...) of the instance
+ */
+int BP_predictorInit(BP_predictor *predictor, const BP_config *config);
+int BP_predictorSaveState(BP_predictor *predictor, const char *path);
+int BP_predictorLoadState(BP_predictor *predictor, const char *path);
+bool BP_predictorPredict(BP_predictor *predictor, uint32_t pc, uint32_t *dst);
+void BP_predictorSetBranchAt(BP_predictor *predictor, uint32_t pc);
+void BP_predictorUpdate(BP_predictor *predictor, uint32_t pc, uint32_t targetPc, bool taken);
+void BP_predictorUpdateTyped(BP_predictor *predictor, uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type);
+
+int BP_predictorGetHybridStats(BP_predictor *predictor, BP_hybridStats *stats);
+int BP_predictorGetLoopStats(BP_predictor *predictor, BP_loopStats *stats);
+void BP_predictorGetTargetStats(BP_predictor *predictor, BP_targetStats *stats);
+void BP_predictorGetBtbStats(BP_predictor *predictor, BP_btbStats *stats);
+void BP_predictorGetStats(BP_predictor *predictor, BP_stats *stats);
+unsigned BP_predictorGetTopBranches(BP_predictor *predictor, BP_branchStats *branches, unsigned count);
+int BP_predictorGetAliasingStats(BP_predictor *predictor, unsigned table, BP_aliasingStats *stats);
+unsigned BP_predictorGetAliasingPairs(BP_predictor *predictor, unsigned table, BP_aliasingPair *pairs, unsigned count);
+void BP_predictorPrintReport(BP_predictor *predictor, FILE *out);
+
+/*
+ * BP_predictorRun - predicts, sets and updates every branch of a trace held in memory on the instance, as BP_run
+ * the statistics of the instance keep counting, so a trace that does not fit in memory may be run in parts
+ */
+void BP_predictorRun(BP_predictor *predictor, const BP_branch *trace, size_t branches);
+
 #ifdef __cplusplus
 }
 #endif
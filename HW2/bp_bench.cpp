@@ -0,0 +1,118 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Benchmark of the predictor throughput on traces with a high BTB miss rate */
+/* Usage: ./bp_bench [branches] [distinct branches] [btb size] [history size] */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+
+#include "bp_api.h"
+
+using namespace std;
+
+struct Branch {
+	uint32_t pc;
+	uint32_t target;
+	bool taken;
+};
+
+struct Config {
+	const char* name;
+	bool isGlobalHist;
+	bool isGlobalTable;
+	bool isShare;
+	const char* engine;
+};
+
+static const Config configs[] = {
+	{ "local_history local_tables not_using_share", false, false, false, "two_level" },
+	{ "local_history global_tables not_using_share", false, true, false, "two_level" },
+	{ "local_history global_tables using_share", false, true, true, "two_level" },
+	{ "global_history local_tables not_using_share", true, false, false, "two_level" },
+	{ "global_history global_tables not_using_share", true, true, false, "two_level" },
+	{ "global_history global_tables using_share", true, true, true, "two_level" },
+	{ "tage", true, true, false, "tage" },
+	{ "perceptron", true, true, false, "perceptron" },
+};
+
+static uint32_t random_state = 2463534242u;
+
+static uint32_t Random() {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+//the trace jumps uniformly between the distinct branches, so most of the lookups miss in a small BTB
+//every branch is biased towards taken or towards not taken
+static vector<Branch> GenerateTrace(unsigned branches, unsigned distinct) {
+	vector<uint32_t> pcs(distinct), targets(distinct), biases(distinct);
+	for (unsigned i = 0; i < distinct; i++) {
+		pcs[i] = 0x10000 + 4 * (Random() % (16 * distinct));
+		targets[i] = 0x80000 + 4 * (Random() % 0x10000);
+		biases[i] = (Random() % 2) ? 90 : 10;
+	}
+
+	vector<Branch> trace(branches);
+	for (unsigned i = 0; i < branches; i++) {
+		const unsigned b = Random() % distinct;
+		trace[i].pc = pcs[b];
+		trace[i].target = targets[b];
+		trace[i].taken = (Random() % 100) < biases[b];
+	}
+	return trace;
+}
+
+//the fraction of the predictions that miss in a direct mapped BTB of btbSize entries (as BP_predict sees it)
+static double BtbMissRate(const vector<Branch>& trace, unsigned btbSize) {
+	vector<uint32_t> btb(btbSize, 0);
+	unsigned misses = 0;
+	for (size_t i = 0; i < trace.size(); i++) {
+		uint32_t& entry = btb[(trace[i].pc >> 2) & (btbSize - 1)];
+		if (entry != trace[i].pc) misses++;
+		entry = trace[i].pc;
+	}
+	return (double)misses / trace.size();
+}
+
+int main(int argc, char** argv) {
+	const unsigned branches = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000000;
+	const unsigned distinct = (argc > 2) ? strtoul(argv[2], NULL, 0) : 4096;
+	const unsigned btbSize = (argc > 3) ? strtoul(argv[3], NULL, 0) : 16;
+	const unsigned historySize = (argc > 4) ? strtoul(argv[4], NULL, 0) : 8;
+
+	if (0 == branches || 0 == distinct || btbSize < 2 || (btbSize & (btbSize - 1)) || 0 == historySize) {
+		fprintf(stderr, "Usage: %s [branches] [distinct branches] [btb size (power of 2)] [history size]\n", argv[0]);
+		return 1;
+	}
+
+	const vector<Branch> trace = GenerateTrace(branches, distinct);
+	printf("%u branches, %u distinct branches, btb %u, history %u, BTB miss rate %.1f%%\n",
+		branches, distinct, btbSize, historySize, 100.0 * BtbMissRate(trace, btbSize));
+
+	for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+		BP_config config;
+		BP_defaultConfig(&config, btbSize, historySize, configs[c].isGlobalHist, configs[c].isGlobalTable, configs[c].isShare);
+		if (BP_parseOption(&config, configs[c].engine) < 0 || BP_initConfig(&config) < 0) {
+			fprintf(stderr, "Predictor init failed\n");
+			return 2;
+		}
+
+		unsigned taken_predictions = 0;
+		const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (size_t i = 0; i < trace.size(); i++) {
+			uint32_t dst;
+			taken_predictions += BP_predict(trace[i].pc, &dst);
+			BP_setBranchAt(trace[i].pc);
+			BP_update(trace[i].pc, trace[i].target, trace[i].taken);
+		}
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		printf("%-46s %8.2f M predictions/sec (%.1f%% predicted taken)\n",
+			configs[c].name, trace.size() / seconds / 1e6, 100.0 * taken_predictions / trace.size());
+	}
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Bit-sliced global history tables, simulating up to 64 table configurations per machine word */
+
+#include "bp_bitslice.h"
+
+BitSlicedTables::BitSlicedTables(const std::vector<unsigned>& historySizes, const std::vector<bool>& isShare) {
+	unsigned max_size = 1;
+	for (size_t lane = 0; lane < historySizes.size(); lane++) {
+		const uint32_t mask = (0x1 << historySizes[lane]) - 1;
+		if (historySizes[lane] > max_size) max_size = historySizes[lane];
+
+		size_t group = 0;
+		while (group < m_groups.size() && (m_groups[group].mask != mask || m_groups[group].is_share != isShare[lane]))
+			group++;
+
+		if (group == m_groups.size()) {
+			Group new_group = { mask, isShare[lane], 0 };
+			m_groups.push_back(new_group);
+		}
+		m_groups[group].lanes |= uint64_t(1) << lane;
+	}
+
+	//all the state machines start at 'WNT' (Weakly Not Taken): high bit 0, low bit 1
+	m_high.assign((size_t)1 << max_size, 0);
+	m_low.assign((size_t)1 << max_size, ~uint64_t(0));
+}
+
+uint64_t BitSlicedTables::Prediction(uint32_t history, uint32_t pc_bits) const {
+	uint64_t taken = 0;
+	for (size_t group = 0; group < m_groups.size(); group++)
+		taken |= m_high[Index(m_groups[group], history, pc_bits)] & m_groups[group].lanes;
+	return taken;
+}
+
+void BitSlicedTables::Update(uint32_t history, uint32_t pc_bits, bool taken) {
+	for (size_t group = 0; group < m_groups.size(); group++) {
+		const size_t index = Index(m_groups[group], history, pc_bits);
+		const uint64_t lanes = m_groups[group].lanes;
+		const uint64_t high = m_high[index];
+		const uint64_t low = m_low[index];
+
+		//saturating increment: 00->01->10->11, saturating decrement: 11->10->01->00
+		const uint64_t next_high = taken ? (high | low) : (high & low);
+		const uint64_t next_low = taken ? (high | ~low) : (high & ~low);
+
+		m_high[index] = (high & ~lanes) | (next_high & lanes);
+		m_low[index] = (low & ~lanes) | (next_low & lanes);
+	}
+}
+
+
+LaneCounters::LaneCounters() : m_pending(0) {
+	for (unsigned plane = 0; plane < BITSLICE_COUNTER_PLANES; plane++) m_planes[plane] = 0;
+	for (unsigned lane = 0; lane < BITSLICE_LANES; lane++) m_totals[lane] = 0;
+}
+
+uint64_t LaneCounters::Total(unsigned lane) {
+	Flush();
+	return m_totals[lane];
+}
+
+void LaneCounters::Flush() {
+	for (unsigned plane = 0; plane < BITSLICE_COUNTER_PLANES; plane++) {
+		for (uint64_t lanes = m_planes[plane]; 0 != lanes; lanes &= lanes - 1)
+			m_totals[__builtin_ctzll(lanes)] += uint64_t(1) << plane;
+		m_planes[plane] = 0;
+	}
+
+	m_pending = 0;
+}
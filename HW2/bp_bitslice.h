@@ -0,0 +1,79 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Bit-sliced global history tables, simulating up to 64 table configurations per machine word */
+
+#ifndef BP_BITSLICE_H_
+#define BP_BITSLICE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define BITSLICE_LANES 64
+//the lane counters are kept bit-sliced in this many planes, and added to the totals before they can overflow
+#define BITSLICE_COUNTER_PLANES 8
+
+//the 2-bit state machines of up to 64 global history tables (a lane per table), with or without share,
+//of any history length up to MAX_TABLE_INDEX_BITS
+//the state machine i of lane l is bit l of m_high[i] (the prediction) and bit l of m_low[i]
+//the lanes are grouped by (history length, share): all the lanes of a group read and write the same word,
+//so a branch costs one pass of bitwise operations over the groups, whatever the number of lanes is
+class BitSlicedTables
+{
+public:
+	//lane l has the history length historySizes[l] and the share isShare[l]
+	BitSlicedTables(const std::vector<unsigned>& historySizes, const std::vector<bool>& isShare);
+	~BitSlicedTables() {}
+
+	//the lanes that predict taken
+	//history holds the newest outcomes (the newest at bit 0), pc_bits are the pc bits that the share lanes XOR in
+	uint64_t Prediction(uint32_t history, uint32_t pc_bits) const;
+
+	void Update(uint32_t history, uint32_t pc_bits, bool taken);
+
+private:
+	struct Group {
+		uint32_t mask;
+		bool is_share;
+		uint64_t lanes;
+	};
+
+	size_t Index(const Group& group, uint32_t history, uint32_t pc_bits) const {
+		return (history ^ (group.is_share ? pc_bits : 0)) & group.mask;
+	}
+
+	std::vector<Group> m_groups;
+	std::vector<uint64_t> m_high;
+	std::vector<uint64_t> m_low;
+};
+
+//64 event counters (a counter per lane) that are incremented together by a word of lanes
+//the low bits are counted in bit-sliced planes (a ripple carry add per word), the planes are added to the totals
+//once every 2^BITSLICE_COUNTER_PLANES - 1 words
+class LaneCounters
+{
+public:
+	LaneCounters();
+	~LaneCounters() {}
+
+	void Add(uint64_t lanes) {
+		uint64_t carry = lanes;
+		for (unsigned plane = 0; plane < BITSLICE_COUNTER_PLANES && 0 != carry; plane++) {
+			const uint64_t next_carry = m_planes[plane] & carry;
+			m_planes[plane] ^= carry;
+			carry = next_carry;
+		}
+
+		if (++m_pending == (0x1u << BITSLICE_COUNTER_PLANES) - 1) Flush();
+	}
+
+	uint64_t Total(unsigned lane);
+
+private:
+	void Flush();
+
+	uint64_t m_planes[BITSLICE_COUNTER_PLANES];
+	unsigned m_pending;
+	uint64_t m_totals[BITSLICE_LANES];
+};
+
+#endif /* BP_BITSLICE_H_ */
@@ -0,0 +1,93 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Converts a text trace to a binary trace (see bp_trace.h), and back with -d */
+/* Usage: ./bp_convert <text trace> <binary trace> | -d <binary trace> <text trace> */
+
+#include <cstdio>
+#include <cstring>
+
+#include "bp_trace.h"
+
+using namespace std;
+
+static const char* branch_type_names[BP_BRANCH_TYPES] = { "cond", "uncond", "call", "ret", "indirect" };
+
+static int Encode(const char* text_path, const char* binary_path) {
+	TextTraceReader reader;
+	if (!reader.Open(text_path)) {
+		fprintf(stderr, "cannot open trace file\n");
+		return 2;
+	}
+	if (reader.IsBroken()) {
+		fprintf(stderr, "Error in input file: cannot read config\n");
+		return 3;
+	}
+
+	TraceWriter writer;
+	if (!writer.Open(binary_path, reader.Config())) {
+		fprintf(stderr, "cannot create binary trace file\n");
+		return 2;
+	}
+
+	unsigned long long branches = 0;
+	BP_branch branch;
+	while (reader.Next(&branch)) {
+		if (!writer.Write(branch)) break;
+		branches++;
+	}
+
+	if (reader.IsBroken()) {
+		fprintf(stderr, "Error in input file: bad trace\n");
+		return 9;
+	}
+	if (!writer.Close()) {
+		fprintf(stderr, "cannot write binary trace file\n");
+		return 2;
+	}
+
+	fprintf(stderr, "%llu branches\n", branches);
+	return 0;
+}
+
+static int Decode(const char* binary_path, const char* text_path) {
+	TraceReader reader;
+	if (!reader.Open(binary_path)) {
+		fprintf(stderr, "cannot open binary trace file\n");
+		return 2;
+	}
+
+	FILE* text = fopen(text_path, "w");
+	if (NULL == text) {
+		fprintf(stderr, "cannot create trace file\n");
+		return 2;
+	}
+
+	fprintf(text, "%s\n", reader.Config().c_str());
+	BP_branch branch;
+	while (reader.Next(&branch)) {
+		fprintf(text, "0x%x %c 0x%x", branch.pc, branch.taken ? 'T' : 'N', branch.targetPc);
+		if (BP_BRANCH_COND != branch.type)
+			fprintf(text, " %s", branch_type_names[branch.type]);
+		fputc('\n', text);
+	}
+
+	const bool is_written = (0 == fclose(text));
+	if (reader.IsBroken()) {
+		fprintf(stderr, "Error in input file: bad trace\n");
+		return 9;
+	}
+	if (!is_written) {
+		fprintf(stderr, "cannot write trace file\n");
+		return 2;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (3 == argc)
+		return Encode(argv[1], argv[2]);
+	if (4 == argc && 0 == strcmp(argv[1], "-d"))
+		return Decode(argv[2], argv[3]);
+
+	fprintf(stderr, "Usage: %s <text trace> <binary trace> | -d <binary trace> <text trace>\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,72 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Accuracy of the predictor of a trace against the depth of the pipeline, between a prediction and its update */
+/* Usage: ./bp_depth <trace file (text or binary)> [max delay] */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bp_trace.h"
+
+using namespace std;
+
+#define DEFAULT_MAX_DELAY 64
+
+//the accuracy of a run, "invalid" when the configuration cannot be initialized
+static void PrintRun(int result, const BP_runStats& stats) {
+	if (result < 0) {
+		printf(" %9s %12s", "invalid", "");
+		return;
+	}
+
+	const double branches = (0 == stats.branches) ? 1.0 : (double)stats.branches;
+	const unsigned long long mispredictions = stats.directionMispredictions + stats.targetMispredictions;
+	printf(" %8.2f%% %12llu", 100.0 * (1.0 - mispredictions / branches), mispredictions);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: %s <trace file (text or binary)> [max delay]\n", argv[0]);
+		return 1;
+	}
+
+	const unsigned max_delay = (3 == argc) ? strtoul(argv[2], NULL, 0) : DEFAULT_MAX_DELAY;
+	if (BP_MAX_UPDATE_DELAY < max_delay) {
+		fprintf(stderr, "Error: the max delay is %u\n", BP_MAX_UPDATE_DELAY);
+		return 1;
+	}
+
+	string config_line;
+	vector<BP_branch> trace;
+	if (!ReadTrace(argv[1], &config_line, &trace)) {
+		fprintf(stderr, "Error in input file: bad trace\n");
+		return 9;
+	}
+
+	BP_config config;
+	if (!ParseConfigLine(config_line, &config)) {
+		fprintf(stderr, "Error in input file: cannot read config\n");
+		return 3;
+	}
+
+	//the delays 0, 1, 2, 4, ... up to the max delay, every delay with the speculative history of the BTB
+	//(repaired at a misprediction) and with the history that is updated with the tables (late)
+	printf("%6s %9s %12s %9s %12s\n", "delay", "spec_acc", "spec_misses", "late_acc", "late_misses");
+	for (unsigned delay = 0; delay <= max_delay; delay = (0 == delay) ? 1 : 2 * delay) {
+		BP_runStats speculative, late;
+		config.updateDelay = delay;
+		config.lateHistory = false;
+		const int speculative_result = BP_run(&config, trace.data(), trace.size(), &speculative);
+		config.lateHistory = true;
+		const int late_result = BP_run(&config, trace.data(), trace.size(), &late);
+
+		printf("%6u", delay);
+		PrintRun(speculative_result, speculative);
+		PrintRun(late_result, late);
+		printf("\n");
+	}
+
+	fprintf(stderr, "%zu branches\n", trace.size());
+	return 0;
+}
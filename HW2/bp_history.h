@@ -0,0 +1,135 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Branch history registers of any length and folded histories for table indexing */
+
+#ifndef BP_HISTORY_H_
+#define BP_HISTORY_H_
+
+#include "bp_state.h"
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#define HISTORY_WORD_BITS 64
+
+//the outcomes of the last 'length' branches, the newest outcome has age 0
+//the 64 newest outcomes are kept in a single word, longer histories are kept in a circular buffer
+//so pushing an outcome costs O(1) whatever the length is
+class HistoryBuffer
+{
+public:
+	HistoryBuffer(unsigned length) : m_recent(0), m_head(0), m_capacity_mask(0) {
+		//the outcome that leaves the history (age 'length') must still be readable
+		if (length >= HISTORY_WORD_BITS) {
+			unsigned capacity = HISTORY_WORD_BITS;
+			while (capacity <= length) capacity *= 2;
+			m_capacity_mask = capacity - 1;
+			m_words.resize(capacity / HISTORY_WORD_BITS, 0);
+		}
+	}
+
+	void Push(bool taken) {
+		m_recent = (m_recent << 1) | uint64_t(taken);
+		if (m_words.empty()) return;
+
+		m_head = (m_head + 1) & m_capacity_mask;
+		uint64_t& word = m_words[m_head / HISTORY_WORD_BITS];
+		const uint64_t bit = uint64_t(1) << (m_head % HISTORY_WORD_BITS);
+		word = taken ? (word | bit) : (word & ~bit);
+	}
+
+	bool At(unsigned age) const {
+		if (age < HISTORY_WORD_BITS) return (m_recent >> age) & 0x1;
+
+		const unsigned position = (m_head - age) & m_capacity_mask;
+		return (m_words[position / HISTORY_WORD_BITS] >> (position % HISTORY_WORD_BITS)) & 0x1;
+	}
+
+	//the 64 newest outcomes, the newest outcome at bit 0
+	uint64_t Recent() const { return m_recent; }
+
+	void Clear() {
+		m_recent = 0;
+		m_head = 0;
+		std::fill(m_words.begin(), m_words.end(), 0);
+	}
+
+	void Transfer(StateArchive& archive) {
+		archive.Value(m_recent);
+		archive.Expect(m_words.size());
+		for (size_t i = 0; i < m_words.size(); i++)
+			archive.Value(m_words[i]);
+		archive.Value(m_head);
+		archive.Check(m_head <= m_capacity_mask);
+	}
+
+private:
+	uint64_t m_recent;
+	std::vector<uint64_t> m_words;
+	unsigned m_head;
+	unsigned m_capacity_mask;
+};
+
+//a history of 'length' outcomes folded (XORed in chunks) down to 'width' bits
+//it is maintained incrementally: the newest outcome is shifted in and the outcome that leaves the history is XORed out
+//when length <= width the folded history is exactly the history
+class FoldedHistory
+{
+public:
+	FoldedHistory(unsigned length, unsigned width) : m_length(length), m_width(width), m_value(0) {}
+
+	//call after pushing the newest outcome into the buffer
+	void Update(const HistoryBuffer& buffer) {
+		m_value = (m_value << 1) | uint32_t(buffer.At(0));
+		m_value ^= uint32_t(buffer.At(m_length)) << (m_length % m_width);
+		m_value ^= m_value >> m_width;
+		m_value &= (uint32_t(1) << m_width) - 1;
+	}
+
+	uint32_t Value() const { return m_value; }
+
+	void Clear() { m_value = 0; }
+
+	void Transfer(StateArchive& archive) {
+		archive.Value(m_value);
+		archive.Check(0 == ((uint64_t)m_value >> m_width));
+	}
+
+private:
+	unsigned m_length;
+	unsigned m_width;
+	uint32_t m_value;
+};
+
+//a history register together with its folded history
+class HistoryRegister
+{
+public:
+	HistoryRegister(unsigned length, unsigned width) : m_buffer(length), m_folded(length, width) {}
+	//a placeholder register, to be assigned a copy of a real one
+	HistoryRegister() : m_buffer(1), m_folded(1, 1) {}
+
+	void Push(bool taken) {
+		m_buffer.Push(taken);
+		m_folded.Update(m_buffer);
+	}
+
+	uint32_t Folded() const { return m_folded.Value(); }
+
+	const HistoryBuffer& Buffer() const { return m_buffer; }
+
+	void Clear() {
+		m_buffer.Clear();
+		m_folded.Clear();
+	}
+
+	void Transfer(StateArchive& archive) {
+		m_buffer.Transfer(archive);
+		m_folded.Transfer(archive);
+	}
+
+private:
+	HistoryBuffer m_buffer;
+	FoldedHistory m_folded;
+};
+
+#endif /* BP_HISTORY_H_ */
@@ -0,0 +1,37 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Two-level predictors specialized at compile time for the common configurations */
+
+#include "bp_kernel.h"
+
+//the organizations of a history length, all with 2-bit state machines
+//as the generic predictor builds its BTB, the global tables are always indexed by the history XOR the pc
+template <unsigned HistSize>
+static PredictorKernel* CreateOfHistory(const BP_config& config, TargetPredictor* targets) {
+	if (config.isGlobalHist) {
+		if (config.isGlobalTable)
+			return new TwoLevelKernel<HistSize, 2, true, true, true>(config, targets);
+		return new TwoLevelKernel<HistSize, 2, true, false, false>(config, targets);
+	}
+
+	if (config.isGlobalTable)
+		return new TwoLevelKernel<HistSize, 2, false, true, true>(config, targets);
+	return new TwoLevelKernel<HistSize, 2, false, false, false>(config, targets);
+}
+
+PredictorKernel* CreateKernel(const BP_config& config, TargetPredictor* targets) {
+	//a two-level predictor without the extensions of the generic predictor, and a direct mapped BTB of full tags
+	if (config.genericPredictor || BP_TWO_LEVEL != config.engine || config.loopPredictor || config.aliasingAnalysis ||
+		0 != config.updateDelay || 1 != config.btbWays || 0 != config.btbTagBits ||
+		0 == config.btbSize || 0 != (config.btbSize & (config.btbSize - 1)) || (!config.isGlobalTable && config.isShare))
+		return NULL;
+
+	//the history lengths of the configuration sweep
+	switch (config.historySize) {
+	case 1:		return CreateOfHistory<1>(config, targets);
+	case 2:		return CreateOfHistory<2>(config, targets);
+	case 4:		return CreateOfHistory<4>(config, targets);
+	case 8:		return CreateOfHistory<8>(config, targets);
+	case 16:	return CreateOfHistory<16>(config, targets);
+	default:	return NULL;
+	}
+}
@@ -0,0 +1,279 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Two-level predictors specialized at compile time for the common configurations */
+
+#ifndef BP_KERNEL_H_
+#define BP_KERNEL_H_
+
+#include "bp_api.h"
+#include "bp_tables.h"
+#include "bp_target.h"
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+//the BTB and the direction prediction tables of a configuration that a kernel covers
+//the target predictor (the return address stack and the target cache) is owned by the BranchPredictor
+class PredictorKernel
+{
+public:
+	virtual ~PredictorKernel() {}
+
+	virtual bool Predict(uint32_t pc, uint32_t* dst) = 0;
+
+	virtual void InitAt(uint32_t pc) = 0;
+
+	virtual void Update(uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type) = 0;
+
+	//predicts, sets and updates every branch of the trace (as BP_run), and counts the predictions into stats
+	virtual void Run(const BP_branch* trace, size_t branches, BP_targetStats* stats) = 0;
+
+	virtual BP_btbStats BtbStats() const = 0;
+
+	virtual uint64_t StorageBits() const = 0;
+
+	//saves or loads the state of the generic predictor of the configuration (see StateArchive), so a state saved by
+	//either predictor loads into the other
+	virtual void Transfer(StateArchive& archive) = 0;
+};
+
+//a two-level predictor with a direct mapped BTB of full tags, specialized for its history length, the width of its
+//state machines, its history kind, its table kind and its share
+//the histories are words and the state machines are packed into bytes (as PackedCounters, of any width that divides a byte),
+//so every mask and shift is a constant and the update is branch free
+//it predicts exactly as the generic predictor of the same configuration (LocalBTB, GlobalBTB, LShareBTB or GShareBTB
+//with LocalTable or GlobalTable)
+template <unsigned HistSize, unsigned CounterBits, bool IsGlobalHist, bool IsGlobalTable, bool IsShare>
+class TwoLevelKernel : public PredictorKernel
+{
+	static_assert(0 < HistSize && MAX_TABLE_INDEX_BITS >= HistSize, "the history indexes the tables unfolded");
+	static_assert(0 < CounterBits && 0 == 8 % CounterBits, "the state machines are packed into bytes");
+	static_assert(IsGlobalTable || !IsShare, "the local tables are not shared");
+
+	enum {
+		HISTORY_MASK = (1 << HistSize) - 1,
+		COUNTER_MAX = (1 << CounterBits) - 1,
+		//'WNT' (Weakly Not Taken), the highest state that predicts not taken
+		COUNTER_WNT = (1 << (CounterBits - 1)) - 1,
+		//the state machines of a byte
+		PACKED_COUNTERS = 8 / CounterBits,
+		//a local table is a row of 2^HistSize state machines per BTB entry, each row starts at a byte boundary
+		ROW_BYTES = ((1 << HistSize) + PACKED_COUNTERS - 1) / PACKED_COUNTERS,
+		ROW_COUNTERS = ROW_BYTES * PACKED_COUNTERS
+	};
+
+public:
+	//the BTB size is a power of 2
+	TwoLevelKernel(const BP_config& config, TargetPredictor* targets) : m_targets(targets), m_set_mask(config.btbSize - 1),
+		m_histories(IsGlobalHist ? 1 : config.btbSize, 0),
+		m_tables((size_t)(IsGlobalTable ? 1 : config.btbSize) * ROW_BYTES, WntByte()), m_btb_size(config.btbSize) {
+		const Line empty = { 0, 0, BP_BRANCH_COND, false };
+		m_lines.assign(config.btbSize, empty);
+
+		m_set_bits = 0;
+		while ((m_set_mask >> m_set_bits) & 0x1)
+			m_set_bits++;
+
+		m_stats.lookups = m_stats.hits = 0;
+		m_stats.allocations = m_stats.conflictEvictions = 0;
+	}
+	virtual ~TwoLevelKernel() {}
+
+	virtual bool Predict(uint32_t pc, uint32_t* dst) { return PredictBranch(pc, dst); }
+
+	virtual void InitAt(uint32_t pc) { InitBranch(pc); }
+
+	virtual void Update(uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type) {
+		UpdateBranch(pc, targetPc, taken, type);
+	}
+
+	virtual void Run(const BP_branch* trace, size_t branches, BP_targetStats* stats) {
+		for (size_t i = 0; i < branches; i++) {
+			const BP_branch& branch = trace[i];
+			uint32_t dst;
+			const bool prediction = PredictBranch(branch.pc, &dst);
+			InitBranch(branch.pc);
+			UpdateBranch(branch.pc, branch.targetPc, branch.taken, branch.type);
+
+			const bool is_direction_mispredicted = (prediction != branch.taken);
+			stats->branches[branch.type]++;
+			stats->directionMispredictions[branch.type] += is_direction_mispredicted;
+			stats->targetMispredictions[branch.type] += !is_direction_mispredicted && branch.taken && dst != branch.targetPc;
+		}
+	}
+
+	virtual BP_btbStats BtbStats() const {
+		BP_btbStats stats = m_stats;
+		stats.ways = 1;
+		stats.sets = m_set_mask + 1;
+		stats.tagBits = TagBits();
+		stats.isPartialTag = false;
+		stats.storageBits = BtbStorageBits();
+		return stats;
+	}
+
+	//the storage of the generic predictor, with state machines of CounterBits bits
+	virtual uint64_t StorageBits() const {
+		return BtbStorageBits() + (uint64_t)m_histories.size() * HistSize +
+			((uint64_t)(IsGlobalTable ? 1 : m_btb_size) << HistSize) * CounterBits;
+	}
+
+	//the BTB lines and the PLRU trees (unused by a direct mapped BTB) of BranchTargetBuffer, the history registers of
+	//LocalBTB or GlobalBTB and the packed state machines of LocalTable or GlobalTable
+	virtual void Transfer(StateArchive& archive) {
+		archive.Expect(m_lines.size());
+		for (size_t entry = 0; entry < m_lines.size(); entry++) {
+			Line& line = m_lines[entry];
+			uint8_t lru = 0;
+			archive.Value(line.valid);
+			archive.Value(line.tag);
+			archive.Value(line.target);
+			archive.Value(line.type);
+			archive.Value(lru);
+			archive.Check(BP_BRANCH_TYPES > line.type && 0 == lru);
+		}
+
+		archive.Expect(m_lines.size());
+		for (size_t set = 0; set < m_lines.size(); set++) {
+			uint64_t plru = 0;
+			archive.Value(plru);
+			archive.Check(0 == plru);
+		}
+
+		if (!IsGlobalHist)
+			archive.Expect(m_histories.size());
+		for (size_t i = 0; i < m_histories.size(); i++)
+			TransferHistory(archive, m_histories[i]);
+
+		archive.Bytes(m_tables.data(), m_tables.size());
+	}
+
+private:
+	struct Line {
+		uint32_t tag;
+		uint32_t target;
+		uint8_t type;
+		bool valid;
+	};
+
+	bool PredictBranch(uint32_t pc, uint32_t* dst) {
+		const size_t entry = Set(pc);
+		const Line& line = m_lines[entry];
+		const bool is_hit = line.valid && line.tag == pc;
+		m_stats.lookups++;
+		m_stats.hits += is_hit;
+
+		//a branch that is not in the BTB (cold or aliased) is predicted not taken
+		bool prediction = false;
+		if (is_hit) {
+			*dst = line.target;
+			if (BP_BRANCH_COND != line.type) {
+				prediction = true;
+				m_targets->Predict(pc, (BP_branchType)line.type, dst);
+			}
+			else prediction = State(Index(entry)) >> (CounterBits - 1);
+		}
+
+		if (!prediction) *dst = pc + 4;
+		return prediction;
+	}
+
+	void InitBranch(uint32_t pc) {
+		const size_t entry = Set(pc);
+		Line& line = m_lines[entry];
+		if (line.valid && line.tag == pc) return;
+
+		m_stats.allocations++;
+		m_stats.conflictEvictions += line.valid;
+
+		line.tag = pc;
+		line.target = 0;
+		line.type = BP_BRANCH_COND;
+		line.valid = true;
+
+		if (!IsGlobalHist) m_histories[entry] = 0;
+		if (!IsGlobalTable)
+			std::fill(m_tables.begin() + entry * ROW_BYTES, m_tables.begin() + (entry + 1) * ROW_BYTES, WntByte());
+	}
+
+	void UpdateBranch(uint32_t pc, uint32_t targetPc, bool taken, BP_branchType type) {
+		//the return address stack and the path history follow every branch, also the ones that miss in the BTB
+		m_targets->Update(pc, type, targetPc);
+
+		//a branch that is not in the BTB is not updated
+		const size_t entry = Set(pc);
+		Line& line = m_lines[entry];
+		if (!line.valid || line.tag != pc) return;
+
+		line.type = (uint8_t)type;
+		line.target = targetPc;
+
+		//saturating increment or decrement of the state machine that made the prediction
+		const size_t index = Index(entry);
+		uint8_t& byte = m_tables[index / PACKED_COUNTERS];
+		const unsigned shift = Shift(index);
+		const unsigned state = (byte >> shift) & COUNTER_MAX;
+		const unsigned next_state = state + (taken & (COUNTER_MAX != state)) - (!taken & (0 != state));
+		byte = (byte & ~(COUNTER_MAX << shift)) | (next_state << shift);
+
+		uint32_t& history = m_histories[IsGlobalHist ? 0 : entry];
+		history = ((history << 1) | uint32_t(taken)) & HISTORY_MASK;
+	}
+
+	//a history as a HistoryRegister of HistSize outcomes: the newest outcomes (no circular buffer, the history is short)
+	//and the folded history, which is the history itself
+	static void TransferHistory(StateArchive& archive, uint32_t& history) {
+		uint64_t recent = history;
+		uint32_t head = 0;
+		uint32_t folded = history;
+		archive.Value(recent);
+		archive.Expect(0);
+		archive.Value(head);
+		archive.Value(folded);
+		archive.Check(0 == head && (recent & HISTORY_MASK) == folded);
+		history = folded;
+	}
+
+	size_t Set(uint32_t pc) const { return (pc >> 2) & m_set_mask; }
+
+	//the state machine of the branch of an entry
+	//here the 'share' feature is implemented by bitwise XOR between the history and the tag (the set index of the pc)
+	size_t Index(size_t entry) const {
+		const uint32_t history = m_histories[IsGlobalHist ? 0 : entry] ^ (IsShare ? (entry & HISTORY_MASK) : 0);
+		return IsGlobalTable ? history : entry * ROW_COUNTERS + history;
+	}
+
+	unsigned State(size_t index) const {
+		return (m_tables[index / PACKED_COUNTERS] >> Shift(index)) & COUNTER_MAX;
+	}
+
+	static unsigned Shift(size_t index) { return CounterBits * (index % PACKED_COUNTERS); }
+
+	//a byte of state machines at 'WNT'
+	static uint8_t WntByte() {
+		uint8_t byte = 0;
+		for (unsigned i = 0; i < PACKED_COUNTERS; i++)
+			byte |= COUNTER_WNT << (CounterBits * i);
+		return byte;
+	}
+
+	unsigned TagBits() const { return 30 - m_set_bits; }
+
+	//an entry holds the valid bit, the tag, the word aligned target and the branch type
+	uint64_t BtbStorageBits() const {
+		return (uint64_t)m_lines.size() * (1 + TagBits() + 30 + 3);
+	}
+
+	TargetPredictor* const m_targets;
+	const uint32_t m_set_mask;
+	unsigned m_set_bits;
+	std::vector<Line> m_lines;
+	std::vector<uint32_t> m_histories;
+	std::vector<uint8_t> m_tables;
+	const unsigned m_btb_size;
+	BP_btbStats m_stats;
+};
+
+//the kernel of the configuration, NULL when no specialization covers it and the generic predictor runs it
+PredictorKernel* CreateKernel(const BP_config& config, TargetPredictor* targets);
+
+#endif /* BP_KERNEL_H_ */
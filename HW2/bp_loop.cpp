@@ -0,0 +1,134 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Loop predictor, overrides the prediction of the other components for counted loops */
+
+#include "bp_loop.h"
+
+//the loop predictor overrides the other components after this many loops in a row with the same trip count
+#define LOOP_CONFIDENT_TRIPS 3
+#define LOOP_CONFIDENCE_MAX 7
+#define LOOP_AGE_MAX 255
+//a new entry cannot be replaced before it has had a chance to learn its trip count
+#define LOOP_AGE_INITIAL 16
+#define LOOP_MAX_TRIP_COUNT 0xFFFF
+#define LOOP_USE_MAX 63
+#define LOOP_USE_MIN -64
+
+LoopPredictor::LoopPredictor(unsigned indexBits) : m_index_bits(indexBits), m_index_mask((0x1 << indexBits) - 1),
+	m_use_loop(0) {
+	//the tag 0 marks a free entry (a tag always has its lowest bit set)
+	Entry empty = { 0, 0, 0, 0, 0, true };
+	m_entries.assign((size_t)1 << indexBits, empty);
+
+	m_stats.branches = m_stats.overrides = m_stats.overridesCorrect = 0;
+	m_stats.mispredictionsRemoved = m_stats.mispredictionsAdded = 0;
+}
+
+bool LoopPredictor::Prediction(uint32_t pc, bool base_prediction) const {
+	bool prediction;
+	return (m_use_loop >= 0 && LoopPrediction(pc, &prediction)) ? prediction : base_prediction;
+}
+
+bool LoopPredictor::LoopPrediction(uint32_t pc, bool* prediction) const {
+	const Entry& entry = m_entries[Index(pc)];
+	if (entry.tag != Tag(pc) || entry.confidence < LOOP_CONFIDENT_TRIPS)
+		return false;
+
+	//the branch leaves the loop after trip_count iterations
+	*prediction = (entry.iteration == entry.trip_count) ? !entry.direction : entry.direction;
+	return true;
+}
+
+void LoopPredictor::Update(uint32_t pc, bool taken, bool base_prediction) {
+	Entry& entry = m_entries[Index(pc)];
+	m_stats.branches++;
+
+	if (entry.tag != Tag(pc)) {
+		//allocate an entry for a branch that the other components mispredicted, when the current entry is old enough
+		if (taken == base_prediction) return;
+
+		if (entry.age > 0) {
+			entry.age--;
+			return;
+		}
+
+		//the misprediction is most likely the exit of the loop, so the loop direction is the other one
+		entry.tag = Tag(pc);
+		entry.direction = !taken;
+		entry.trip_count = 0;
+		entry.iteration = 0;
+		entry.confidence = 0;
+		entry.age = LOOP_AGE_INITIAL;
+		return;
+	}
+
+	bool loop_prediction;
+	if (LoopPrediction(pc, &loop_prediction)) {
+		if (m_use_loop >= 0) {
+			m_stats.overrides++;
+			m_stats.overridesCorrect += (loop_prediction == taken);
+			m_stats.mispredictionsRemoved += (loop_prediction == taken && base_prediction != taken);
+			m_stats.mispredictionsAdded += (loop_prediction != taken && base_prediction == taken);
+		}
+
+		//learn whether the overrides help, whether they are applied or not
+		if (loop_prediction != base_prediction) {
+			if (loop_prediction == taken)	m_use_loop += (m_use_loop < LOOP_USE_MAX);
+			else							m_use_loop -= (m_use_loop > LOOP_USE_MIN);
+		}
+
+		if (loop_prediction != taken) {
+			//the trip count has changed (or the branch is not a counted loop), free the entry
+			entry.tag = 0;
+			entry.age = 0;
+			return;
+		}
+
+		if (base_prediction != taken && entry.age < LOOP_AGE_MAX) entry.age++;
+	}
+
+	if (taken == entry.direction) {
+		//a branch that does not leave its loop is not a counted loop, free the entry
+		if (LOOP_MAX_TRIP_COUNT == entry.iteration) {
+			entry.tag = 0;
+			entry.age = 0;
+			return;
+		}
+
+		entry.iteration++;
+		return;
+	}
+
+	//the exit of the loop
+	//an exit without iterations means that the loop direction was guessed wrong when the entry was allocated, free it
+	if (0 == entry.iteration) {
+		entry.tag = 0;
+		entry.age = 0;
+		return;
+	}
+
+	if (entry.iteration == entry.trip_count) {
+		if (entry.confidence < LOOP_CONFIDENCE_MAX) entry.confidence++;
+	}
+	else {
+		entry.trip_count = entry.iteration;
+		entry.confidence = 0;
+	}
+
+	entry.iteration = 0;
+	return;
+}
+
+void LoopPredictor::Transfer(StateArchive& archive) {
+	archive.Expect(m_entries.size());
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		Entry& entry = m_entries[i];
+		archive.Value(entry.tag);
+		archive.Value(entry.trip_count);
+		archive.Value(entry.iteration);
+		archive.Value(entry.confidence);
+		archive.Value(entry.age);
+		archive.Value(entry.direction);
+	}
+
+	archive.Value(m_use_loop);
+}
@@ -0,0 +1,56 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Loop predictor, overrides the prediction of the other components for counted loops */
+
+#ifndef BP_LOOP_H_
+#define BP_LOOP_H_
+
+#include "bp_api.h"
+#include "bp_state.h"
+#include <vector>
+
+//learns the trip count of every loop branch (a branch that repeats one direction N times and then goes the other way)
+//once the same trip count has been seen LOOP_CONFIDENT_TRIPS times in a row, the loop predictor predicts the branch,
+//including the exit of the loop that the history based components mispredict when N exceeds their history
+//the overrides are applied while they have been correcting the other components more often than not
+class LoopPredictor
+{
+public:
+	LoopPredictor(unsigned indexBits);
+	~LoopPredictor() {}
+
+	//the prediction of the branch: the loop prediction when it is confident, the base prediction otherwise
+	bool Prediction(uint32_t pc, bool base_prediction) const;
+
+	//base_prediction is the prediction of the other components for this branch
+	void Update(uint32_t pc, bool taken, bool base_prediction);
+
+	const BP_loopStats& Stats() const { return m_stats; }
+
+	//saves or loads the entries (see StateArchive), the statistics are not part of the state
+	void Transfer(StateArchive& archive);
+
+private:
+	struct Entry {
+		uint16_t tag;
+		uint16_t trip_count;		//the number of iterations (branches in the loop direction) of the last loop
+		uint16_t iteration;			//the number of iterations of the current loop
+		uint8_t confidence;			//the number of loops in a row with the same trip count
+		uint8_t age;				//an entry can be replaced only when its age is 0
+		bool direction;				//the direction of the branch inside the loop
+	};
+
+	size_t Index(uint32_t pc) const { return (pc >> 2) & m_index_mask; }
+	uint16_t Tag(uint32_t pc) const { return (uint16_t)((pc >> (2 + m_index_bits)) | 0x1); }
+
+	//returns true and sets the prediction when the entry of the branch is confident
+	bool LoopPrediction(uint32_t pc, bool* prediction) const;
+
+	const unsigned m_index_bits;
+	const uint32_t m_index_mask;
+	std::vector<Entry> m_entries;
+	//signed counter, the confident entries override the other components when it is non negative
+	int m_use_loop;
+	BP_loopStats m_stats;
+};
+
+#endif /* BP_LOOP_H_ */
@@ -73,8 +73,20 @@ int main(int argc, char **argv) {
 		exit(7);
 	}
 
-	if (BP_init(btbSize, historySize, isGlobalHist,
-			isGlobalTable, isShare) < 0) {
+	BP_config config;
+	BP_defaultConfig(&config, btbSize, historySize, isGlobalHist,
+			isGlobalTable, isShare);
+
+	/* optional fields: the predictor engine and its parameters */
+	char *option;
+	while ((option = strtok(NULL, " \n")) != NULL) {
+		if (BP_parseOption(&config, option) < 0) {
+			fprintf(stderr, "Error in input file: cannot read config\n");
+			exit(10);
+		}
+	}
+
+	if (BP_initConfig(&config) < 0) {
 		fprintf(stderr, "Predictor init failed\n");
 		exit(8);
 	}
@@ -83,10 +95,10 @@ int main(int argc, char **argv) {
 		if (line[0] == '\n') {
 			break;
 		}
-		char *elemnts[3];
+		char *elemnts[4];
 		int i = 0;
 		elemnts[0] = strtok(line, " ");
-		for (i = 1; i < 3; ++i) {
+		for (i = 1; i < 4; ++i) {
 			elemnts[i] = strtok(NULL, " \n");
 		}
 		uint32_t pc = (uint32_t) strtol(elemnts[0], NULL, 0);
@@ -100,13 +112,20 @@ int main(int argc, char **argv) {
 			fprintf(stderr, "Error in input file: bad trace\n");
 			exit(9);
 		}
+		/* optional field: the branch type */
+		BP_branchType type = BP_BRANCH_COND;
+		if (elemnts[3] != NULL && BP_parseBranchType(elemnts[3], &type) < 0) {
+			fprintf(stderr, "Error in input file: bad trace\n");
+			exit(9);
+		}
 		uint32_t dst = 0;
 		printf("0x%x ", pc);
 		printf("%c ", (BP_predict(pc, &dst)? 'T' : 'N'));
 		printf("0x%x\n", dst);
 		BP_setBranchAt(pc);
-		BP_update(pc, targetPc, taken);
+		BP_updateTyped(pc, targetPc, taken, type);
 	}
+	BP_printReport(stderr);
 
 	fclose(trace);
 	return 0;
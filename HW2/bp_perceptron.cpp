@@ -0,0 +1,192 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Hashed perceptron predictor with SIMD dot product kernels */
+
+#include "bp_perceptron.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PERCEPTRON_X86
+#endif
+
+//the weights saturate at +-127 so that negating a weight never overflows
+#define PERCEPTRON_WEIGHT_MAX 127
+#define PERCEPTRON_WEIGHT_MIN -127
+
+//dot product of the weights and the history (+1 / -1, 0 for no contribution), length is a multiple of PERCEPTRON_LANES
+typedef int (*DotKernel)(const int8_t* weights, const int8_t* history, unsigned length);
+//weights += (taken ? +1 : -1) * history, saturating at +-127
+typedef void (*TrainKernel)(int8_t* weights, const int8_t* history, const int8_t* mask, unsigned length, bool taken);
+
+static int8_t Saturate(int weight) {
+	return (int8_t)((weight > PERCEPTRON_WEIGHT_MAX) ? PERCEPTRON_WEIGHT_MAX :
+		(weight < PERCEPTRON_WEIGHT_MIN) ? PERCEPTRON_WEIGHT_MIN : weight);
+}
+
+static int DotScalar(const int8_t* weights, const int8_t* history, unsigned length) {
+	int sum = 0;
+	for (unsigned i = 0; i < length; i++)
+		sum += weights[i] * history[i];
+	return sum;
+}
+
+static void TrainScalar(int8_t* weights, const int8_t* history, const int8_t* mask, unsigned length, bool taken) {
+	const int direction = taken ? 1 : -1;
+	for (unsigned i = 0; i < length; i++)
+		weights[i] = Saturate(weights[i] + direction * history[i] * mask[i]);
+}
+
+#ifdef PERCEPTRON_X86
+//sign_epi8 negates a weight where the history is -1 (and zeroes it where it is 0)
+//maddubs_epi16 and madd_epi16 then widen the sums of the int8 lanes to int32
+__attribute__((target("avx2")))
+static int DotAvx2(const int8_t* weights, const int8_t* history, unsigned length) {
+	const __m256i ones8 = _mm256_set1_epi8(1);
+	const __m256i ones16 = _mm256_set1_epi16(1);
+	__m256i sum = _mm256_setzero_si256();
+
+	for (unsigned i = 0; i < length; i += 32) {
+		const __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+		const __m256i h = _mm256_loadu_si256((const __m256i*)(history + i));
+		const __m256i pairs = _mm256_maddubs_epi16(ones8, _mm256_sign_epi8(w, h));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, ones16));
+	}
+
+	__m128i quad = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	quad = _mm_add_epi32(quad, _mm_shuffle_epi32(quad, _MM_SHUFFLE(1, 0, 3, 2)));
+	quad = _mm_add_epi32(quad, _mm_shuffle_epi32(quad, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(quad);
+}
+
+__attribute__((target("avx2")))
+static void TrainAvx2(int8_t* weights, const int8_t* history, const int8_t* mask, unsigned length, bool taken) {
+	const __m256i min = _mm256_set1_epi8(PERCEPTRON_WEIGHT_MIN);
+
+	for (unsigned i = 0; i < length; i += 32) {
+		const __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+		const __m256i h = _mm256_sign_epi8(_mm256_loadu_si256((const __m256i*)(history + i)),
+			_mm256_loadu_si256((const __m256i*)(mask + i)));
+		const __m256i trained = taken ? _mm256_adds_epi8(w, h) : _mm256_subs_epi8(w, h);
+		_mm256_storeu_si256((__m256i*)(weights + i), _mm256_max_epi8(trained, min));
+	}
+}
+
+__attribute__((target("sse4.1")))
+static int DotSse(const int8_t* weights, const int8_t* history, unsigned length) {
+	const __m128i ones8 = _mm_set1_epi8(1);
+	const __m128i ones16 = _mm_set1_epi16(1);
+	__m128i sum = _mm_setzero_si128();
+
+	for (unsigned i = 0; i < length; i += 16) {
+		const __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+		const __m128i h = _mm_loadu_si128((const __m128i*)(history + i));
+		const __m128i pairs = _mm_maddubs_epi16(ones8, _mm_sign_epi8(w, h));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pairs, ones16));
+	}
+
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("sse4.1")))
+static void TrainSse(int8_t* weights, const int8_t* history, const int8_t* mask, unsigned length, bool taken) {
+	const __m128i min = _mm_set1_epi8(PERCEPTRON_WEIGHT_MIN);
+
+	for (unsigned i = 0; i < length; i += 16) {
+		const __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+		const __m128i h = _mm_sign_epi8(_mm_loadu_si128((const __m128i*)(history + i)),
+			_mm_loadu_si128((const __m128i*)(mask + i)));
+		const __m128i trained = taken ? _mm_adds_epi8(w, h) : _mm_subs_epi8(w, h);
+		_mm_storeu_si128((__m128i*)(weights + i), _mm_max_epi8(trained, min));
+	}
+}
+#endif
+
+//the kernels are selected once, by the features of the cpu the simulator runs on
+struct Kernels {
+	Kernels() : dot(DotScalar), train(TrainScalar), name("scalar") {
+#ifdef PERCEPTRON_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			dot = DotAvx2;
+			train = TrainAvx2;
+			name = "avx2";
+		}
+		else if (__builtin_cpu_supports("sse4.1")) {
+			dot = DotSse;
+			train = TrainSse;
+			name = "sse4.1";
+		}
+#endif
+	}
+
+	DotKernel dot;
+	TrainKernel train;
+	const char* name;
+};
+
+static const Kernels kernels;
+
+
+PerceptronTable::PerceptronTable(unsigned historySize, unsigned indexBits) :
+	PredictionTable(historySize), m_history_size(historySize),
+	m_padded_size((historySize + PERCEPTRON_LANES - 1) / PERCEPTRON_LANES * PERCEPTRON_LANES),
+	m_index_bits(indexBits), m_index_mask((0x1 << indexBits) - 1),
+	//the training threshold of Jimenez and Lin
+	m_threshold((int)(1.93 * historySize + 14)),
+	m_weights((size_t)m_padded_size << indexBits, 0), m_bias((size_t)1 << indexBits, 0),
+	m_window(2 * m_padded_size, -1), m_head(0), m_lane_mask(m_padded_size, 0) {
+
+	std::fill(m_lane_mask.begin(), m_lane_mask.begin() + historySize, 1);
+}
+
+bool PerceptronTable::Prediction(uint32_t, unsigned pc) {
+	return Output(pc) >= 0;
+}
+
+void PerceptronTable::Update(uint32_t, bool actual_prediction, unsigned int pc) {
+	const int output = Output(pc);
+
+	//train on a misprediction or a low confidence prediction
+	if ((output >= 0) != actual_prediction || (output < m_threshold && output > -m_threshold)) {
+		const size_t row = Row(pc);
+		m_bias[row] = Saturate(m_bias[row] + (actual_prediction ? 1 : -1));
+		kernels.train(&m_weights[row * m_padded_size], Window(), &m_lane_mask[0], m_padded_size, actual_prediction);
+	}
+
+	//shift the outcome into the window
+	m_head = ((0 == m_head) ? m_padded_size : m_head) - 1;
+	m_window[m_head] = m_window[m_head + m_padded_size] = actual_prediction ? 1 : -1;
+	return;
+}
+
+uint64_t PerceptronTable::StorageBits() const {
+	//8-bit weights, the padding lanes are not counted
+	return (uint64_t)m_bias.size() * (m_history_size + 1) * 8 + m_history_size;
+}
+
+void PerceptronTable::Transfer(StateArchive& archive) {
+	archive.Bytes(m_weights.data(), m_weights.size());
+	archive.Bytes(m_bias.data(), m_bias.size());
+	//the weights of the padding lanes are 0, so that they add nothing to the dot products
+	for (size_t i = 0; i < m_weights.size(); i++) {
+		archive.Check(PERCEPTRON_WEIGHT_MIN <= m_weights[i] && PERCEPTRON_WEIGHT_MAX >= m_weights[i]);
+		archive.Check(i % m_padded_size < m_history_size || 0 == m_weights[i]);
+	}
+	for (size_t i = 0; i < m_bias.size(); i++)
+		archive.Check(PERCEPTRON_WEIGHT_MIN <= m_bias[i] && PERCEPTRON_WEIGHT_MAX >= m_bias[i]);
+	archive.Bytes(m_window.data(), m_window.size());
+	for (size_t i = 0; i < m_window.size(); i++)
+		archive.Check(1 == m_window[i] || -1 == m_window[i]);
+	archive.Value(m_head);
+	archive.Check(m_head < m_padded_size);
+}
+
+const char* PerceptronTable::KernelName() {
+	return kernels.name;
+}
+
+int PerceptronTable::Output(unsigned pc) const {
+	const size_t row = Row(pc);
+	return m_bias[row] + kernels.dot(&m_weights[row * m_padded_size], Window(), m_padded_size);
+}
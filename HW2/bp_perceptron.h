@@ -0,0 +1,63 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Hashed perceptron predictor with SIMD dot product kernels */
+
+#ifndef BP_PERCEPTRON_H_
+#define BP_PERCEPTRON_H_
+
+#include "bp_api.h"
+#include "bp_tables.h"
+
+//the weight vectors are padded to a multiple of the widest SIMD register (32 int8 lanes)
+#define PERCEPTRON_LANES 32
+
+//the perceptron keeps its own global history, the history given by the BTB is ignored
+//
+//every branch (hashed by its pc) owns a vector of int8 weights, one per history bit, and a bias weight
+//the prediction is taken when bias + sum(history[i] ? weight[i] : -weight[i]) >= 0
+//the weights are trained on a misprediction, or when the magnitude of the sum is below the threshold
+class PerceptronTable : public PredictionTable
+{
+public:
+	PerceptronTable(unsigned historySize, unsigned indexBits);
+	virtual ~PerceptronTable() {}
+
+	virtual bool Prediction(uint32_t history, unsigned pc = 0);
+
+	virtual void Update(uint32_t history, bool actual_prediction, unsigned int pc = 0);
+
+	virtual uint64_t StorageBits() const;
+
+	virtual void Transfer(StateArchive& archive);
+
+	//the name of the dot product kernel selected for this cpu ("avx2", "sse4.1" or "scalar")
+	static const char* KernelName();
+
+private:
+	int Output(unsigned pc) const;
+
+	size_t Row(unsigned pc) const {
+		return (size_t)(((pc >> 2) ^ (pc >> (2 + m_index_bits))) & m_index_mask);
+	}
+
+	//the history window of m_padded_size outcomes (+1 taken, -1 not taken), the newest outcome first
+	const int8_t* Window() const { return &m_window[m_head]; }
+
+	const unsigned m_history_size;
+	const unsigned m_padded_size;
+	const unsigned m_index_bits;
+	const uint32_t m_index_mask;
+	const int m_threshold;
+
+	//the weight vectors of all the rows in a single contiguous array, m_padded_size weights per row
+	std::vector<int8_t> m_weights;
+	std::vector<int8_t> m_bias;
+
+	//the history is written twice (at head and at head + m_padded_size) so that the window is always contiguous
+	std::vector<int8_t> m_window;
+	unsigned m_head;
+
+	//+1 for the m_history_size first lanes of a window and 0 for the padding, so the padding weights stay 0
+	std::vector<int8_t> m_lane_mask;
+};
+
+#endif /* BP_PERCEPTRON_H_ */
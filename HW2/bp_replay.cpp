@@ -0,0 +1,79 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Runs the predictor over a binary trace (see bp_trace.h), decoded as it is read */
+/* Usage: ./bp_replay <binary trace> [--summary] */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "bp_trace.h"
+
+using namespace std;
+
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argc > 3 || (3 == argc && strcmp(argv[2], "--summary"))) {
+		fprintf(stderr, "Usage: %s <binary trace> [--summary]\n", argv[0]);
+		return 1;
+	}
+	const bool is_summary = (3 == argc);
+
+	TraceReader reader;
+	if (!reader.Open(argv[1])) {
+		fprintf(stderr, "cannot open binary trace file\n");
+		return 2;
+	}
+
+	BP_config config;
+	if (!ParseConfigLine(reader.Config(), &config)) {
+		fprintf(stderr, "Error in input file: cannot read config\n");
+		return 3;
+	}
+	if (BP_initConfig(&config) < 0) {
+		fprintf(stderr, "Predictor init failed\n");
+		return 8;
+	}
+
+	//the predictions are printed as bp_main prints them, but fully buffered
+	static char output_buffer[OUTPUT_BUFFER_SIZE];
+	setvbuf(stdout, output_buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+	unsigned long long branches = 0, direction_mispredictions = 0, target_mispredictions = 0;
+	BP_branch branch;
+	while (reader.Next(&branch)) {
+		uint32_t dst = 0;
+		const bool prediction = BP_predict(branch.pc, &dst);
+		if (is_summary) {
+			branches++;
+			direction_mispredictions += (prediction != branch.taken);
+			target_mispredictions += (prediction && branch.taken && dst != branch.targetPc);
+		}
+		else printf("0x%x %c 0x%x\n", branch.pc, prediction ? 'T' : 'N', dst);
+
+		BP_setBranchAt(branch.pc);
+		BP_updateTyped(branch.pc, branch.targetPc, branch.taken, branch.type);
+	}
+
+	if (reader.IsBroken()) {
+		fflush(stdout);
+		fprintf(stderr, "Error in input file: bad trace\n");
+		return 9;
+	}
+
+	if ('\0' != config.saveState[0] && BP_saveState(config.saveState) < 0) {
+		fflush(stdout);
+		fprintf(stderr, "cannot save the predictor state\n");
+		return 2;
+	}
+
+	if (is_summary) {
+		printf("branches %llu, direction mispredictions %llu (%.2f%%), target mispredictions %llu (%.2f%%)\n",
+			branches, direction_mispredictions, (0 == branches) ? 0.0 : 100.0 * direction_mispredictions / branches,
+			target_mispredictions, (0 == branches) ? 0.0 : 100.0 * target_mispredictions / branches);
+	}
+	fflush(stdout);
+
+	BP_printReport(stderr);
+	return 0;
+}
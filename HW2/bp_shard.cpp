@@ -0,0 +1,177 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Runs the predictor of a trace in shards on parallel threads, against a sequential run of the whole trace */
+/* Usage: ./bp_shard <binary trace> [shards] [warm-up branches] */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include "bp_trace.h"
+
+using namespace std;
+
+#define DEFAULT_WARMUP 100000
+
+//every shard streams its branches from the trace file, and runs them in chunks of this many branches
+#define RUN_CHUNK (1 << 16)
+
+struct Shard {
+	uint64_t begin;
+	uint64_t end;
+	uint64_t warmup;		//the branches before begin that warm the predictor of the shard up
+	bool is_broken;		//the trace could not be read
+	int result;
+	BP_runStats stats;
+};
+
+static unsigned long long Mispredictions(const BP_runStats& stats) {
+	return stats.directionMispredictions + stats.targetMispredictions;
+}
+
+static double Accuracy(const BP_runStats& stats) {
+	return (0 == stats.branches) ? 100.0 : 100.0 * (1.0 - (double)Mispredictions(stats) / stats.branches);
+}
+
+//runs the next branches of the reader, false when the trace ends before them or is broken
+static bool RunBranches(TraceReader& reader, BP_predictor* predictor, uint64_t branches, vector<BP_branch>& chunk) {
+	while (branches > 0) {
+		chunk.clear();
+		BP_branch branch;
+		while (chunk.size() < RUN_CHUNK && chunk.size() < branches && reader.Next(&branch))
+			chunk.push_back(branch);
+		if (chunk.empty())
+			return false;
+
+		BP_predictorRun(predictor, chunk.data(), chunk.size());
+		branches -= chunk.size();
+	}
+	return true;
+}
+
+//the predictor of the shard runs the warm-up branches and then its own branches, read by a reader of its own
+static void RunShard(const char* path, const BP_config& config, Shard* shard) {
+	shard->result = 0;
+	shard->is_broken = true;
+
+	TraceReader reader;
+	if (!reader.Open(path) || !reader.Seek(shard->begin - shard->warmup))
+		return;
+
+	BP_predictor* predictor = BP_create(&config);
+	if (NULL == predictor) {
+		shard->result = -1;
+		return;
+	}
+
+	//the warm-up branches train the predictor, and are taken out of the counts
+	vector<BP_branch> chunk;
+	BP_stats warm, all;
+	if (RunBranches(reader, predictor, shard->warmup, chunk)) {
+		BP_predictorGetStats(predictor, &warm);
+		if (RunBranches(reader, predictor, shard->end - shard->begin, chunk)) {
+			BP_predictorGetStats(predictor, &all);
+			shard->stats.branches = all.branches - warm.branches;
+			shard->stats.directionMispredictions = all.directionMispredictions - warm.directionMispredictions;
+			shard->stats.targetMispredictions = all.targetMispredictions - warm.targetMispredictions;
+			shard->is_broken = false;
+		}
+	}
+	BP_destroy(predictor);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "Usage: %s <binary trace> [shards] [warm-up branches]\n", argv[0]);
+		return 1;
+	}
+
+	unsigned shards = (argc > 2) ? strtoul(argv[2], NULL, 0) : thread::hardware_concurrency();
+	if (0 == shards) shards = 1;
+	const uint64_t warmup = (argc > 3) ? strtoull(argv[3], NULL, 0) : DEFAULT_WARMUP;
+
+	//the shards seek into the trace, a text trace (or a binary trace without seek points) is converted by bp_convert
+	TraceReader reader;
+	if (!reader.Open(argv[1])) {
+		fprintf(stderr, "cannot open binary trace file\n");
+		return 2;
+	}
+	if (!reader.CanSeek()) {
+		fprintf(stderr, "Error in input file: the binary trace has no seek table\n");
+		return 9;
+	}
+
+	BP_config config;
+	if (!ParseConfigLine(reader.Config(), &config)) {
+		fprintf(stderr, "Error in input file: cannot read config\n");
+		return 3;
+	}
+	const uint64_t branches = reader.Branches();
+
+	//shard i runs the branches [begin, end), after replaying the last warm-up branches of the shards before it
+	vector<Shard> jobs(shards);
+	for (unsigned i = 0; i < shards; i++) {
+		jobs[i].begin = branches * i / shards;
+		jobs[i].end = branches * (i + 1) / shards;
+		jobs[i].warmup = (jobs[i].begin < warmup) ? jobs[i].begin : warmup;
+	}
+
+	//the times cover the whole runs: reading and decoding the trace as well as the predictions
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<thread> workers;
+	for (unsigned i = 0; i < shards; i++)
+		workers.push_back(thread(RunShard, argv[1], config, &jobs[i]));
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	const double sharded_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	//the merged statistics of the shards
+	BP_runStats sharded = { 0, 0, 0, 0 };
+	for (unsigned i = 0; i < shards; i++) {
+		if (jobs[i].result < 0) {
+			fprintf(stderr, "Predictor init failed\n");
+			return 8;
+		}
+		if (jobs[i].is_broken) {
+			fprintf(stderr, "Error in input file: bad trace\n");
+			return 9;
+		}
+		sharded.branches += jobs[i].stats.branches;
+		sharded.directionMispredictions += jobs[i].stats.directionMispredictions;
+		sharded.targetMispredictions += jobs[i].stats.targetMispredictions;
+	}
+
+	//the sequential run is a single shard of the whole trace
+	Shard whole;
+	whole.begin = whole.warmup = 0;
+	whole.end = branches;
+	start = chrono::steady_clock::now();
+	RunShard(argv[1], config, &whole);
+	if (whole.result < 0 || whole.is_broken) {
+		fprintf(stderr, (whole.result < 0) ? "Predictor init failed\n" : "Error in input file: bad trace\n");
+		return (whole.result < 0) ? 8 : 9;
+	}
+	const BP_runStats& sequential = whole.stats;
+	const double sequential_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	printf("%5s %12s %12s %12s %9s\n", "shard", "first", "branches", "warm-up", "accuracy");
+	for (unsigned i = 0; i < shards; i++) {
+		printf("%5u %12llu %12llu %12llu %8.2f%%\n", i, (unsigned long long)jobs[i].begin,
+			(unsigned long long)jobs[i].stats.branches, (unsigned long long)jobs[i].warmup, Accuracy(jobs[i].stats));
+	}
+
+	printf("sequential: %llu branches, %llu mispredictions, accuracy %.4f%%, %.2f seconds\n",
+		(unsigned long long)sequential.branches, Mispredictions(sequential), Accuracy(sequential), sequential_seconds);
+	printf("sharded: %u shards, %llu warm-up branches, %llu mispredictions, accuracy %.4f%%, %.2f seconds (%.2fx)\n",
+		shards, (unsigned long long)warmup, Mispredictions(sharded), Accuracy(sharded), sharded_seconds,
+		(0.0 == sharded_seconds) ? 0.0 : sequential_seconds / sharded_seconds);
+
+	//the error of the sharded run: the mispredictions that the shards add (or remove) against the sequential run
+	const long long error = (long long)Mispredictions(sharded) - (long long)Mispredictions(sequential);
+	printf("error: %+lld mispredictions, %+.4f%% of the branches, %+.2f%% of the sequential mispredictions\n", error,
+		(0 == sequential.branches) ? 0.0 : 100.0 * error / sequential.branches,
+		(0 == Mispredictions(sequential)) ? 0.0 : 100.0 * error / Mispredictions(sequential));
+	return 0;
+}
@@ -0,0 +1,123 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* State files: the trained state of a predictor, saved to skip the warm-up of later runs */
+
+#include "bp_state.h"
+#include <string.h>
+
+bool StateArchive::Create(const char* path) {
+	m_file = fopen(path, "wb");
+	if (NULL == m_file)
+		return false;
+
+	m_is_loading = false;
+	fwrite(STATE_MAGIC, 1, 4, m_file);
+	fputc(STATE_VERSION, m_file);
+	return true;
+}
+
+bool StateArchive::Open(const char* path) {
+	m_file = fopen(path, "rb");
+	if (NULL == m_file)
+		return false;
+
+	m_is_loading = true;
+	char header[5];
+	return 5 == fread(header, 1, 5, m_file) && 0 == memcmp(header, STATE_MAGIC, 4) && STATE_VERSION == header[4];
+}
+
+bool StateArchive::Close() {
+	if (NULL == m_file)
+		return false;
+
+	if (m_is_loading && EOF != fgetc(m_file))
+		m_is_broken = true;
+	if (0 != fclose(m_file))
+		m_is_broken = true;
+	m_file = NULL;
+	return !m_is_broken;
+}
+
+void StateArchive::Expect(uint64_t value) {
+	if (m_is_loading) Check(Read() == value);
+	else Write(value);
+}
+
+void StateArchive::Value(bool& value) {
+	uint8_t byte = value;
+	Value(byte);
+	Check(byte <= 1);
+	value = (1 == byte);
+}
+
+void StateArchive::Value(int8_t& value) {
+	uint8_t byte = (uint8_t)value;
+	Value(byte);
+	value = (int8_t)byte;
+}
+
+void StateArchive::Value(uint8_t& value) {
+	uint64_t wide = value;
+	Value(wide);
+	Check(wide <= UINT8_MAX);
+	value = (uint8_t)wide;
+}
+
+void StateArchive::Value(uint16_t& value) {
+	uint64_t wide = value;
+	Value(wide);
+	Check(wide <= UINT16_MAX);
+	value = (uint16_t)wide;
+}
+
+//zigzag encoded: the small negative values are short too
+void StateArchive::Value(int& value) {
+	uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	Value(zigzag);
+	value = (int)(zigzag >> 1) ^ -(int)(zigzag & 0x1);
+}
+
+void StateArchive::Value(uint32_t& value) {
+	uint64_t wide = value;
+	Value(wide);
+	Check(wide <= UINT32_MAX);
+	value = (uint32_t)wide;
+}
+
+void StateArchive::Value(uint64_t& value) {
+	if (m_is_loading) value = Read();
+	else Write(value);
+}
+
+void StateArchive::Bytes(void* data, size_t size) {
+	Expect(size);
+	if (!m_is_loading) {
+		fwrite(data, 1, size, m_file);
+		return;
+	}
+
+	//a broken state may have a wrong size, the bytes are read only into a buffer of the expected size
+	if (m_is_broken || size != fread(data, 1, size, m_file))
+		m_is_broken = true;
+}
+
+void StateArchive::Write(uint64_t value) {
+	while (value >= 0x80) {
+		fputc((int)(value & 0x7F) | 0x80, m_file);
+		value >>= 7;
+	}
+	fputc((int)value, m_file);
+}
+
+uint64_t StateArchive::Read() {
+	uint64_t value = 0;
+	for (unsigned shift = 0; shift < 64; shift += 7) {
+		const int byte = fgetc(m_file);
+		if (EOF == byte) break;
+
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (0 == (byte & 0x80)) return value;
+	}
+
+	m_is_broken = true;
+	return 0;
+}
@@ -0,0 +1,67 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* State files: the trained state of a predictor, saved to skip the warm-up of later runs */
+
+#ifndef BP_STATE_H_
+#define BP_STATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//the format of a state file: the magic "BPST", a version byte, then the state of the predictor components in a fixed order,
+//as their Transfer lists it (the integers as LEB128 varints, the state machines and the weights as their raw bytes)
+//the configuration and the sizes of the tables are part of the state, so a state loads only into a predictor of the
+//configuration that saved it
+#define STATE_MAGIC "BPST"
+#define STATE_VERSION 1
+
+//a state file, written and read back by the same Transfer of every component:
+//when saving, Transfer writes the members to the file, when loading it reads the members back from the file
+class StateArchive
+{
+public:
+	StateArchive() : m_file(NULL), m_is_loading(false), m_is_broken(false) {}
+	~StateArchive() {
+		if (NULL != m_file) fclose(m_file);
+	}
+
+	//a new state file to save into, false when it cannot be created
+	bool Create(const char* path);
+
+	//a state file to load from, false when it cannot be opened or it is not a state file
+	bool Open(const char* path);
+
+	//false when the state could not be written, or when the loaded state is broken or the file goes on after it
+	bool Close();
+
+	bool IsLoading() const { return m_is_loading; }
+
+	//a loaded value that the component cannot take breaks the state
+	void Check(bool is_valid) {
+		if (!is_valid) m_is_broken = true;
+	}
+
+	//a value that the loaded state must repeat: the configuration and the sizes of the tables
+	void Expect(uint64_t value);
+
+	void Value(bool& value);
+	void Value(int8_t& value);
+	void Value(uint8_t& value);
+	void Value(uint16_t& value);
+	void Value(int& value);
+	void Value(uint32_t& value);
+	void Value(uint64_t& value);
+
+	//size raw bytes, the size is part of the state
+	void Bytes(void* data, size_t size);
+
+private:
+	void Write(uint64_t value);
+	uint64_t Read();
+
+	FILE* m_file;
+	bool m_is_loading;
+	bool m_is_broken;
+};
+
+#endif /* BP_STATE_H_ */
@@ -0,0 +1,53 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Per branch statistics, kept in an open addressing hash table */
+
+#include "bp_stats.h"
+#include <algorithm>
+
+#define STATS_INITIAL_BITS 10
+
+static const BP_branchStats empty_entry = { 0, 0, 0, 0, 0 };
+
+static bool IsMoreMispredicted(const BP_branchStats& a, const BP_branchStats& b) {
+	const uint64_t a_mispredictions = a.directionMispredictions + a.targetMispredictions;
+	const uint64_t b_mispredictions = b.directionMispredictions + b.targetMispredictions;
+	if (a_mispredictions != b_mispredictions) return a_mispredictions > b_mispredictions;
+	return a.pc < b.pc;
+}
+
+BranchStatsTable::BranchStatsTable() : m_bits(STATS_INITIAL_BITS), m_mask(((size_t)1 << STATS_INITIAL_BITS) - 1),
+	m_size(0) {
+	m_entries.assign((size_t)1 << m_bits, empty_entry);
+}
+
+unsigned BranchStatsTable::Top(BP_branchStats* branches, unsigned count) const {
+	std::vector<BP_branchStats> used;
+	used.reserve(m_size);
+	for (size_t slot = 0; slot < m_entries.size(); slot++)
+		if (0 != m_entries[slot].executions) used.push_back(m_entries[slot]);
+
+	const size_t top = std::min((size_t)count, used.size());
+	std::partial_sort(used.begin(), used.begin() + top, used.end(), IsMoreMispredicted);
+	std::copy(used.begin(), used.begin() + top, branches);
+	return (unsigned)top;
+}
+
+//doubles the table and reinserts the branches, the branch being inserted (that has no executions yet) is dropped
+//and inserted again by Find
+void BranchStatsTable::Grow() {
+	std::vector<BP_branchStats> old_entries(m_entries.size() * 2, empty_entry);
+	old_entries.swap(m_entries);
+	m_bits++;
+	m_mask = m_entries.size() - 1;
+	m_size = 0;
+
+	for (size_t slot = 0; slot < old_entries.size(); slot++) {
+		if (0 == old_entries[slot].executions) continue;
+
+		size_t new_slot = Slot(old_entries[slot].pc);
+		while (0 != m_entries[new_slot].executions)
+			new_slot = (new_slot + 1) & m_mask;
+		m_entries[new_slot] = old_entries[slot];
+		m_size++;
+	}
+}
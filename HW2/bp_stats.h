@@ -0,0 +1,62 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Per branch statistics, kept in an open addressing hash table */
+
+#ifndef BP_STATS_H_
+#define BP_STATS_H_
+
+#include "bp_api.h"
+#include <vector>
+
+//the counters of every static branch, in a linear probing hash table keyed by the pc
+//an entry with no executions is free, so the table needs no separate occupancy bits
+class BranchStatsTable
+{
+public:
+	BranchStatsTable();
+	~BranchStatsTable() {}
+
+	void Count(uint32_t pc, bool taken, bool isDirectionMispredicted, bool isTargetMispredicted) {
+		BP_branchStats& entry = Find(pc);
+		entry.executions++;
+		entry.taken += taken;
+		entry.directionMispredictions += isDirectionMispredicted;
+		entry.targetMispredictions += isTargetMispredicted;
+	}
+
+	//the number of static branches
+	size_t Size() const { return m_size; }
+
+	//up to count branches with the most mispredictions (direction and target), the most mispredicted first
+	unsigned Top(BP_branchStats* branches, unsigned count) const;
+
+private:
+	size_t Slot(uint32_t pc) const {
+		//fibonacci hashing of the word address, the high bits of the product are the best mixed
+		return (size_t)(((pc >> 2) * 0x9E3779B1u) >> (32 - m_bits));
+	}
+
+	BP_branchStats& Find(uint32_t pc) {
+		size_t slot = Slot(pc);
+		while (0 != m_entries[slot].executions && m_entries[slot].pc != pc)
+			slot = (slot + 1) & m_mask;
+
+		if (0 == m_entries[slot].executions) {
+			m_entries[slot].pc = pc;
+			//the table is kept at most half full, so the probe sequences stay short
+			if (2 * ++m_size > m_entries.size()) {
+				Grow();
+				return Find(pc);
+			}
+		}
+		return m_entries[slot];
+	}
+
+	void Grow();
+
+	unsigned m_bits;
+	size_t m_mask;
+	size_t m_size;
+	std::vector<BP_branchStats> m_entries;
+};
+
+#endif /* BP_STATS_H_ */
@@ -0,0 +1,165 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Sweep of the two-level predictor configurations over a trace that is parsed once */
+/* Usage: ./bp_sweep <trace file (text or binary)> [threads] [unsliced] */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <map>
+
+#include "bp_api.h"
+#include "bp_trace.h"
+
+using namespace std;
+
+static const unsigned btb_sizes[] = { 2, 4, 8, 16, 32 };
+static const unsigned history_sizes[] = { 1, 2, 4, 8, 16 };
+
+struct Organization {
+	const char* name;
+	bool isGlobalHist;
+	bool isGlobalTable;
+	bool isShare;
+};
+
+static const Organization organizations[] = {
+	{ "local_history local_tables not_using_share", false, false, false },
+	{ "local_history global_tables not_using_share", false, true, false },
+	{ "local_history global_tables using_share", false, true, true },
+	{ "global_history local_tables not_using_share", true, false, false },
+	{ "global_history global_tables not_using_share", true, true, false },
+	{ "global_history global_tables using_share", true, true, true },
+};
+
+struct Job {
+	BP_config config;
+	const char* name;
+	int result;
+	BP_runStats stats;
+};
+
+//the global history global tables configurations of a BTB size are simulated together by the bit-sliced engine,
+//up to 64 configurations in a batch, all the other configurations are simulated one by one
+#define MAX_BATCH 64
+
+static void RunBatch(vector<Job>& jobs, const vector<size_t>& batch, const vector<BP_branch>& trace) {
+	if (batch.size() > 1) {
+		vector<BP_config> configs;
+		for (size_t i = 0; i < batch.size(); i++)
+			configs.push_back(jobs[batch[i]].config);
+
+		vector<BP_runStats> stats(batch.size());
+		if (0 == BP_runSliced(configs.data(), (unsigned)configs.size(), trace.data(), trace.size(), stats.data())) {
+			for (size_t i = 0; i < batch.size(); i++) {
+				jobs[batch[i]].result = 0;
+				jobs[batch[i]].stats = stats[i];
+			}
+			return;
+		}
+	}
+
+	//a single configuration, or configurations that the optional fields made unsliceable
+	for (size_t i = 0; i < batch.size(); i++) {
+		Job& job = jobs[batch[i]];
+		job.result = BP_run(&job.config, trace.data(), trace.size(), &job.stats);
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argc > 4 || (argc > 3 && strcmp(argv[3], "unsliced"))) {
+		fprintf(stderr, "Usage: %s <trace file> [threads] [unsliced]\n", argv[0]);
+		return 1;
+	}
+
+	unsigned threads = (argc > 2) ? strtoul(argv[2], NULL, 0) : thread::hardware_concurrency();
+	if (0 == threads) threads = 1;
+	const bool is_sliced = (argc <= 3);
+
+	string config_line;
+	vector<BP_branch> trace;
+	if (!ReadTrace(argv[1], &config_line, &trace)) {
+		fprintf(stderr, "Error in input file: bad trace\n");
+		return 9;
+	}
+
+	//the optional fields of the config line apply to every configuration of the sweep
+	BP_config options;
+	if (!ParseConfigLine(config_line, &options)) {
+		fprintf(stderr, "Error in input file: cannot read config\n");
+		return 10;
+	}
+
+	vector<Job> jobs;
+	for (size_t o = 0; o < sizeof(organizations) / sizeof(organizations[0]); o++) {
+		for (size_t b = 0; b < sizeof(btb_sizes) / sizeof(btb_sizes[0]); b++) {
+			for (size_t h = 0; h < sizeof(history_sizes) / sizeof(history_sizes[0]); h++) {
+				Job job;
+				job.config = options;
+				job.config.btbSize = btb_sizes[b];
+				job.config.historySize = history_sizes[h];
+				job.config.isGlobalHist = organizations[o].isGlobalHist;
+				job.config.isGlobalTable = organizations[o].isGlobalTable;
+				job.config.isShare = organizations[o].isShare;
+				job.name = organizations[o].name;
+				job.result = -1;
+				jobs.push_back(job);
+			}
+		}
+	}
+
+	vector<vector<size_t> > batches;
+	map<unsigned, size_t> open_batches;
+	for (size_t j = 0; j < jobs.size(); j++) {
+		const BP_config& config = jobs[j].config;
+		if (!is_sliced || !config.isGlobalHist || !config.isGlobalTable) {
+			batches.push_back(vector<size_t>(1, j));
+			continue;
+		}
+
+		map<unsigned, size_t>::iterator batch = open_batches.find(config.btbSize);
+		if (open_batches.end() == batch || MAX_BATCH == batches[batch->second].size()) {
+			open_batches[config.btbSize] = batches.size();
+			batches.push_back(vector<size_t>());
+		}
+		batches[open_batches[config.btbSize]].push_back(j);
+	}
+
+	//every worker runs the next batch that no other worker has taken yet
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	atomic<size_t> next_batch(0);
+	vector<thread> workers;
+	for (unsigned t = 0; t < threads; t++) {
+		workers.push_back(thread([&]() {
+			for (size_t b = next_batch++; b < batches.size(); b = next_batch++)
+				RunBatch(jobs, batches[b], trace);
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	printf("%-46s %4s %4s %9s %9s %9s %12s\n", "configuration", "btb", "hist", "accuracy", "dir_acc", "target_acc", "storage_bits");
+	for (size_t j = 0; j < jobs.size(); j++) {
+		const Job& job = jobs[j];
+		if (job.result < 0) {
+			printf("%-46s %4u %4u %9s\n", job.name, job.config.btbSize, job.config.historySize, "invalid");
+			continue;
+		}
+
+		const double branches = (0 == job.stats.branches) ? 1.0 : (double)job.stats.branches;
+		printf("%-46s %4u %4u %8.2f%% %8.2f%% %9.2f%% %12llu\n", job.name, job.config.btbSize, job.config.historySize,
+			100.0 * (1.0 - (job.stats.directionMispredictions + job.stats.targetMispredictions) / branches),
+			100.0 * (1.0 - job.stats.directionMispredictions / branches),
+			100.0 * (1.0 - job.stats.targetMispredictions / branches),
+			(unsigned long long)job.stats.storageBits);
+	}
+
+	fprintf(stderr, "%zu configurations (%zu runs) of %zu branches in %.2f seconds on %u threads\n",
+		jobs.size(), batches.size(), trace.size(), seconds, threads);
+	return 0;
+}
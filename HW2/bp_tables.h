@@ -0,0 +1,82 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* 2-bit state machines and the interface of the prediction tables */
+
+#ifndef BP_TABLES_H_
+#define BP_TABLES_H_
+
+#include "bp_state.h"
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#define SNT 0
+#define WNT 1
+#define WT 2
+#define ST 3
+
+#define PREDICTION(x) (x & 0b10) >> 1
+
+//the tables are indexed with at most MAX_TABLE_INDEX_BITS bits, longer histories are folded down to this width
+#define MAX_TABLE_INDEX_BITS 16
+#define INDEX_BITS(histSize) ((histSize) < MAX_TABLE_INDEX_BITS ? (histSize) : MAX_TABLE_INDEX_BITS)
+
+#define COUNTERS_PER_BYTE 4
+//four 2-bit state machines at 'WNT' (Weakly Not Taken)
+#define WNT_BYTE 0x55
+
+//2-bit state machines packed four per byte in a single contiguous array
+//the state machine i is at bits 2*(i%4)+1:2*(i%4) of byte i/4
+class PackedCounters
+{
+public:
+	PackedCounters(size_t count) : m_bytes((count + COUNTERS_PER_BYTE - 1) / COUNTERS_PER_BYTE, WNT_BYTE) {}
+
+	unsigned char State(size_t i) const {
+		return (m_bytes[i / COUNTERS_PER_BYTE] >> Shift(i)) & ST;
+	}
+
+	//moves the state machine one step towards the actual decision, saturating at 'SNT' and 'ST'
+	void Update(size_t i, bool actual_prediction) {
+		unsigned char& byte = m_bytes[i / COUNTERS_PER_BYTE];
+		const unsigned char state = (byte >> Shift(i)) & ST;
+		const unsigned char next_state = actual_prediction ? (state + (state != ST)) : (state - (state != SNT));
+		byte = (byte & ~(ST << Shift(i))) | (next_state << Shift(i));
+	}
+
+	//resets count bytes (4 * count state machines) starting at byte first to 'WNT'
+	void Reset(size_t first, size_t count) {
+		std::fill(m_bytes.begin() + first, m_bytes.begin() + first + count, WNT_BYTE);
+	}
+
+	size_t Bytes() const { return m_bytes.size(); }
+
+	void Transfer(StateArchive& archive) { archive.Bytes(m_bytes.data(), m_bytes.size()); }
+
+private:
+	static unsigned Shift(size_t i) { return 2 * (i % COUNTERS_PER_BYTE); }
+
+	std::vector<unsigned char> m_bytes;
+};
+
+class PredictionTable
+{
+public:
+	//the history is the (folded) history of INDEX_BITS(histSize) bits
+	PredictionTable(unsigned histSize) : m_table_tag_mask((0x1 << INDEX_BITS(histSize)) - 1) {}
+	virtual ~PredictionTable(){}
+
+	virtual bool Prediction(uint32_t history, unsigned  = 0) = 0;
+
+	virtual void Update(uint32_t history, bool actual_prediction, unsigned int = 0) = 0;
+
+	//the bits of state of the table (state machines, weights, tags and the histories it keeps itself)
+	virtual uint64_t StorageBits() const = 0;
+
+	//saves or loads the state of the table (see StateArchive)
+	virtual void Transfer(StateArchive& archive) = 0;
+
+protected:
+	unsigned int m_table_tag_mask;
+};
+
+#endif /* BP_TABLES_H_ */
@@ -0,0 +1,196 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* TAGE (TAgged GEometric history length) predictor */
+
+#include "bp_tage.h"
+#include <cmath>
+
+//the shortest history of the tagged tables (the longest is the history size of the predictor)
+#define TAGE_MIN_HISTORY 4
+//the base table has 4 times the entries of a tagged table
+#define TAGE_BASE_EXTRA_BITS 2
+//the useful counters of all the entries are halved every TAGE_USEFUL_RESET_PERIOD updates
+#define TAGE_USEFUL_RESET_PERIOD (1 << 18)
+
+#define TAGE_COUNTER_MAX 3
+#define TAGE_COUNTER_MIN -4
+#define TAGE_USEFUL_MAX 3
+#define TAGE_USE_ALTERNATE_MAX 7
+#define TAGE_USE_ALTERNATE_MIN -8
+
+//the history lengths of the tables form a geometric series from TAGE_MIN_HISTORY to historySize
+static unsigned HistoryLength(unsigned historySize, unsigned tables, unsigned table) {
+	const unsigned min_length = (historySize < TAGE_MIN_HISTORY) ? historySize : TAGE_MIN_HISTORY;
+	if (1 == tables) return historySize;
+
+	const double ratio = pow((double)historySize / min_length, (double)table / (tables - 1));
+	return (unsigned)(min_length * ratio + 0.5);
+}
+
+TageTable::TageTable(unsigned historySize, unsigned tables, unsigned indexBits, unsigned tagBits) :
+	PredictionTable(historySize), m_history_size(historySize), m_tables(tables), m_index_bits(indexBits), m_tag_bits(tagBits),
+	m_index_mask((0x1 << indexBits) - 1), m_tag_mask((0x1 << tagBits) - 1),
+	m_base_mask((0x1 << (indexBits + TAGE_BASE_EXTRA_BITS)) - 1),
+	m_base((size_t)m_base_mask + 1), m_history(historySize),
+	m_use_alternate(0), m_updates(0), m_random_state(2463534242u) {
+
+	//new entries are weakly not taken, with the tag 0 and not useful
+	Entry empty = { -1, 0, 0 };
+	m_entries.assign((size_t)tables << indexBits, empty);
+
+	for (unsigned i = 0; i < tables; i++) {
+		const unsigned length = HistoryLength(historySize, tables, i);
+		m_index_folds.push_back(FoldedHistory(length, indexBits));
+		m_tag_folds.push_back(FoldedHistory(length, tagBits));
+		m_tag_folds_shifted.push_back(FoldedHistory(length, tagBits - 1));
+	}
+}
+
+uint64_t TageTable::StorageBits() const {
+	//a tagged entry is a 3-bit counter, a 2-bit useful counter and a tag, the use-alternate counter has 4 bits
+	return ((uint64_t)m_base_mask + 1) * 2 + (uint64_t)m_entries.size() * (3 + 2 + m_tag_bits) + m_history_size + 4;
+}
+
+void TageTable::Transfer(StateArchive& archive) {
+	m_base.Transfer(archive);
+
+	archive.Expect(m_entries.size());
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		archive.Value(m_entries[i].counter);
+		archive.Value(m_entries[i].useful);
+		archive.Value(m_entries[i].tag);
+		archive.Check(TAGE_COUNTER_MIN <= m_entries[i].counter && TAGE_COUNTER_MAX >= m_entries[i].counter);
+		archive.Check(TAGE_USEFUL_MAX >= m_entries[i].useful);
+		archive.Check(m_tag_mask >= m_entries[i].tag);
+	}
+
+	m_history.Transfer(archive);
+	for (unsigned i = 0; i < m_tables; i++) {
+		m_index_folds[i].Transfer(archive);
+		m_tag_folds[i].Transfer(archive);
+		m_tag_folds_shifted[i].Transfer(archive);
+	}
+
+	archive.Value(m_use_alternate);
+	archive.Check(TAGE_USE_ALTERNATE_MIN <= m_use_alternate && TAGE_USE_ALTERNATE_MAX >= m_use_alternate);
+	archive.Value(m_updates);
+	archive.Value(m_random_state);
+}
+
+bool TageTable::Prediction(uint32_t, unsigned pc) {
+	Match match;
+	Find(pc, match);
+	return match.prediction;
+}
+
+void TageTable::Update(uint32_t, bool actual_prediction, unsigned int pc) {
+	Match match;
+	Find(pc, match);
+
+	//allocate an entry in a longer history table on a misprediction
+	//one of the first two candidates is skipped at random so that two branches do not keep evicting each other
+	if (match.prediction != actual_prediction && match.provider + 1 < (int)m_tables) {
+		int first = match.provider + 1;
+		if (first + 1 < (int)m_tables && (Random() & 0x1)) first++;
+
+		bool is_allocated = false;
+		for (int i = first; i < (int)m_tables && !is_allocated; i++) {
+			Entry& entry = At(i, match.indices[i]);
+			if (0 != entry.useful) continue;
+
+			entry.counter = actual_prediction ? 0 : -1;
+			entry.tag = match.tags[i];
+			is_allocated = true;
+		}
+
+		//no entry could be allocated, age the candidates
+		for (int i = match.provider + 1; i < (int)m_tables && !is_allocated; i++) {
+			Entry& entry = At(i, match.indices[i]);
+			if (entry.useful > 0) entry.useful--;
+		}
+	}
+
+	if (match.provider >= 0) {
+		Entry& entry = At(match.provider, match.indices[match.provider]);
+
+		//learn whether a new entry or the alternate prediction is more accurate
+		const bool is_weak = (0 == entry.counter || -1 == entry.counter);
+		if (is_weak && 0 == entry.useful && match.provider_prediction != match.alternate_prediction) {
+			if (match.alternate_prediction == actual_prediction)
+				m_use_alternate += (m_use_alternate < TAGE_USE_ALTERNATE_MAX);
+			else
+				m_use_alternate -= (m_use_alternate > TAGE_USE_ALTERNATE_MIN);
+		}
+
+		if (match.provider_prediction != match.alternate_prediction) {
+			if (match.provider_prediction == actual_prediction)
+				entry.useful += (entry.useful < TAGE_USEFUL_MAX);
+			else
+				entry.useful -= (entry.useful > 0);
+		}
+
+		if (actual_prediction)
+			entry.counter += (entry.counter < TAGE_COUNTER_MAX);
+		else
+			entry.counter -= (entry.counter > TAGE_COUNTER_MIN);
+	}
+	else {
+		m_base.Update((pc >> 2) & m_base_mask, actual_prediction);
+	}
+
+	//graceful aging of the useful counters, so that stale entries can be replaced
+	if (0 == (++m_updates % TAGE_USEFUL_RESET_PERIOD)) {
+		for (size_t i = 0; i < m_entries.size(); i++)
+			m_entries[i].useful >>= 1;
+	}
+
+	m_history.Push(actual_prediction);
+	for (unsigned i = 0; i < m_tables; i++) {
+		m_index_folds[i].Update(m_history);
+		m_tag_folds[i].Update(m_history);
+		m_tag_folds_shifted[i].Update(m_history);
+	}
+
+	return;
+}
+
+void TageTable::Find(unsigned pc, Match& match) const {
+	const uint32_t pc_index = pc >> 2;
+
+	match.provider = -1;
+	match.alternate = -1;
+	for (int i = (int)m_tables - 1; i >= 0; i--) {
+		match.indices[i] = (pc_index ^ (pc_index >> m_index_bits) ^ m_index_folds[i].Value()) & m_index_mask;
+		match.tags[i] = (pc_index ^ m_tag_folds[i].Value() ^ (m_tag_folds_shifted[i].Value() << 1)) & m_tag_mask;
+
+		if (At(i, match.indices[i]).tag != match.tags[i]) continue;
+		if (match.provider < 0)			match.provider = i;
+		else if (match.alternate < 0)	match.alternate = i;
+	}
+
+	match.alternate_prediction = (match.alternate >= 0) ?
+		(At(match.alternate, match.indices[match.alternate]).counter >= 0) : BasePrediction(pc);
+
+	if (match.provider < 0) {
+		match.provider_prediction = match.alternate_prediction;
+		match.prediction = match.alternate_prediction;
+		return;
+	}
+
+	const Entry& entry = At(match.provider, match.indices[match.provider]);
+	match.provider_prediction = (entry.counter >= 0);
+
+	const bool is_new = (0 == entry.counter || -1 == entry.counter) && 0 == entry.useful;
+	match.prediction = (is_new && m_use_alternate >= 0) ? match.alternate_prediction : match.provider_prediction;
+	return;
+}
+
+bool TageTable::BasePrediction(unsigned pc) const {
+	return (PREDICTION(m_base.State((pc >> 2) & m_base_mask))) ? true : false;
+}
+
+uint32_t TageTable::Random() {
+	m_random_state ^= m_random_state << 13;
+	m_random_state ^= m_random_state >> 17;
+	m_random_state ^= m_random_state << 5;
+	return m_random_state;
+}
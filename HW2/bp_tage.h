@@ -0,0 +1,82 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* TAGE (TAgged GEometric history length) predictor */
+
+#ifndef BP_TAGE_H_
+#define BP_TAGE_H_
+
+#include "bp_api.h"
+#include "bp_history.h"
+#include "bp_tables.h"
+
+//TAGE keeps its own global history, the history given by the BTB is ignored
+//
+//the prediction is made by the tagged table with the longest history whose entry tag matches the branch (the provider),
+//or by the bimodal base table when no tagged entry matches
+//a newly allocated (weak and not useful) provider entry defers to the alternate prediction
+//(the next matching table, or the base table) while this has been more accurate
+//on a misprediction an entry is allocated in a table with a longer history than the provider
+class TageTable : public PredictionTable
+{
+public:
+	TageTable(unsigned historySize, unsigned tables, unsigned indexBits, unsigned tagBits);
+	virtual ~TageTable() {}
+
+	virtual bool Prediction(uint32_t history, unsigned pc = 0);
+
+	virtual void Update(uint32_t history, bool actual_prediction, unsigned int pc = 0);
+
+	virtual uint64_t StorageBits() const;
+
+	virtual void Transfer(StateArchive& archive);
+
+private:
+	struct Entry {
+		int8_t counter;		//3-bit signed counter, predicts taken when non negative
+		uint8_t useful;		//2-bit useful counter
+		uint16_t tag;
+	};
+
+	//the tagged entries of a branch and the predictions they make
+	struct Match {
+		int provider;		//the longest matching table, -1 for the base table
+		int alternate;		//the next matching table, -1 for the base table
+		bool provider_prediction;
+		bool alternate_prediction;
+		bool prediction;
+		uint32_t indices[BP_TAGE_MAX_TABLES];
+		uint16_t tags[BP_TAGE_MAX_TABLES];
+	};
+
+	void Find(unsigned pc, Match& match) const;
+
+	Entry& At(int table, uint32_t index) { return m_entries[((size_t)table << m_index_bits) + index]; }
+	const Entry& At(int table, uint32_t index) const { return m_entries[((size_t)table << m_index_bits) + index]; }
+
+	bool BasePrediction(unsigned pc) const;
+
+	uint32_t Random();
+
+	const unsigned m_history_size;
+	const unsigned m_tables;
+	const unsigned m_index_bits;
+	const unsigned m_tag_bits;
+	const uint32_t m_index_mask;
+	const uint32_t m_tag_mask;
+	const uint32_t m_base_mask;
+
+	PackedCounters m_base;
+	std::vector<Entry> m_entries;
+
+	//the global history and, for every tagged table, its history folded to the index width and (twice) to the tag width
+	HistoryBuffer m_history;
+	std::vector<FoldedHistory> m_index_folds;
+	std::vector<FoldedHistory> m_tag_folds;
+	std::vector<FoldedHistory> m_tag_folds_shifted;
+
+	//4-bit signed counter, the alternate prediction is used for weak new entries when non negative
+	int m_use_alternate;
+	uint32_t m_updates;
+	uint32_t m_random_state;
+};
+
+#endif /* BP_TAGE_H_ */
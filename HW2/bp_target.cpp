@@ -0,0 +1,102 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Target prediction of returns (return address stack) and of indirect branches (target cache) */
+
+#include "bp_target.h"
+
+//every indirect target shifts the path history by this many bits
+#define PATH_SHIFT 2
+
+TargetPredictor::TargetPredictor(unsigned rasEntries, unsigned indirectIndexBits) :
+	m_ras(rasEntries, 0), m_ras_top(0), m_ras_count(0),
+	m_index_mask((0x1 << indirectIndexBits) - 1), m_path(0) {
+	if (indirectIndexBits > 0) {
+		Entry empty = { 0, 0 };
+		m_targets.assign((size_t)1 << indirectIndexBits, empty);
+	}
+}
+
+void TargetPredictor::Predict(uint32_t pc, BP_branchType type, uint32_t* dst) const {
+	if (BP_BRANCH_RET == type && m_ras_count > 0) {
+		*dst = m_ras[m_ras_top];
+		return;
+	}
+
+	if (BP_BRANCH_INDIRECT == type && !m_targets.empty()) {
+		const Entry& entry = m_targets[Index(pc, m_path)];
+		if (entry.pc == pc) *dst = entry.target;
+	}
+
+	return;
+}
+
+void TargetPredictor::Update(uint32_t pc, BP_branchType type, uint32_t targetPc) {
+	Train(pc, type, targetPc, m_path);
+	Speculate(pc, type, targetPc);
+}
+
+void TargetPredictor::Save(Checkpoint* checkpoint) const {
+	checkpoint->ras_top = m_ras_top;
+	checkpoint->ras_count = m_ras_count;
+	checkpoint->ras_next = m_ras.empty() ? 0 : m_ras[(m_ras_top + 1) % m_ras.size()];
+	checkpoint->path = m_path;
+}
+
+void TargetPredictor::Restore(const Checkpoint& checkpoint) {
+	m_ras_top = checkpoint.ras_top;
+	m_ras_count = checkpoint.ras_count;
+	if (!m_ras.empty()) m_ras[(m_ras_top + 1) % m_ras.size()] = checkpoint.ras_next;
+	m_path = checkpoint.path;
+}
+
+void TargetPredictor::Speculate(uint32_t pc, BP_branchType type, uint32_t targetPc) {
+	switch (type)
+	{
+	case BP_BRANCH_CALL:
+		if (m_ras.empty()) break;
+
+		m_ras_top = (m_ras_top + 1) % m_ras.size();
+		m_ras[m_ras_top] = pc + 4;
+		if (m_ras_count < m_ras.size()) m_ras_count++;
+		break;
+	case BP_BRANCH_RET:
+		if (0 == m_ras_count) break;
+
+		m_ras_top = (m_ras_top + m_ras.size() - 1) % m_ras.size();
+		m_ras_count--;
+		break;
+	case BP_BRANCH_INDIRECT:
+		if (m_targets.empty()) break;
+
+		m_path = ((m_path << PATH_SHIFT) ^ (targetPc >> 2)) & m_index_mask;
+		break;
+	default:
+		break;
+	}
+
+	return;
+}
+
+void TargetPredictor::Train(uint32_t pc, BP_branchType type, uint32_t targetPc, uint32_t path) {
+	if (BP_BRANCH_INDIRECT != type || m_targets.empty())
+		return;
+
+	m_targets[Index(pc, path)].pc = pc;
+	m_targets[Index(pc, path)].target = targetPc;
+}
+
+void TargetPredictor::Transfer(StateArchive& archive) {
+	archive.Expect(m_ras.size());
+	for (size_t i = 0; i < m_ras.size(); i++)
+		archive.Value(m_ras[i]);
+	archive.Value(m_ras_top);
+	archive.Value(m_ras_count);
+	archive.Check((m_ras.empty() ? 0 == m_ras_top : m_ras_top < m_ras.size()) && m_ras_count <= m_ras.size());
+
+	archive.Expect(m_targets.size());
+	for (size_t i = 0; i < m_targets.size(); i++) {
+		archive.Value(m_targets[i].pc);
+		archive.Value(m_targets[i].target);
+	}
+	archive.Value(m_path);
+	archive.Check(m_path <= m_index_mask);
+}
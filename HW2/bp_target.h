@@ -0,0 +1,62 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Target prediction of returns (return address stack) and of indirect branches (target cache) */
+
+#ifndef BP_TARGET_H_
+#define BP_TARGET_H_
+
+#include "bp_api.h"
+#include "bp_state.h"
+#include <vector>
+
+//the BTB holds a single target per branch, which is enough for direct branches only
+//the return address stack predicts the target of a return by the address following the matching call
+//the target cache predicts the target of an indirect branch by its pc and the path of the last indirect targets
+class TargetPredictor
+{
+public:
+	//the return address stack and the path history before the speculative update of a branch
+	struct Checkpoint {
+		unsigned ras_top;
+		unsigned ras_count;
+		uint32_t ras_next;		//the entry that a call overwrites
+		uint32_t path;
+	};
+
+	//rasEntries 0 disables the return address stack, indirectIndexBits 0 disables the target cache
+	TargetPredictor(unsigned rasEntries, unsigned indirectIndexBits);
+	~TargetPredictor() {}
+
+	//overrides the target given by the BTB (dst) for returns and indirect branches, when it has a target for them
+	void Predict(uint32_t pc, BP_branchType type, uint32_t* dst) const;
+
+	void Update(uint32_t pc, BP_branchType type, uint32_t targetPc);
+
+	//the delayed update mode: the return address stack and the path history follow the predictions (Speculate),
+	//the target cache is written when the branch is resolved (Train), with the path that indexed its prediction
+	void Save(Checkpoint* checkpoint) const;
+	void Restore(const Checkpoint& checkpoint);
+	void Speculate(uint32_t pc, BP_branchType type, uint32_t targetPc);
+	void Train(uint32_t pc, BP_branchType type, uint32_t targetPc, uint32_t path);
+
+	//saves or loads the return address stack and the target cache (see StateArchive)
+	void Transfer(StateArchive& archive);
+
+private:
+	struct Entry {
+		uint32_t pc;
+		uint32_t target;
+	};
+
+	size_t Index(uint32_t pc, uint32_t path) const { return ((pc >> 2) ^ path) & m_index_mask; }
+
+	//circular stack, a call that overflows it overwrites the oldest return address
+	std::vector<uint32_t> m_ras;
+	unsigned m_ras_top;
+	unsigned m_ras_count;
+
+	std::vector<Entry> m_targets;
+	const uint32_t m_index_mask;
+	uint32_t m_path;
+};
+
+#endif /* BP_TARGET_H_ */
@@ -0,0 +1,419 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Compact binary branch traces: delta encoded pcs and targets, packed taken bits, and the text trace reader */
+
+#include "bp_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+//the writer writes and the reader refills its buffer in chunks of this size
+#define TRACE_BUFFER_SIZE (1 << 20)
+#define TRACE_MAX_CONFIG 4096
+#define TRACE_MAX_LINE 1024
+
+static inline uint32_t ZigZag(uint32_t delta) {
+	return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+static inline uint32_t UnZigZag(uint32_t value) {
+	return (value >> 1) ^ (0 - (value & 0x1));
+}
+
+static inline void PutVarint(std::vector<uint8_t>& buffer, uint32_t value) {
+	while (value >= 0x80) {
+		buffer.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((uint8_t)value);
+}
+
+//false when the varint runs past the end of the data, or is longer than 5 bytes
+static inline bool GetVarint(const uint8_t*& p, const uint8_t* end, uint32_t* value) {
+	uint32_t result = 0;
+	for (unsigned shift = 0; shift < 35 && p < end; shift += 7) {
+		const uint8_t byte = *p++;
+		result |= (uint32_t)(byte & 0x7F) << shift;
+		if (0 == (byte & 0x80)) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline void PutFixed(std::vector<uint8_t>& buffer, uint64_t value, unsigned bytes) {
+	for (unsigned i = 0; i < bytes; i++)
+		buffer.push_back((uint8_t)(value >> (8 * i)));
+}
+
+static inline uint64_t GetFixed(const uint8_t* p, unsigned bytes) {
+	uint64_t value = 0;
+	for (unsigned i = 0; i < bytes; i++)
+		value |= (uint64_t)p[i] << (8 * i);
+	return value;
+}
+
+
+bool TraceWriter::Open(const char* path, const std::string& config) {
+	m_file = fopen(path, "wb");
+	if (NULL == m_file)
+		return false;
+
+	m_count = 0;
+	m_previous_pc = 0;
+	m_offset = 0;
+	m_blocks = 0;
+	m_branches = 0;
+	m_seek_points.clear();
+	m_buffer.clear();
+	m_buffer.reserve(TRACE_BUFFER_SIZE + TRACE_MAX_BLOCK_BYTES);
+	for (unsigned i = 0; i < 4; i++)
+		m_buffer.push_back(TRACE_MAGIC[i]);
+	m_buffer.push_back(TRACE_VERSION);
+	PutVarint(m_buffer, (uint32_t)config.size());
+	m_buffer.insert(m_buffer.end(), config.begin(), config.end());
+	return true;
+}
+
+bool TraceWriter::WriteBlock() {
+	if (0 == m_blocks % TRACE_SEEK_BLOCKS) {
+		const TraceSeekPoint point = { m_offset + m_buffer.size(), m_previous_pc };
+		m_seek_points.push_back(point);
+	}
+	m_blocks++;
+	m_branches += m_count;
+
+	PutVarint(m_buffer, m_count);
+
+	uint8_t flags = 0;
+	for (unsigned i = 0; i < m_count; i++)
+		if (BP_BRANCH_COND != m_block[i].type) flags |= TRACE_FLAG_TYPES;
+	m_buffer.push_back(flags);
+
+	for (unsigned i = 0; i < m_count; i += 8) {
+		uint8_t taken = 0;
+		for (unsigned j = i; j < i + 8 && j < m_count; j++)
+			taken |= (uint8_t)m_block[j].taken << (j - i);
+		m_buffer.push_back(taken);
+	}
+
+	if (flags & TRACE_FLAG_TYPES) {
+		for (unsigned i = 0; i < m_count; i += 2) {
+			const uint8_t high = (i + 1 < m_count) ? (uint8_t)m_block[i + 1].type : 0;
+			m_buffer.push_back((uint8_t)((high << 4) | m_block[i].type));
+		}
+	}
+
+	for (unsigned i = 0; i < m_count; i++) {
+		PutVarint(m_buffer, ZigZag(m_block[i].pc - m_previous_pc));
+		PutVarint(m_buffer, ZigZag(m_block[i].targetPc - m_block[i].pc));
+		m_previous_pc = m_block[i].pc;
+	}
+	m_count = 0;
+
+	if (m_buffer.size() >= TRACE_BUFFER_SIZE) {
+		const bool is_written = (m_buffer.size() == fwrite(m_buffer.data(), 1, m_buffer.size(), m_file));
+		m_offset += m_buffer.size();
+		m_buffer.clear();
+		return is_written;
+	}
+	return true;
+}
+
+bool TraceWriter::Close() {
+	if (NULL == m_file)
+		return true;
+
+	bool is_written = (0 == m_count) || WriteBlock();
+	PutVarint(m_buffer, 0);
+
+	const uint64_t seek_table = m_offset + m_buffer.size();
+	for (size_t i = 0; i < m_seek_points.size(); i++) {
+		PutFixed(m_buffer, m_seek_points[i].offset, 8);
+		PutFixed(m_buffer, m_seek_points[i].previous_pc, 4);
+	}
+	PutFixed(m_buffer, m_branches, 8);
+	PutFixed(m_buffer, seek_table, 8);
+	is_written = (m_buffer.size() == fwrite(m_buffer.data(), 1, m_buffer.size(), m_file)) && is_written;
+	is_written = (0 == fclose(m_file)) && is_written;
+	m_file = NULL;
+	m_buffer.clear();
+	m_seek_points.clear();
+	return is_written;
+}
+
+
+TraceReader::~TraceReader() {
+	if (NULL != m_file) fclose(m_file);
+}
+
+//at least bytes bytes in the buffer (less at the end of the file)
+bool TraceReader::Fill(size_t bytes) {
+	if (m_end - m_begin >= bytes)
+		return true;
+
+	if (!m_is_eof) {
+		memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+		m_end -= m_begin;
+		m_begin = 0;
+		m_end += fread(m_buffer.data() + m_end, 1, m_buffer.size() - m_end, m_file);
+		m_is_eof = feof(m_file) || ferror(m_file);
+	}
+	return m_end - m_begin >= bytes;
+}
+
+bool TraceReader::Open(const char* path) {
+	m_file = fopen(path, "rb");
+	if (NULL == m_file)
+		return false;
+	m_buffer.resize(TRACE_BUFFER_SIZE);
+
+	//version 1 is the same trace without the seek table
+	if (!Fill(5) || 0 != memcmp(m_buffer.data(), TRACE_MAGIC, 4) || (1 != m_buffer[4] && TRACE_VERSION != m_buffer[4]))
+		return false;
+	if (TRACE_VERSION == m_buffer[4] && !ReadSeekTable())
+		return false;
+	m_begin = 5;
+
+	Fill(5 + TRACE_MAX_CONFIG);
+	const uint8_t* p = m_buffer.data() + m_begin;
+	const uint8_t* end = m_buffer.data() + m_end;
+	uint32_t length;
+	if (!GetVarint(p, end, &length) || length > TRACE_MAX_CONFIG || (size_t)(end - p) < length)
+		return false;
+
+	m_config.assign((const char*)p, length);
+	m_begin = (p + length) - m_buffer.data();
+	return true;
+}
+
+//reads the trailer, and checks that the seek table of its number of branches fills the end of the file
+bool TraceReader::ReadSeekTable() {
+	const off_t position = ftello(m_file);
+	uint8_t trailer[TRACE_TRAILER_BYTES];
+	if (0 != fseeko(m_file, -TRACE_TRAILER_BYTES, SEEK_END) || 1 != fread(trailer, TRACE_TRAILER_BYTES, 1, m_file))
+		return false;
+	const off_t size = ftello(m_file);
+
+	m_branches = GetFixed(trailer, 8);
+	m_seek_table = GetFixed(trailer + 8, 8);
+	const uint64_t blocks = (m_branches + TRACE_BLOCK_SIZE - 1) / TRACE_BLOCK_SIZE;
+	const uint64_t points = (blocks + TRACE_SEEK_BLOCKS - 1) / TRACE_SEEK_BLOCKS;
+	if (0 == m_seek_table || m_seek_table + points * TRACE_SEEK_POINT_BYTES + TRACE_TRAILER_BYTES != (uint64_t)size) {
+		m_seek_table = 0;
+		return false;
+	}
+
+	return 0 == fseeko(m_file, position, SEEK_SET);
+}
+
+bool TraceReader::Seek(uint64_t branch) {
+	if (!CanSeek() || m_is_broken || branch > m_branches)
+		return false;
+
+	//the trace of no branches has no seek point
+	m_count = m_next = 0;
+	m_is_done = (0 == m_branches);
+	if (m_is_done)
+		return true;
+
+	//the seek point of the last blocks holds the end of the trace too
+	const uint64_t seek_branches = (uint64_t)TRACE_SEEK_BLOCKS * TRACE_BLOCK_SIZE;
+	const uint64_t points = ((m_branches + TRACE_BLOCK_SIZE - 1) / TRACE_BLOCK_SIZE + TRACE_SEEK_BLOCKS - 1) / TRACE_SEEK_BLOCKS;
+	const uint64_t point = (branch / seek_branches < points) ? branch / seek_branches : points - 1;
+
+	uint8_t entry[TRACE_SEEK_POINT_BYTES];
+	if (0 != fseeko(m_file, (off_t)(m_seek_table + point * TRACE_SEEK_POINT_BYTES), SEEK_SET) ||
+		1 != fread(entry, TRACE_SEEK_POINT_BYTES, 1, m_file) ||
+		0 != fseeko(m_file, (off_t)GetFixed(entry, 8), SEEK_SET)) {
+		m_is_broken = true;
+		return false;
+	}
+
+	m_previous_pc = (uint32_t)GetFixed(entry + 8, 4);
+	m_begin = m_end = 0;
+	m_is_eof = false;
+
+	//the branches from the seek point to the branch are decoded and dropped
+	BP_branch skipped;
+	for (uint64_t i = point * seek_branches; i < branch; i++) {
+		if (!Next(&skipped)) {
+			m_is_broken = true;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool TraceReader::ReadBlock() {
+	if (m_is_done || m_is_broken)
+		return false;
+
+	Fill(TRACE_MAX_BLOCK_BYTES);
+	const uint8_t* p = m_buffer.data() + m_begin;
+	const uint8_t* end = m_buffer.data() + m_end;
+
+	uint32_t count;
+	if (!GetVarint(p, end, &count) || count > TRACE_BLOCK_SIZE) {
+		m_is_broken = true;
+		return false;
+	}
+	if (0 == count) {
+		m_is_done = true;
+		return false;
+	}
+
+	const size_t taken_bytes = (count + 7) / 8;
+	if ((size_t)(end - p) < 1 + taken_bytes) {
+		m_is_broken = true;
+		return false;
+	}
+	const uint8_t flags = *p++;
+	const uint8_t* taken = p;
+	p += taken_bytes;
+
+	const uint8_t* types = NULL;
+	if (flags & TRACE_FLAG_TYPES) {
+		const size_t type_bytes = (count + 1) / 2;
+		if ((size_t)(end - p) < type_bytes) {
+			m_is_broken = true;
+			return false;
+		}
+		types = p;
+		p += type_bytes;
+	}
+
+	for (unsigned i = 0; i < count; i++) {
+		BP_branch& branch = m_block[i];
+		uint32_t pc_delta, target_delta;
+		if (!GetVarint(p, end, &pc_delta) || !GetVarint(p, end, &target_delta)) {
+			m_is_broken = true;
+			return false;
+		}
+
+		branch.pc = m_previous_pc + UnZigZag(pc_delta);
+		branch.targetPc = branch.pc + UnZigZag(target_delta);
+		branch.taken = (taken[i / 8] >> (i % 8)) & 0x1;
+		branch.type = BP_BRANCH_COND;
+		if (NULL != types) {
+			const unsigned type = (types[i / 2] >> (4 * (i % 2))) & 0xF;
+			if (type >= BP_BRANCH_TYPES) {
+				m_is_broken = true;
+				return false;
+			}
+			branch.type = (BP_branchType)type;
+		}
+		m_previous_pc = branch.pc;
+	}
+
+	m_begin = p - m_buffer.data();
+	m_count = count;
+	m_next = 0;
+	return true;
+}
+
+
+TextTraceReader::~TextTraceReader() {
+	if (NULL != m_file) fclose(m_file);
+}
+
+bool TextTraceReader::Open(const char* path) {
+	m_file = fopen(path, "r");
+	if (NULL == m_file)
+		return false;
+
+	char line[TRACE_MAX_LINE];
+	if (NULL == fgets(line, TRACE_MAX_LINE, m_file)) {
+		m_is_broken = true;
+		return true;
+	}
+
+	m_config = line;
+	while (!m_config.empty() && ('\n' == m_config[m_config.size() - 1] || '\r' == m_config[m_config.size() - 1]))
+		m_config.erase(m_config.size() - 1);
+	return true;
+}
+
+bool TextTraceReader::Next(BP_branch* branch) {
+	char line[TRACE_MAX_LINE];
+	if (m_is_broken || NULL == fgets(line, TRACE_MAX_LINE, m_file) || '\n' == line[0])
+		return false;
+
+	char* pc = strtok(line, " \r\n");
+	char* taken = strtok(NULL, " \r\n");
+	char* target = strtok(NULL, " \r\n");
+	char* type = strtok(NULL, " \r\n");
+	if (NULL == pc || NULL == taken || NULL == target || (strcmp(taken, "T") && strcmp(taken, "N"))) {
+		m_is_broken = true;
+		return false;
+	}
+
+	branch->pc = strtoul(pc, NULL, 0);
+	branch->targetPc = strtoul(target, NULL, 0);
+	branch->taken = ('T' == taken[0]);
+	branch->type = BP_BRANCH_COND;
+	if (NULL != type && BP_parseBranchType(type, &branch->type) < 0) {
+		m_is_broken = true;
+		return false;
+	}
+
+	return true;
+}
+
+bool ParseConfigLine(const std::string& line, BP_config* config) {
+	std::vector<char> fields(line.begin(), line.end());
+	fields.push_back('\0');
+
+	char* elements[5];
+	elements[0] = strtok(fields.data(), " \r\n");
+	for (int i = 1; i < 5; i++)
+		elements[i] = strtok(NULL, " \r\n");
+	for (int i = 0; i < 5; i++)
+		if (NULL == elements[i]) return false;
+
+	const unsigned btbSize = strtoul(elements[0], NULL, 0);
+	const unsigned historySize = strtoul(elements[1], NULL, 0);
+	if (0 == btbSize || 0 == historySize)
+		return false;
+
+	bool isGlobalHist, isGlobalTable, isShare;
+	if (0 == strcmp(elements[2], "local_history")) isGlobalHist = false;
+	else if (0 == strcmp(elements[2], "global_history")) isGlobalHist = true;
+	else return false;
+
+	if (0 == strcmp(elements[3], "local_tables")) isGlobalTable = false;
+	else if (0 == strcmp(elements[3], "global_tables")) isGlobalTable = true;
+	else return false;
+
+	if (0 == strcmp(elements[4], "using_share")) isShare = true;
+	else if (0 == strcmp(elements[4], "not_using_share")) isShare = false;
+	else return false;
+
+	BP_defaultConfig(config, btbSize, historySize, isGlobalHist, isGlobalTable, isShare);
+
+	//optional fields: the predictor engine and its parameters
+	for (char* option = strtok(NULL, " \r\n"); NULL != option; option = strtok(NULL, " \r\n"))
+		if (BP_parseOption(config, option) < 0) return false;
+	return true;
+}
+
+bool ReadTrace(const char* path, std::string* config, std::vector<BP_branch>* trace) {
+	BP_branch branch;
+	TraceReader binary;
+	if (binary.Open(path)) {
+		*config = binary.Config();
+		while (binary.Next(&branch))
+			trace->push_back(branch);
+		return !binary.IsBroken();
+	}
+
+	TextTraceReader text;
+	if (!text.Open(path))
+		return false;
+
+	*config = text.Config();
+	while (text.Next(&branch))
+		trace->push_back(branch);
+	return !text.IsBroken();
+}
@@ -0,0 +1,161 @@
+/* 046267 Computer Architecture - Spring 2016 - HW #2 */
+/* Compact binary branch traces: delta encoded pcs and targets, packed taken bits, and the text trace reader */
+
+#ifndef BP_TRACE_H_
+#define BP_TRACE_H_
+
+#include "bp_api.h"
+#include <string>
+#include <vector>
+
+//the format of a binary trace (all the numbers are LEB128 varints):
+//  header: the magic "BPTR", a version byte, the length of the config line and the config line (as in the text trace)
+//  blocks of 1 to TRACE_BLOCK_SIZE branches:
+//    the number of branches, a flags byte (TRACE_FLAG_TYPES: the block has branches that are not conditional),
+//    the taken bits (bit i%8 of byte i/8 is branch i), with TRACE_FLAG_TYPES the types (a nibble per branch),
+//    then for every branch the zigzag encoded pc - previous pc and targetPc - pc
+//  a block of 0 branches ends the trace
+//  the seek table (version 2, the blocks are read without it), fixed size little endian numbers:
+//    a seek point for every TRACE_SEEK_BLOCKS blocks (all the blocks but the last hold TRACE_BLOCK_SIZE branches):
+//    the file offset of the block (8 bytes) and the pc of the branch before it (4 bytes, 0 for the first block)
+//    then the number of branches (8 bytes) and the file offset of the seek table (8 bytes)
+//the branches of a loop or of a near target cost 2 bytes, against about 25 bytes of a text line
+#define TRACE_MAGIC "BPTR"
+#define TRACE_VERSION 2
+#define TRACE_BLOCK_SIZE 64
+#define TRACE_FLAG_TYPES 0x1
+#define TRACE_SEEK_BLOCKS 64
+#define TRACE_SEEK_POINT_BYTES 12
+#define TRACE_TRAILER_BYTES 16
+
+//the longest encoded block: count, flags, taken bits, types and two 5 byte varints per branch
+#define TRACE_MAX_BLOCK_BYTES (5 + 1 + TRACE_BLOCK_SIZE / 8 + TRACE_BLOCK_SIZE / 2 + TRACE_BLOCK_SIZE * 10)
+
+//where the decoding of a block can start: the block and the pc that its first pc delta is taken from
+struct TraceSeekPoint {
+	uint64_t offset;
+	uint32_t previous_pc;
+};
+
+class TraceWriter
+{
+public:
+	TraceWriter() : m_file(NULL), m_count(0), m_previous_pc(0), m_offset(0), m_blocks(0), m_branches(0) {}
+	~TraceWriter() { Close(); }
+
+	//creates the file and writes the header, config is the config line of the text trace
+	bool Open(const char* path, const std::string& config);
+
+	bool Write(const BP_branch& branch) {
+		m_block[m_count++] = branch;
+		return (TRACE_BLOCK_SIZE == m_count) ? WriteBlock() : true;
+	}
+
+	//writes the last block and the end of the trace, and closes the file
+	bool Close();
+
+private:
+	bool WriteBlock();
+
+	FILE* m_file;
+	BP_branch m_block[TRACE_BLOCK_SIZE];
+	unsigned m_count;
+	uint32_t m_previous_pc;
+	std::vector<uint8_t> m_buffer;
+
+	//the bytes written to the file before the buffer
+	uint64_t m_offset;
+	uint64_t m_blocks;
+	uint64_t m_branches;
+	std::vector<TraceSeekPoint> m_seek_points;
+};
+
+//reads a binary trace block by block through a fixed size buffer, so traces of any length are streamed
+class TraceReader
+{
+public:
+	TraceReader() : m_file(NULL), m_begin(0), m_end(0), m_is_eof(false), m_is_broken(false), m_is_done(false),
+		m_count(0), m_next(0), m_previous_pc(0), m_branches(0), m_seek_table(0) {}
+	~TraceReader();
+
+	//opens the file and reads the header, false when the file cannot be read or is not a binary trace
+	bool Open(const char* path);
+
+	const std::string& Config() const { return m_config; }
+
+	//the next branch, false at the end of the trace or when the file is broken (see IsBroken)
+	bool Next(BP_branch* branch) {
+		if (m_next == m_count && !ReadBlock())
+			return false;
+		*branch = m_block[m_next++];
+		return true;
+	}
+
+	//the file is truncated or corrupted
+	bool IsBroken() const { return m_is_broken; }
+
+	//the trace has a seek table (a trace of version 1 is read from the start only)
+	bool CanSeek() const { return 0 != m_seek_table; }
+
+	//the number of branches of a trace that can seek
+	uint64_t Branches() const { return m_branches; }
+
+	//moves to a branch, Next returns it next: the decoding starts at the seek point before it
+	//false when the trace cannot seek, the branch is past the end or the file is broken
+	bool Seek(uint64_t branch);
+
+private:
+	bool Fill(size_t bytes);
+	bool ReadBlock();
+	bool ReadSeekTable();
+
+	FILE* m_file;
+	std::vector<uint8_t> m_buffer;
+	size_t m_begin;
+	size_t m_end;
+	bool m_is_eof;
+	bool m_is_broken;
+	bool m_is_done;
+
+	std::string m_config;
+	BP_branch m_block[TRACE_BLOCK_SIZE];
+	unsigned m_count;
+	unsigned m_next;
+	uint32_t m_previous_pc;
+
+	uint64_t m_branches;
+	uint64_t m_seek_table;	//the file offset of the seek table, 0 when there is none
+};
+
+//reads a text trace line by line, the trace ends at the end of the file or at an empty line (as bp_main reads it)
+class TextTraceReader
+{
+public:
+	TextTraceReader() : m_file(NULL), m_is_broken(false) {}
+	~TextTraceReader();
+
+	//opens the file and reads the config line, false when the file cannot be opened
+	//a file without a config line is broken
+	bool Open(const char* path);
+
+	//the config line, without the end of the line
+	const std::string& Config() const { return m_config; }
+
+	//the next branch, false at the end of the trace or at a broken line (see IsBroken)
+	bool Next(BP_branch* branch);
+
+	bool IsBroken() const { return m_is_broken; }
+
+private:
+	FILE* m_file;
+	std::string m_config;
+	bool m_is_broken;
+};
+
+//the configuration of a config line: the five standard fields and the optional fields, as bp_main reads them
+bool ParseConfigLine(const std::string& line, BP_config* config);
+
+//reads a whole trace into memory, a binary trace or else a text trace
+bool ReadTrace(const char* path, std::string* config, std::vector<BP_branch>* trace);
+
+#endif /* BP_TRACE_H_ */
@@ -1,10 +1,16 @@
 #include <sstream>
-#include <fstream>
 #include <algorithm>
 #include <iostream>
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include <string>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "bp_api.h"
 
@@ -15,36 +21,172 @@ using namespace std;
 #define BROKEN_FILE -3
 #define GEN_ERROR -4
 
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+//the longest output line: "0x" + 8 hex digits, " T ", "0x" + 8 hex digits and the new line
+#define OUTPUT_LINE_SIZE 32
+#define MAX_TYPE_NAME 16
+
+//the predictions are printed one line per branch, flushed after every line (default) or buffered,
+//or only a summary is printed
+enum OutputMode { OUTPUT_LINES, OUTPUT_BUFFERED, OUTPUT_SUMMARY };
+
+//a read only mapping of the whole trace file, which is parsed front to back in a single pass
+class TraceFile
+{
+public:
+	TraceFile() : m_data(NULL), m_size(0) {}
+	~TraceFile() {
+		if (NULL != m_data) munmap((void*)m_data, m_size);
+	}
+
+	bool Open(const char* path) {
+		const int fd = open(path, O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) < 0) {
+			close(fd);
+			return false;
+		}
+
+		m_size = file_stat.st_size;
+		if (m_size > 0) {
+			void* data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (MAP_FAILED == data) {
+				close(fd);
+				return false;
+			}
+			madvise(data, m_size, MADV_SEQUENTIAL);
+			m_data = (const char*)data;
+		}
+
+		close(fd);
+		return true;
+	}
+
+	const char* Begin() const { return m_data; }
+	const char* End() const { return m_data + m_size; }
+
+private:
+	const char* m_data;
+	size_t m_size;
+};
+
+static inline bool IsSpace(char c) {
+	return ' ' == c || '\t' == c || '\r' == c;
+}
+
+//the next whitespace separated token of the line, returns false at the end of the line
+static inline bool NextToken(const char*& p, const char* line_end, const char** token_end) {
+	while (p < line_end && IsSpace(*p)) p++;
+	if (p == line_end) return false;
+
+	const char* end = p;
+	while (end < line_end && !IsSpace(*end)) end++;
+	*token_end = end;
+	return true;
+}
+
+//the number at the start of a token, as strtoul(token, NULL, 0) reads the hexadecimal ("0x") and decimal numbers of the traces
+static inline uint32_t ParseNumber(const char* p, const char* end) {
+	uint32_t value = 0;
+	if (end - p > 2 && '0' == p[0] && ('x' == p[1] || 'X' == p[1])) {
+		for (p += 2; p < end; p++) {
+			const char c = *p;
+			unsigned digit;
+			if (c >= '0' && c <= '9') digit = c - '0';
+			else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+			else break;
+			value = (value << 4) | digit;
+		}
+		return value;
+	}
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		value = value * 10 + (*p - '0');
+	return value;
+}
+
+//formats the lines of the predictions into a buffer, that is written when it is full, or after every line
+class Output
+{
+public:
+	Output(bool isLineFlushed) : m_used(0), m_is_line_flushed(isLineFlushed) {}
+	~Output() { Flush(); }
+
+	void Prediction(uint32_t pc, bool taken, uint32_t dst) {
+		if (m_used + OUTPUT_LINE_SIZE > OUTPUT_BUFFER_SIZE) Flush();
+
+		Hex(pc);
+		m_buffer[m_used++] = ' ';
+		m_buffer[m_used++] = taken ? 'T' : 'N';
+		m_buffer[m_used++] = ' ';
+		Hex(dst);
+		m_buffer[m_used++] = '\n';
+
+		if (m_is_line_flushed) Flush();
+	}
+
+	void Flush() {
+		if (0 == m_used) return;
+
+		fwrite(m_buffer, 1, m_used, stdout);
+		fflush(stdout);
+		m_used = 0;
+	}
+
+private:
+	//"0x" and the lowercase hexadecimal digits, without leading zeros
+	void Hex(uint32_t value) {
+		static const char digits[] = "0123456789abcdef";
+		m_buffer[m_used++] = '0';
+		m_buffer[m_used++] = 'x';
+
+		int shift = 28;
+		while (shift > 0 && 0 == (value >> shift)) shift -= 4;
+		for (; shift >= 0; shift -= 4)
+			m_buffer[m_used++] = digits[(value >> shift) & 0xF];
+	}
+
+	char m_buffer[OUTPUT_BUFFER_SIZE];
+	size_t m_used;
+	const bool m_is_line_flushed;
+};
+
 int main(int argc, char** argv) {
 
-	if (argc < 2){
-		cerr << __func__ << ": Error: correct usage is : '" << argv[0] << "' <trace filename>" << endl;
+	OutputMode output_mode = OUTPUT_LINES;
+	if (3 == argc && 0 == strcmp(argv[2], "--buffered")) output_mode = OUTPUT_BUFFERED;
+	else if (3 == argc && 0 == strcmp(argv[2], "--summary")) output_mode = OUTPUT_SUMMARY;
+	else if (2 != argc) {
+		cerr << __func__ << ": Error: correct usage is : '" << argv[0] << "' <trace filename> [--buffered | --summary]" << endl;
 		return INVALID_ARG_COUNT;
 	}
 
-	ifstream i_stream(argv[1]);
-	if (!i_stream.is_open()){
+	TraceFile trace;
+	if (!trace.Open(argv[1])){
 		cerr << __func__ << ": Error: could not open file at path " << argv[1] << endl;
 		return INVALID_FILE_PATH;
 	}
 
 	unsigned btbSize, BHRlength;
 	string sBHRtype, sTableType, sIsShare;
-	string line;
 
-	getline(i_stream, line);
-	istringstream first_line_stream(line);
+	const char* p = trace.Begin();
+	const char* line_end = (const char*)memchr(p, '\n', trace.End() - p);
+	if (NULL == line_end) line_end = trace.End();
+	istringstream first_line_stream(string(p, line_end));
+	p = (line_end < trace.End()) ? line_end + 1 : line_end;
 
 	//parse the first line of the file
 	if (!(first_line_stream >> btbSize >> BHRlength >> sBHRtype >> sTableType >> sIsShare)) {
 		cerr << __func__ << ": Error: first line of file at path " << argv[1] << " is broken. Exisiting...";
-		i_stream.close();
 		return BROKEN_FILE;
 	}
 
-	if (0 >= btbSize || 0 >= BHRlength || 8 < BHRlength){
+	if (0 >= btbSize || 0 >= BHRlength || BP_MAX_HISTORY_SIZE < BHRlength){
 		cerr << __func__ << ": Error: configuration arguments are invalid" << endl;
-		i_stream.close();
 		return BROKEN_FILE;
 	}
 
@@ -54,7 +196,6 @@ int main(int argc, char** argv) {
 	else if ("local_history" == sBHRtype) isGlobalHist = false;
 	else {
 		cerr << __func__ << ": Error: configuration arguments are invalid" << endl;
-		i_stream.close();
 		return BROKEN_FILE;
 	}
 
@@ -62,7 +203,6 @@ int main(int argc, char** argv) {
 	else if ("local_tables" == sTableType) isGlobalTable = false;
 	else{
 		cerr << __func__ << ": Error: configuration arguments are invalid" << endl;
-		i_stream.close();
 		return BROKEN_FILE;
 	}
 
@@ -70,73 +210,110 @@ int main(int argc, char** argv) {
 	else if ("not_using_share" == sIsShare) isShare = false;
 	else {
 		cerr << __func__ << ": Error: configuration arguments are invalid" << endl;
-		i_stream.close();
 		return BROKEN_FILE;
 	}
 
-	if (0 > BP_init(btbSize, BHRlength, isGlobalHist, isGlobalTable, isShare)) {
+	BP_config config;
+	BP_defaultConfig(&config, btbSize, BHRlength, isGlobalHist, isGlobalTable, isShare);
+
+	//optional fields: the predictor engine and its parameters
+	string sOption;
+	while (first_line_stream >> sOption) {
+		if (0 > BP_parseOption(&config, sOption.c_str())) {
+			cerr << __func__ << ": Error: configuration option " << sOption << " is invalid" << endl;
+			return BROKEN_FILE;
+		}
+	}
+
+	if (0 > BP_initConfig(&config)) {
 		cerr << __func__ << ": Error: predictor initialization failed" << endl;
-		i_stream.close();
 		return GEN_ERROR;
 	}
 
-	map<unsigned, bool> prediction_selector;
+	//as the original two pass reader: a branch is updated only when its first occurrence is at an even line
+	//(counting from the first line after the config line), which is known when the branch is first seen
+	unordered_map<uint32_t, bool> prediction_selector;
 	unsigned counter = 0;
 
-	while (getline(i_stream, line)){
-		istringstream parser(line);
-		string sPc;
-
-		if (!(parser >> sPc)) break;
-
-		unsigned pc = (unsigned)strtoul(sPc.c_str(), NULL, 0);
-
-		if (prediction_selector.end() == prediction_selector.find(pc))
-			prediction_selector[pc] = (counter % 2) ? false : true;
-		
-		counter++;
-	}
-
-	i_stream.clear();
-	i_stream.seekg(0, i_stream.beg);
+	Output output(OUTPUT_LINES == output_mode);
+	unsigned long long branches = 0, direction_mispredictions = 0, target_mispredictions = 0;
 
-	//advance to the second line
-	getline(i_stream, line);
+	for (; p < trace.End(); p = line_end + 1, counter++) {
+		line_end = (const char*)memchr(p, '\n', trace.End() - p);
+		if (NULL == line_end) line_end = trace.End();
 
-	while (getline(i_stream, line)){
-		istringstream parser(line);
-		string sPc, sTargetPc;
-
-		unsigned pc, targetPc;
-		char sczTaken;
-		bool taken;
+		const char *pc_end, *target_end, *type_end;
+		if (!NextToken(p, line_end, &pc_end))
+			break;
+		const uint32_t pc = ParseNumber(p, pc_end);
 
-		if (!(parser >> sPc >> sczTaken >> sTargetPc))
+		//the taken field is a single character, the target may follow it immediately
+		const char* taken_field = pc_end;
+		if (!NextToken(taken_field, line_end, &target_end))
+			break;
+		const char sczTaken = *taken_field;
+		const char* target_field = taken_field + 1;
+		if (!NextToken(target_field, line_end, &target_end))
 			break;
+		const uint32_t targetPc = ParseNumber(target_field, target_end);
 
-		pc = strtoul(sPc.c_str(), NULL, 0);
-		targetPc = strtoul(sTargetPc.c_str(), NULL, 0);
+		//optional field: the branch type
+		BP_branchType type = BP_BRANCH_COND;
+		const char* type_field = target_end;
+		if (NextToken(type_field, line_end, &type_end)) {
+			char sType[MAX_TYPE_NAME];
+			const size_t length = type_end - type_field;
+			if (length >= MAX_TYPE_NAME) type = BP_BRANCH_TYPES;
+			else {
+				memcpy(sType, type_field, length);
+				sType[length] = '\0';
+				if (0 > BP_parseBranchType(sType, &type)) type = BP_BRANCH_TYPES;
+			}
+		}
 
+		bool taken;
 		if ('T' == sczTaken) taken = true;
 		else if ('N' == sczTaken) taken = false;
-		else {
+		else type = BP_BRANCH_TYPES;
+
+		if (BP_BRANCH_TYPES == type) {
+			output.Flush();
 			cerr << __func__ << ": Error: bad trace file" << endl;
-			i_stream.close();
 			return BROKEN_FILE;
 		}
 
+		const bool is_selected = prediction_selector.insert(make_pair(pc, 0 == counter % 2)).first->second;
+
 		uint32_t dst = 0;
-		cout << "0x" << std::hex << pc << " ";
-		cout << (BP_predict(pc, &dst) ? "T" : "N") << " ";
-		cout << "0x" << std::hex << dst << endl;
+		const bool prediction = BP_predict(pc, &dst);
+		if (OUTPUT_SUMMARY == output_mode) {
+			branches++;
+			direction_mispredictions += (prediction != taken);
+			target_mispredictions += (prediction && taken && dst != targetPc);
+		}
+		else output.Prediction(pc, prediction, dst);
 
-		if (prediction_selector[pc]){
+		if (is_selected){
 			BP_setBranchAt(pc);
-			BP_update(pc, targetPc, taken);
+			BP_updateTyped(pc, targetPc, taken, type);
 		}
+
+		if (line_end == trace.End()) break;
 	}
 
-	i_stream.close();
+	output.Flush();
+	if ('\0' != config.saveState[0] && 0 > BP_saveState(config.saveState)) {
+		cerr << __func__ << ": Error: could not save the predictor state to " << config.saveState << endl;
+		return GEN_ERROR;
+	}
+
+	if (OUTPUT_SUMMARY == output_mode) {
+		printf("branches %llu, direction mispredictions %llu (%.2f%%), target mispredictions %llu (%.2f%%)\n",
+			branches, direction_mispredictions, (0 == branches) ? 0.0 : 100.0 * direction_mispredictions / branches,
+			target_mispredictions, (0 == branches) ? 0.0 : 100.0 * target_mispredictions / branches);
+		fflush(stdout);
+	}
 
+	BP_printReport(stderr);
 	return 0;
-}
\ No newline at end of file
+}